@@ -12,11 +12,12 @@
 #  (at your option) any later version.
 #
 
-import os, time, pwd, fcntl
+import os, time, pwd, fcntl, socket, tempfile
 
 # capisuite stuff
 #import capisuite
 import capisuite.fax
+import capisuite.storage
 from capisuite.config import NoOptionError
 import capisuite.core as core
 
@@ -27,17 +28,20 @@ import capisuite.helpers as helpers
 
 from capisuite.fileutils import _releaseLock, _getLock, LockTakenError
 
-def idle(capi):
+def _readGlobals(config):
+    """
+    Read the global options needed for sending jobs.
 
-    capi = capisuite.core.Capi(capi)
-    config = capisuite.config.readGlobalConfig()
+    Returns a tuple (spool, max_tries, delays, doneQ, failedQ) or None
+    if an option is missing or the spool dirs aren't accessible.
+    """
     try:
         spool = config.get('GLOBAL', "spool_dir")
         max_tries = config.getint('GLOBAL', "send_tries")
         delays = config.getList('GLOBAL', "send_delays")
     except NoOptionError, err:
         core.error("global option %s not found." % err.option)
-        return
+        return None
 
     # todo: implement config.getQueue(queue,user=None)
     doneQ = os.path.join(spool, "done")
@@ -45,118 +49,288 @@ def idle(capi):
 
     if not os.access(doneQ, os.W_OK) or not os.access(failedQ, os.W_OK):
         core.error("Can't read/write to the necessary spool dirs below %s" % spool)
+        return None
+    return spool, max_tries, delays, doneQ, failedQ
+
+
+# retry interval for jobs which couldn't be handled (e.g. locked by
+# another process)
+_retry_delay = 60
+
+
+def idle(capi):
+    """
+    Check the send schedule for jobs which are due.
+
+    The send times of all jobs are kept in the send schedule of
+    capisuite. The send queues are only read into it when they were
+    changed (e.g. by capisuitefax), so each run only needs to look at
+    the jobs which are due. Jobs deferred by sendJob() are updated
+    directly in the schedule.
+
+    The jobs aren't sent here. Each job is handed over to capisuite
+    which calls sendJob() for it in an own thread as soon as a B channel
+    of one of the send controllers is free (the least loaded one is
+    used). So several faxes are sent in parallel and one long fax
+    doesn't delay the rest of the queue.
+
+    Each run also renews the claims of the jobs this node is sending
+    and takes back the expired claims of other nodes sharing the spool
+    (see capisuite.fax.claimJob()).
+    """
+    capi = capisuite.core.Capi(capi)
+    config = capisuite.config.readGlobalConfig()
+    if not _readGlobals(config):
+        return
+    try:
+        controllers = capisuite.fax.sendControllers(config)
+    except ValueError:
+        core.error("invalid value for global option send_controller")
         return
 
-    # search in all user-specified sendq's
+    # add new jobs of all user-specified sendq's to the schedule
     for user in config.listUsers():
-        outgoing_num = config.getUser(user, "outgoing_msn")
-        if not outgoing_num:
-            incoming_nums = config.getUser(user, "fax_numbers")
-            if not incoming_nums:
-                continue
-            outgoing_num = incoming_nums.split(',')[0].strip()
-
-        mailaddress = config.getUser(user, "fax_email", user)
-        fromaddress = config.getUser(user, "fax_email_from", user)
-
-        for jobnum, controlfile in capisuite.fax.getQueueFiles(config, user):
-            core.log("checking job %s %s" % (jobnum, controlfile), 3)
-            assert controlfile == os.path.abspath(controlfile)
-            try:
-                # lock the job so that it isn't deleted while sending
-                lock = _getLock('dummy', forfile=controlfile, blocking=0)
-            except LockTakenError:
-                # if we didn't get the lock, continue with next job
-                continue
+        if not config.getUser(user, "outgoing_msn") and \
+           not config.getUser(user, "fax_numbers"):
+            continue
+        try:
+            capisuite.fax.renewClaims(config, user)
+            capisuite.fax.updateSchedule(config, user)
+        except (EnvironmentError, KeyError), err:
+            core.error("can't read send queue of user %s: %s" % (user, err))
+
+    due = core.due_jobs()
+    for i in range(len(due)):
+        controlfile, user, starttime = due[i]
+        core.log("checking job %s" % controlfile, 3)
+        if not os.access(controlfile, os.F_OK):
+            # the job was cancelled
+            continue
+
+        result = capi.send_job(controllers, user, controlfile)
+        if result == 0:
+            # all B channels are busy, the remaining jobs have to
+            # wait until a job is finished (or for the next regular run)
+            core.log("all B channels busy, delaying %i job(s)" %
+                     (len(due)-i), 3)
+            for job in due[i:]:
+                core.schedule_job(*job)
+            return
+        elif result > 0:
+            core.log("job %s from %s dispatched" % (controlfile, user), 2)
+        # otherwise it's already being sent and will be rescheduled by
+        # sendJob() if necessary
+
+
+def _allPagesSent(fax_file, pages_sent):
+    """
+    Check if 'pages_sent' pages confirmed by the receiver are all pages
+    of 'fax_file'.
+    """
+    try:
+        return pages_sent >= core.sff_pages(fax_file)
+    except IOError, err:
+        core.error("can't count the pages of %s: %s" % (fax_file, err))
+        return 0
+
+
+def sendJob(capi, controller, user, controlfile):
+    """
+    Send one job of the send queue.
+
+    This is called by capisuite in an own thread for each job which
+    idle() has handed over. The same job is never sent by two threads
+    at a time. The job is claimed for this node while it's handled, so
+    other nodes sharing the spool don't send it, too. The claim is renewed
+    until the job is finished.
+    """
+    capi = capisuite.core.Capi(capi)
+    config = capisuite.config.readGlobalConfig()
+    options = _readGlobals(config)
+    if not options:
+        return
+    spool, max_tries, delays, doneQ, failedQ = options
+
+    outgoing_num = config.getUser(user, "outgoing_msn")
+    if not outgoing_num:
+        incoming_nums = config.getUser(user, "fax_numbers")
+        if not incoming_nums:
+            return
+        outgoing_num = incoming_nums.split(',')[0].strip()
+
+    mailaddress = config.getUser(user, "fax_email", user)
+    fromaddress = config.getUser(user, "fax_email_from", user)
+
+    jobnum = int(capisuite.fax._job_pattern.match(
+        os.path.basename(controlfile)).group(1))
+
+    try:
+        # lock the job so that it isn't deleted while sending
+        lock = _getLock('dummy', forfile=controlfile, blocking=0)
+    except LockTakenError:
+        # the job is handled by another process (e.g. capisuitefax),
+        # so try again later
+        core.schedule_job(controlfile, user, time.time()+_retry_delay)
+        return
+    claimfile = renewal = None
+    try:
+        claimfile = capisuite.fax.claimJob(config, user, controlfile)
+        if not claimfile:
+            # it's handled by another node or was cancelled
+            return
+        renewal = capisuite.fax.ClaimRenewal(config, claimfile)
+        control = capisuite.config.JobDescription(claimfile)
+
+        fax_file = control.get('filename')
+        assert fax_file == os.path.abspath(fax_file)
+
+        # both the job control file and the fax file must have
+        # the users uid
+        uid = pwd.getpwnam(user).pw_uid
+        try:
+            if os.stat(claimfile).st_uid != uid or \
+               os.stat(fax_file).st_uid != uid:
+                core.error("job %s seems to be manipulated "
+                           "(wrong uid)! Ignoring..." % controlfile)
+                #_releaseLock(lock)
+                return
+        except OSError, e:
+            core.error("job %s seems to be manipulated! "
+                       "%s Ignoring..." % (controlfile, e))
+            #_releaseLock(lock)
+            return
+
+        # todo: describe what is tested here
+        # perhaps it was cancelled?
+        if not os.access(claimfile, os.W_OK):
+            #_releaseLock(lock)
+            return
+
+        starttime = capisuite.fax.getStartTime(control)
+        if starttime > time.time():
+            core.schedule_job(controlfile, user, starttime)
+            #_releaseLock(lock)
+            return
+
+        sendinfo = {
+            'outgoing_num': outgoing_num,
+            'dialstring':   control.get("dialstring")
+            }
+        # these options may overwrite the global settings per job
+        for n in ('stationID', 'headline'):
+            if control.has_option(n):
+                sendinfo[n] = control.get(n)
+
+        # pages confirmed by former tries needn't be sent again
+        pages_sent = 0
+        send_file = fax_file
+        if control.has_option('pages_sent'):
+            pages_sent = control.getint('pages_sent')
+        if pages_sent:
+            # not in the sendq, which should only hold the jobs
+            fd, send_file = tempfile.mkstemp('.sff', 'capisuite-resume-')
+            os.close(fd)
             try:
-                control = capisuite.config.JobDescription(controlfile)
-
-                fax_file = control.get('filename')
-                assert fax_file == os.path.abspath(fax_file)
-
-                # both the job control file and the fax file must have
-                # the users uid
-                uid = pwd.getpwnam(user).pw_uid
-                try:
-                    if os.stat(controlfile).st_uid != uid or \
-                       os.stat(fax_file).st_uid != uid:
-                        core.error("job %s seems to be manipulated "
-                                   "(wrong uid)! Ignoring..." % controlfile)
-                        #_releaseLock(lock)
-                        continue
-                except OSError, e:
-                    core.error("job %s seems to be manipulated! "
-                               "%s Ignoring..." % (controlfile, e))
-                    #_releaseLock(lock)
-                    continue
-
-                # todo: describe what is tested here
-                # perhaps it was cancelled?
-                if not os.access(controlfile, os.W_OK):
-                    #_releaseLock(lock)
-                    continue
-
-                # set DST value to -1 (unknown), as strptime sets it wrong
-                # for some reason
-                starttime = time.strptime(control.get("starttime"))[:-1]+(-1, )
-                starttime = time.mktime(starttime)
-                if starttime > time.time():
-                    #_releaseLock(lock)
-                    continue
-
-                sendinfo = {
-                    'outgoing_num': outgoing_num,
-                    'dialstring':   control.get("dialstring")
-                    }
-                # these options may overwrite the global settings per job
-                for n in ('stationID', 'headline'):
-                    if control.has_option(n):
-                        sendinfo[n] = control.get(n)
-
-                core.log("job %s from %s to %s initiated" %
-                         (jobnum, user, sendinfo['dialstring']), 1)
-                result, faxinfo = capisuite.fax.sendfax(config, user, capi,
-                                                        fax_file, **sendinfo)
-                result, resultB3 = result
-                core.log("job %s: result was 0x%x, 0x%x" % \
-                         (jobnum, result, resultB3), 1)
-                sendinfo['result'] = result
-                sendinfo['resultB3'] = resultB3
-                sendinfo['hostname'] = os.uname()[1]
-                if faxinfo:
-                    sendinfo.update(faxinfo.as_dict())
-                
-                # todo: use symbolic names for these results to be more
-                # meaningfull
-                send_ok = resultB3 == 0 \
-                          and result in (0, 0x3400, 0x3480, 0x3490, 0x349f)
-                tries = control.getint("tries") +1
-                control.set('tries', tries)
-                if send_ok:
-                    core.log("job %s: finished successfully" % jobnum, 1)
-                    control = capisuite.fax.moveJob(controlfile, doneQ, user)
-                    sendinfo.update(control.items())
-                    helpers.sendSimpleMail(
-                        fromaddress, mailaddress,
-                        config.get('MailFaxSent', 'subject') % sendinfo,
-                        config.get('MailFaxSent', 'text') % sendinfo)
-                elif tries >= max_tries:
-                    # too many ties, send failed
-                    core.log("job %s: failed finally" % jobnum, 1)
-                    control = capisuite.fax.moveJob(controlfile, failedQ, user)
-                    sendinfo.update(control.items())
-                    helpers.sendSimpleMail(
-                        fromaddress, mailaddress,
-                        config.get('MailFaxFailed', 'subject') % sendinfo,
-                        config.get('MailFaxFailed', 'text') % sendinfo)
-                else:
-                    # delay next try
-                    next_delay = int(delays[ min(len(delays),tries) -1 ])
-                    core.log("job %s: delayed for %i seconds" % \
-                             (jobnum, next_delay), 2)
-                    starttime = time.time() + next_delay
-                    control.set('starttime', time.ctime(starttime))
-                    control.write(controlfile)
-            finally:
-                _releaseLock(lock)
+                core.sff_slice(fax_file, send_file, pages_sent)
+                core.log("job %s: resuming after page %i" %
+                         (jobnum, pages_sent), 1)
+            except IOError, err:
+                core.error("job %s: can't resume, sending all pages "
+                           "again (%s)" % (jobnum, err))
+                os.unlink(send_file)
+                pages_sent = 0
+                send_file = fax_file
+
+        core.log("job %s from %s to %s initiated" %
+                 (jobnum, user, sendinfo['dialstring']), 1)
+        try:
+            result, faxinfo = capisuite.fax.sendfax(config, user, capi,
+                                                    send_file,
+                                                    controller=controller,
+                                                    **sendinfo)
+        finally:
+            if send_file != fax_file:
+                os.unlink(send_file)
+        result, resultB3 = result
+        core.log("job %s: result was 0x%x, 0x%x" % \
+                 (jobnum, result, resultB3), 1)
+        sendinfo['result'] = result
+        sendinfo['resultB3'] = resultB3
+        sendinfo['hostname'] = os.uname()[1]
+        if faxinfo:
+            sendinfo.update(faxinfo.as_dict())
+            sendinfo['numPages'] += pages_sent
+        
+        # todo: use symbolic names for these results to be more
+        # meaningfull
+        send_ok = resultB3 == 0 \
+                  and result in (0, 0x3400, 0x3480, 0x3490, 0x349f)
+        if not send_ok and faxinfo and faxinfo.numPages and \
+           _allPagesSent(fax_file, pages_sent+faxinfo.numPages):
+            # the call ended with an error after the last page was
+            # confirmed, so the fax was delivered
+            core.log("job %s: all pages confirmed, ignoring the error" %
+                     jobnum, 1)
+            send_ok = 1
+        tries = control.getint("tries") +1
+        control.set('tries', tries)
+        if send_ok:
+            core.log("job %s: finished successfully" % jobnum, 1)
+            control = capisuite.storage.getStorage(config, user).setDone(
+                jobnum, claimfile)
+            sendinfo.update(control.items())
+            helpers.sendSimpleMail(
+                fromaddress, mailaddress,
+                config.get('MailFaxSent', 'subject') % sendinfo,
+                config.get('MailFaxSent', 'text') % sendinfo)
+        elif tries >= max_tries:
+            # too many ties, send failed
+            core.log("job %s: failed finally" % jobnum, 1)
+            control = capisuite.storage.getStorage(config, user).setFailed(
+                jobnum, claimfile)
+            sendinfo.update(control.items())
+            helpers.sendSimpleMail(
+                fromaddress, mailaddress,
+                config.get('MailFaxFailed', 'subject') % sendinfo,
+                config.get('MailFaxFailed', 'text') % sendinfo)
+        else:
+            # delay next try
+            next_delay = int(delays[ min(len(delays),tries) -1 ])
+            core.log("job %s: delayed for %i seconds" % \
+                     (jobnum, next_delay), 2)
+            starttime = time.time() + next_delay
+            control.set('starttime', time.ctime(starttime))
+            if faxinfo and faxinfo.numPages:
+                # remember the pages the receiver has confirmed
+                control.set('pages_sent', pages_sent+faxinfo.numPages)
+            control.write(claimfile)
+            capisuite.storage.getStorage(config, user).updateItem(
+                jobnum, **dict(control.items()))
+            core.schedule_job(controlfile, user, starttime)
+    finally:
+        if renewal:
+            renewal.stop()
+        if claimfile:
+            capisuite.fax.releaseJob(claimfile, controlfile)
+        _releaseLock(lock)
+        # don't lose jobs still in the queue if something went wrong
+        if not core.job_scheduled(controlfile) and \
+           os.access(controlfile, os.F_OK):
+            core.schedule_job(controlfile, user, time.time()+_retry_delay)
+
 
+def jobRequest(fd, user):
+    """
+    Handle the requests of one connection to the job socket.
+
+    This is called by capisuite in an own thread for each connection.
+    'user' is the user who opened the connection. See capisuite.jobsocket
+    for the protocol.
+    """
+    import capisuite.jobsocket
+    sock = socket.fromfd(fd, socket.AF_UNIX, socket.SOCK_STREAM)
+    try:
+        config = capisuite.config.readGlobalConfig()
+        capisuite.jobsocket.serve(config, sock, user)
+    finally:
+        sock.close()
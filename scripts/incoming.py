@@ -41,35 +41,22 @@ def callIncoming(call, service, call_from, call_to):
     # convert into a python call handle
     # TODO-gh: can't we get rid of this line?
     call = core.Call(call, service, call_from, call_to)
-    # read config file and search for call.to_nr in the user sections
+    # read config file and search for the user of call.to_nr
     try:
         config = capisuite.config.readGlobalConfig()
+        route = capisuite.config.routeCall(config, call.to_nr, service)
     except IOError, e:
         core.error("Error occured during config file reading: %s "
                    "Disconnecting..." % e)
         call.reject(0x34A9)
         return
 
-    for user in config.listUsers():
-        # accept a voice call on 'voice_numbers'
-        if config.has_option(user, 'voice_numbers'):
-            numbers = config.getList(user, 'voice_numbers')
-            if numbers == ["*"] or call.to_nr in numbers:
-                if service in (core.SERVICE_VOICE, ):
-                    break
-        # accept a voice or fax call on 'fax_numbers'
-        if config.has_option(user, 'fax_numbers'):
-            numbers = config.getList(user, 'fax_numbers')
-            if numbers == ["*"] or call.to_nr in numbers:
-                if service in (core.SERVICE_FAXG3, core.SERVICE_VOICE):
-                    # set service type to 'fax'
-                    service = core.SERVICE_FAXG3
-                    break
-    else:
+    if route is None:
         # no matching entry found (no users as this number)
         call.log("call from %s to %s ignoring" % (call.from_nr, call.to_nr), 1)
         call.reject(1)
         return
+    user, service = route
 
     # answer the call with the right service
     try:
@@ -203,10 +190,13 @@ def voiceIncoming(config, user, call):
         if os.access(userannouncement, os.R_OK):
             call.audio_send(userannouncement, 1)
         else:
+            files = []
             if call.to_nr != "-":
-                say(config, user, call, "anrufbeantworter-von.la")
-                capisuite.voice.sayNumber(config, user, call, call.to_nr)
-            say(config, user, call, "bitte-nachricht.la")
+                files.append("anrufbeantworter-von.la")
+                files.extend(["%s.la" % f for f in
+                              capisuite.voice.getNumberFiles(call.to_nr)])
+            files.append("bitte-nachricht.la")
+            say(config, user, call, *files)
 
         if action != "none":
             say(config, user, call, "beep.la")
@@ -214,8 +204,10 @@ def voiceIncoming(config, user, call):
             # todo: put this into voice.getNameForRecord
             filename = fileutils.uniqueName(receivedQ, "voice", 'la')[1]
             silence_timeout = config.getUser(user, "record_silence_timeout", 5)
+            compressed = config.getUser(user, "record_compressed", "0")
             msg_length = call.audio_receive(filename, int(length),
-                                                 int(silence_timeout), 1)
+                                            int(silence_timeout), 1,
+                                            int(compressed))
         dtmf_list = call.read_DTMF(0)
         if dtmf_list == "X":
             if os.access(filename, os.R_OK):
@@ -353,10 +345,10 @@ def cmd_inquiry(config, user, call, oldmessages, messages, lastinquiry):
             msgnum, controlfile = curr_msgs[i]
             descr = config.JobDescription(controlfile)
             # play the announcement
-            for f in _getSoundsForAnnounceMessages(i, descr):
-                say(config, user, call, "%s.la" % f)
+            say(config, user, call,
+                *["%s.la" % f for f in _getSoundsForAnnounceMessages(i, descr)])
             # play the recorded file
-            call.audio_send(descr.get('filename'), 1)
+            call.audio_send(descr.get('filename'), 1, cache=0)
             cmd = ""
             while cmd not in ("1", "4", "5", "6"):
                 say(config, user, call, "erklaerung.la")
@@ -415,7 +407,7 @@ def cmd_recordNewAnnouncement(config, user, call, userdir):
     while 1:
         call.audio_receive(tmpfile, 60, 3)
         say(config, user, call, "neue-ansage-lautet.la")
-        call.audio_send(tmpfile)
+        call.audio_send(tmpfile, cache=0)
         say(config, user, call, "wenn-einverstanden-1.la")
         cmd = call.read_DTMF(0, 1)
         # todo: allow eg. '9' for cancel and go back to menu
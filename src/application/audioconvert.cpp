@@ -0,0 +1,92 @@
+/*  @file audioconvert.cpp
+    @brief Contains AudioConvert - conversion of the audio files used by CapiSuite to common formats
+
+    @author agent <agent@local>
+*/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include <fstream>
+#include "../backend/audiocodec.h"
+#include "audioconvert.h"
+
+string
+AudioConvert::la2pcm(const string &la)
+{
+	string pcm(la.size()*2,'\0');
+	for (string::size_type i=0;i<la.size();i++) {
+		unsigned short sample=AudioCodec::la2linear(static_cast<unsigned char>(la[i]));
+		pcm[2*i]=static_cast<char>(sample & 0xff);
+		pcm[2*i+1]=static_cast<char>(sample >> 8);
+	}
+	return pcm;
+}
+
+string
+AudioConvert::la2wav(const string &la)
+{
+	unsigned long data_size=la.size()*2;
+
+	string wav;
+	wav.reserve(44+data_size);
+	wav.append("RIFF");
+	putLE(wav,36+data_size,4);
+	wav.append("WAVEfmt ");
+	putLE(wav,16,4); // size of fmt chunk
+	putLE(wav,1,2); // PCM
+	putLE(wav,1,2); // mono
+	putLE(wav,8000,4); // sample rate
+	putLE(wav,16000,4); // bytes per second
+	putLE(wav,2,2); // bytes per sample
+	putLE(wav,16,2); // bits per sample
+	wav.append("data");
+	putLE(wav,data_size,4);
+	wav.append(la2pcm(la));
+	return wav;
+}
+
+string
+AudioConvert::readFile(string filename) throw (ApplicationError)
+{
+	ifstream file(filename.c_str());
+	if (!file)
+		throw ApplicationError("unable to open file "+filename,"AudioConvert::readFile()");
+	string data;
+	char buffer[8192];
+	while (file.read(buffer,sizeof(buffer)) || file.gcount())
+		data.append(buffer,file.gcount());
+	if (file.bad())
+		throw ApplicationError("unable to read file "+filename,"AudioConvert::readFile()");
+	return data;
+}
+
+string
+AudioConvert::readAudioFile(string filename) throw (ApplicationError)
+{
+	string data=readFile(filename);
+	if (AudioCodec::isAdpcm(data.data(),data.size()))
+		return AudioCodec::decodeFile(data);
+	return data;
+}
+
+void
+AudioConvert::writeFile(string filename, const string &data) throw (ApplicationError)
+{
+	ofstream file(filename.c_str());
+	if (!file || !file.write(data.data(),data.size()))
+		throw ApplicationError("unable to write file "+filename,"AudioConvert::writeFile()");
+}
+
+void
+AudioConvert::putLE(string &s, unsigned long value, int bytes)
+{
+	for (int i=0;i<bytes;i++)
+		s+=static_cast<char>((value >> (8*i)) & 0xff);
+}
@@ -0,0 +1,92 @@
+/** @file audioconvert.h
+    @brief Contains AudioConvert - conversion of the audio files used by CapiSuite to common formats
+
+    @author agent <agent@local>
+*/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef AUDIOCONVERT_H
+#define AUDIOCONVERT_H
+
+#include <string>
+#include "applicationexception.h"
+
+using namespace std;
+
+/** @brief Conversion of the audio files used by CapiSuite to common formats
+
+    CapiSuite saves received audio in the format given by CAPI, i.e. bit-reversed
+    A-Law, 8 kHz, mono (".la" for sox). This class converts such data to linear
+    16 bit PCM and to WAV files, so received voice messages can be sent to the
+    user w/o calling an external tool like sox.
+
+    The decoding is done with the lookup table of AudioCodec which combines the bit
+    reversal and the A-Law expansion, so each sample costs one table access.
+
+    Compressed recordings (see AudioCodec) are decoded by readAudioFile(), so they
+    can be converted like normal A-Law files.
+
+    All methods are static and thread safe.
+
+    @author agent
+*/
+class AudioConvert
+{
+	public:
+		/** @brief Convert bit-reversed A-Law data to linear PCM
+
+		    @param la the A-Law data
+		    @return signed 16 bit samples, little endian
+		*/
+		static string la2pcm(const string &la);
+
+		/** @brief Convert bit-reversed A-Law data to a WAV file
+
+		    @param la the A-Law data
+		    @return contents of a WAV file with 16 bit PCM, 8 kHz, mono
+		*/
+		static string la2wav(const string &la);
+
+		/** @brief Read a whole file to memory
+
+		    @param filename name of the file to read
+		    @return the file contents
+		    @throw ApplicationError Thrown if the file can't be read
+		*/
+		static string readFile(string filename) throw (ApplicationError);
+
+		/** @brief Read an audio file to memory, decode it if it's compressed
+
+		    @param filename name of the file to read
+		    @return the audio data in bit-reversed A-Law format
+		    @throw ApplicationError Thrown if the file can't be read
+		*/
+		static string readAudioFile(string filename) throw (ApplicationError);
+
+		/** @brief Write data to a file
+
+		    @param filename name of the file to write, an existing file will be overwritten
+		    @param data the data to write
+		    @throw ApplicationError Thrown if the file can't be written
+		*/
+		static void writeFile(string filename, const string &data) throw (ApplicationError);
+
+	private:
+		/** @brief append a number in little endian byte order
+
+		    @param s the string to append to
+		    @param value the number
+		    @param bytes number of bytes to append
+		*/
+		static void putLE(string &s, unsigned long value, int bytes);
+};
+
+#endif
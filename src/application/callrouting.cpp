@@ -0,0 +1,143 @@
+/*  @file callrouting.cpp
+    @brief Contains CallRouting - process-wide index of the called numbers of all users
+
+    @author agent <agent@local>
+*/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include <algorithm>
+#include "scriptconfig.h"
+#include "callrouting.h"
+
+CallRouting::Table* CallRouting::table=NULL;
+vector<string> CallRouting::files;
+vector<string> CallRouting::ignore;
+pthread_mutex_t CallRouting::mutex=PTHREAD_MUTEX_INITIALIZER;
+
+void
+CallRouting::setup(const vector<string> &new_files, const vector<string> &new_ignore)
+{
+	pthread_mutex_lock(&mutex);
+	bool changed=!table || files!=new_files || ignore!=new_ignore || table->generation!=ScriptConfig::generation();
+	files=new_files;
+	ignore=new_ignore;
+	pthread_mutex_unlock(&mutex);
+	if (changed)
+		rebuild();
+}
+
+void
+CallRouting::rebuild()
+{
+	pthread_mutex_lock(&mutex);
+	vector<string> f=files, i=ignore;
+	pthread_mutex_unlock(&mutex);
+	if (f.empty())
+		return;
+
+	Table *t=build(f,i); // build w/o holding the lock, routing shouldn't wait for it
+
+	pthread_mutex_lock(&mutex);
+	if (table && table->generation>t->generation) // another thread was quicker with a newer one
+		delete t;
+	else {
+		delete table;
+		table=t;
+	}
+	pthread_mutex_unlock(&mutex);
+}
+
+int
+CallRouting::route(const string &number, Connection::service_t service, string &user, Connection::service_t &user_service)
+{
+	pthread_mutex_lock(&mutex);
+	if (!table || !table->valid) {
+		pthread_mutex_unlock(&mutex);
+		return -1;
+	}
+	const Route *found=NULL;
+	tr1::unordered_map<string,vector<Route> >::const_iterator it=table->numbers.find(number);
+	if (it!=table->numbers.end())
+		found=first(it->second,service);
+	const Route *wildcard=first(table->wildcards,service);
+	if (wildcard && (!found || wildcard->rank<found->rank))
+		found=wildcard;
+	if (found) {
+		user=found->user;
+		user_service=found->fax ? Connection::FAXG3 : Connection::VOICE;
+	}
+	pthread_mutex_unlock(&mutex);
+	return found ? 1 : 0;
+}
+
+CallRouting::Table*
+CallRouting::build(const vector<string> &files, const vector<string> &ignore)
+{
+	Table *t=new Table;
+	const ScriptConfig::Snapshot *snapshot=ScriptConfig::acquire(files);
+	t->generation=snapshot->generation;
+	t->valid=snapshot->valid;
+	Route route;
+	route.rank=0;
+	for (unsigned i=0;i<snapshot->sections.size();i++) {
+		route.user=snapshot->sections[i].name;
+		if (find(ignore.begin(),ignore.end(),route.user)!=ignore.end())
+			continue;
+		const string *value;
+		route.fax=false;
+		if ((value=snapshot->option(route.user,"voice_numbers")))
+			add(t,*value,route);
+		route.rank++;
+		route.fax=true;
+		if ((value=snapshot->option(route.user,"fax_numbers")))
+			add(t,*value,route);
+		route.rank++;
+	}
+	ScriptConfig::release(snapshot);
+	return t;
+}
+
+void
+CallRouting::add(Table *t, const string &raw, const Route &route)
+{
+	string value=raw;
+	if (value.size()>1 && value[0]=='"') // strip quotation marks like CSConfigParser.get()
+		value=value.substr(1,value.size()-2);
+
+	vector<string> numbers;
+	string::size_type start=0, end;
+	do {
+		end=value.find(',',start);
+		string number=value.substr(start,end==string::npos ? string::npos : end-start);
+		string::size_type first=number.find_first_not_of(" \t\r\n\f\v");
+		if (first==string::npos)
+			number="";
+		else
+			number=number.substr(first,number.find_last_not_of(" \t\r\n\f\v")-first+1);
+		numbers.push_back(number);
+		start=end+1;
+	} while (end!=string::npos);
+
+	if (numbers.size()==1 && numbers[0]=="*")
+		t->wildcards.push_back(route);
+	else
+		for (unsigned i=0;i<numbers.size();i++)
+			t->numbers[numbers[i]].push_back(route);
+}
+
+const CallRouting::Route*
+CallRouting::first(const vector<Route> &routes, Connection::service_t service)
+{
+	for (unsigned i=0;i<routes.size();i++)
+		if (service==Connection::VOICE || (service==Connection::FAXG3 && routes[i].fax))
+			return &routes[i];
+	return NULL;
+}
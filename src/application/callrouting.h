@@ -0,0 +1,123 @@
+/** @file callrouting.h
+    @brief Contains CallRouting - process-wide index of the called numbers of all users
+
+    @author agent <agent@local>
+*/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef CALLROUTING_H
+#define CALLROUTING_H
+
+#include <pthread.h>
+#include <string>
+#include <vector>
+#include <tr1/unordered_map>
+#include "../backend/connection.h"
+
+using namespace std;
+
+/** @brief Process-wide index of the called numbers of all users
+
+    The incoming script has to find the user responsible for the called number of
+    each call. Checking the options voice_numbers and fax_numbers of each user in
+    Python would take time proportional to the number of users and numbers, which
+    gets noticeable with hundreds of users and thousands of numbers.
+
+    So this class builds a hash table from each called number to the users having
+    it in voice_numbers or fax_numbers. Users which accept all numbers ("*") are
+    kept in a separate list. A call is routed with one hash lookup then.
+
+    The rules are the same as in the incoming script: the users are checked in the
+    order of their sections and for each user, voice_numbers are checked before
+    fax_numbers. Voice calls are accepted on both, while fax calls are only
+    accepted on fax_numbers and always handled with the fax service.
+
+    The table is built from the snapshot of the script configuration (see
+    ScriptConfig) and rebuilt by rebuild() after it was reloaded. All methods are
+    static and thread-safe.
+
+    Once the incoming script has set up the table, CapiSuite::callWaiting() also
+    uses it to ignore calls which no user takes before the script is started. As
+    the table is only set up by scripts using it, other incoming scripts still see
+    all calls.
+
+    @author agent
+*/
+class CallRouting
+{
+	public:
+		/** @brief Set the config files and non-user sections to build the table from, build it if needed
+
+		    The table is only built again if the parameters or the script configuration
+		    have changed since it was built.
+
+		    @param files names of the script config files, see ScriptConfig::acquire()
+		    @param ignore sections which don't belong to users (like "GLOBAL")
+		*/
+		static void setup(const vector<string> &files, const vector<string> &ignore);
+
+		/** @brief Build the table again from the current script configuration
+
+		    Does nothing if setup() wasn't called yet.
+		*/
+		static void rebuild();
+
+		/** @brief Find the user responsible for a call
+
+		    @param number the called number
+		    @param service service of the call
+		    @param user set to the responsible user
+		    @param user_service set to the service to handle the call with
+		    @return 1 if a user was found, 0 if no user takes the call, -1 if no valid table was built yet
+		*/
+		static int route(const string &number, Connection::service_t service, string &user, Connection::service_t &user_service);
+
+	private:
+		/** @brief One entry of the table
+		*/
+		class Route
+		{
+			public:
+				unsigned rank; ///< priority of this entry (lower ones are checked first)
+				string user; ///< user taking the call
+				bool fax; ///< true if the number is part of fax_numbers, false for voice_numbers
+		};
+
+		/** @brief The table built from one snapshot of the script configuration
+		*/
+		class Table
+		{
+			public:
+				tr1::unordered_map<string,vector<Route> > numbers; ///< entries for each called number, ordered by rank
+				vector<Route> wildcards; ///< entries of users accepting all numbers, ordered by rank
+				unsigned long generation; ///< generation of the script configuration used
+				bool valid; ///< false if the script configuration contains errors
+		};
+
+		/** @brief Build a new table from the current script configuration
+		*/
+		static Table* build(const vector<string> &files, const vector<string> &ignore);
+
+		/** @brief Add the entries for the numbers given in an option to a table
+		*/
+		static void add(Table *table, const string &value, const Route &route);
+
+		/** @brief Return the first entry in the list which takes calls of the given service, NULL if none
+		*/
+		static const Route* first(const vector<Route> &routes, Connection::service_t service);
+
+		static Table *table; ///< the current table, NULL if setup() wasn't called yet
+		static vector<string> files; ///< config files given to setup()
+		static vector<string> ignore; ///< non-user sections given to setup()
+		static pthread_mutex_t mutex; ///< to realize critical sections in all methods
+};
+
+#endif
@@ -27,8 +27,13 @@
 #include <unistd.h>
 #include "../backend/capi.h"
 #include "../backend/connection.h"
+#include "../backend/promptcache.h"
 #include "incomingscript.h"
 #include "idlescript.h"
+#include "sendjobscript.h"
+#include "jobserver.h"
+#include "scriptconfig.h"
+#include "callrouting.h"
 #include "capisuite.h"
 
 /** @brief Global Pointer to current CapiSuite instance
@@ -49,13 +54,14 @@ void hup_handler(int)
 }
  
 CapiSuite::CapiSuite(int argc,char **argv)
-:capi(NULL),waiting(),config(),idle(NULL),py_state(NULL),debug(NULL),error(NULL),finish_flag(false),custom_configfile(),daemonmode(false)
+:capi(NULL),waiting(),rejected(),config(),idle(NULL),jobserver(NULL),py_state(NULL),debug(NULL),error(NULL),finish_flag(false),reload_flag(false),custom_configfile(),daemonmode(false)
 {
 	if (capisuiteInstance!=NULL) {
 		cerr << "FATAL error: More than one instances of CapiSuite created" << endl;
 		exit(1);
 	}
 	capisuiteInstance=this;
+	pthread_mutex_init(&rejected_mutex,NULL);
 
 	readCommandline(argc,argv);
 	readConfiguration();
@@ -87,6 +93,8 @@ CapiSuite::CapiSuite(int argc,char **argv)
 		    }
 		}
 
+		PromptCache::setLimit(atol(config["prompt_cache_size"].c_str())*1024);
+
 		// backend init
 		capi=new Capi(*debug,debug_level,*error,atoi(config["DDI_length"].c_str()),atoi(config["DDI_base_length"].c_str()),DDIStopList);
 		capi->registerApplicationInterface(this);
@@ -125,6 +133,16 @@ CapiSuite::CapiSuite(int argc,char **argv)
 		if (interval && config["idle_script"]!="")
 			idle=new IdleScript(*debug,debug_level,*error,capi,config["idle_script"],interval,py_state,save_cStringIO);
 
+		// socket for job submission
+		if (config["job_socket"]!="" && config["idle_script"]!="") {
+			try {
+				jobserver=new JobServer(*debug,debug_level,*error,config["job_socket"],config["idle_script"],save_cStringIO);
+			}
+			catch (ApplicationError e) {
+				(*error) << prefix() << "Warning: job socket disabled. The given error message was: " << e << endl;
+			}
+		}
+
 		// signal handling
 		signal(SIGTERM,exit_handler);
 		signal(SIGINT,exit_handler);  // this must be located after pyhton initialization
@@ -135,6 +153,8 @@ CapiSuite::CapiSuite(int argc,char **argv)
 		if (idle) {
 			idle->requestTerminate();
 		}
+		if (jobserver)
+			jobserver->requestTerminate();
 		if (py_state) {
 			PyEval_RestoreThread(py_state); // switch to right thread context, acquire lock
 			py_state=NULL;
@@ -150,6 +170,8 @@ CapiSuite::CapiSuite(int argc,char **argv)
 		if (idle) {
 			idle->requestTerminate();
 		}
+		if (jobserver)
+			jobserver->requestTerminate();
 		if (py_state) {
 			PyEval_RestoreThread(py_state); // switch to right thread context, acquire lock
 			py_state=NULL;
@@ -166,6 +188,8 @@ CapiSuite::~CapiSuite()
 {
 	if (idle)
 		idle->requestTerminate(); // will self-delete!
+	if (jobserver)
+		jobserver->requestTerminate(); // will self-delete!
 
 	// thread-safe shutdown of the Python interpreter (taken out of PyApache 4.26)
 	if (py_state) {
@@ -174,6 +198,8 @@ CapiSuite::~CapiSuite()
 		Py_Finalize();
 	}
 
+	deleteRejected(true);
+	pthread_mutex_destroy(&rejected_mutex);
 	delete capi;
 
 	(*debug) << prefix() << "CapiSuite finished." << endl;
@@ -195,6 +221,7 @@ void CapiSuite::reload()
 {
 	if (debug_level >= 2)
 		(*debug) << prefix() << "requested reload" << endl;
+	reload_flag=true; // config files are re-read in mainLoop(), we may be in a signal handler
 	if (idle)
 		idle->activate();
 }
@@ -202,18 +229,75 @@ void CapiSuite::reload()
 void
 CapiSuite::callWaiting (Connection *conn)
 {
+	// calls which no user takes are ignored here, so they don't need a thread and an interpreter
+	string user;
+	Connection::service_t user_service;
+	if (!CallRouting::route(conn->getCalledPartyNumber(),conn->getService(),user,user_service)) {
+		try {
+			conn->rejectWaiting(1); // ignore call, like the incoming script does
+			if (debug_level >= 1)
+				(*debug) << prefix() << "call from " << conn->getCallingPartyNumber() << " to " << conn->getCalledPartyNumber() << " ignoring, no user takes it" << endl;
+			pthread_mutex_lock(&rejected_mutex);
+			rejected.push_back(conn); // will be deleted in mainLoop() when it's down
+			pthread_mutex_unlock(&rejected_mutex);
+			return;
+		}
+		catch (CapiError e) {
+			(*error) << prefix() << "ERROR: can't reject call, passing it to the incoming script. Message was: " << e << endl;
+		}
+	}
 	waiting.push(conn);
 }
 
+void
+CapiSuite::deleteRejected(bool all)
+{
+	pthread_mutex_lock(&rejected_mutex);
+	list<Connection*>::iterator it=rejected.begin();
+	while (it!=rejected.end()) {
+		if (all || (*it)->getState()==Connection::DOWN) {
+			delete *it;
+			it=rejected.erase(it);
+		} else
+			it++;
+	}
+	pthread_mutex_unlock(&rejected_mutex);
+}
+
+int
+CapiSuite::startSendJob(const vector<_cdword> &controllers, string user, string job) throw (ApplicationError)
+{
+	int ret=SendJobScript::start(*debug,debug_level,*error,capi,controllers,user,job,config["idle_script"],save_cStringIO);
+	if (ret>0 && debug_level >= 2)
+		(*debug) << prefix() << "started job " << job << ", " << SendJobScript::running() << " job(s) running" << endl;
+	return ret;
+}
+
+void
+CapiSuite::watchQueue(string dir) throw (ApplicationError)
+{
+	if (idle)
+		idle->watch(dir);
+}
+
 void
 CapiSuite::mainLoop()
 {
 	timespec delay_time;
 	delay_time.tv_sec=0; delay_time.tv_nsec=100000000;  // 100 msec
-	int count,errorcount=0;
+	int count=0,errorcount=0;
 	while (!finish_flag) {
 		nanosleep(&delay_time,NULL);
 		count++;
+		if (count%10==0) // delete the rejected connections once a second
+			deleteRejected(false);
+		if (reload_flag) {
+			reload_flag=false;
+			ScriptConfig::reload();
+			CallRouting::rebuild();
+			if (debug_level >= 2)
+				(*debug) << prefix() << "script configuration reloaded" << endl;
+		}
 		while (waiting.size()) {
 			Connection* conn=waiting.front();
 			waiting.pop();
@@ -316,12 +400,14 @@ CapiSuite::readConfiguration()
 	checkOption("incoming_script",string(PKGLIBDIR)+"/incoming.py");
 	checkOption("idle_script",string(PKGLIBDIR)+"idle.py");
 	checkOption("idle_script_interval","60");
+	checkOption("job_socket",string(LOCALSTATEDIR)+"/run/capisuite.sock");
 	checkOption("log_file",string(LOCALSTATEDIR)+"/log/capisuite.log");
 	checkOption("log_level","2");
 	checkOption("log_error",string(LOCALSTATEDIR)+"/log/capisuite.error");
 	checkOption("DDI_length","0");
 	checkOption("DDI_base_length","0");
 	checkOption("DDI_stop_numbers","");
+	checkOption("prompt_cache_size","2048");
 	
 	string t(config["idle_script_interval"]);
 	for (int i=0;i<t.size();i++)
@@ -366,6 +452,11 @@ CapiSuite::readConfiguration()
 	for (int i=0;i<t.size();i++)
                 if ((t[i]<'0' || t[i]>'9') && t[i]!=',')
                         throw ApplicationError("Invalid DDI_stop_numbers given.","readConfiguration()");
+
+	t=config["prompt_cache_size"];
+	for (int i=0;i<t.size();i++)
+		if (t[i]<'0' || t[i]>'9')
+			throw ApplicationError("Invalid prompt_cache_size given.","readConfiguration()");
 			
 	if (daemonmode) {
 		if (debug==&cout) {
@@ -20,12 +20,17 @@
 #include <Python.h>
 #include <map>
 #include <queue>
+#include <vector>
+#include <list>
+#include <pthread.h>
 #include <fstream>
+#include <capi20.h>
 #include "../backend/applicationinterface.h"
 #include "applicationexception.h"
 #include "capisuitemodule.h"
 class Capi;
 class IdleScript;
+class JobServer;
 class PycStringIO_CAPI;
 
 /** @brief Main application class, implements ApplicationInterface
@@ -66,9 +71,35 @@ class CapiSuite: public ApplicationInterface
 		~CapiSuite();
 
 		/** @brief Callback: enqueue Connection in waiting
+
+		    Calls to numbers which no user takes are ignored immediately if the incoming
+		    script uses the routing table (see CallRouting), so no thread and interpreter
+		    are needed for them.
 	   	*/
   		virtual void callWaiting (Connection *conn);
 
+		/** @brief Start sending a job of the send queue in an own thread
+
+		    The job is sent by the function sendJob() of the idle script which is called in
+		    an own thread, so several jobs can be sent in parallel. See SendJobScript for details.
+
+		    @param controllers controllers which may be used for the job, all if empty
+		    @param user owner of the job
+		    @param job name of the job (usually its control file)
+		    @return 1 if the job was started, 0 if no B channel is free on these controllers, -1 if the job is already running
+		    @throw ApplicationError Thrown if the thread can't be started
+		*/
+		int startSendJob(const vector<_cdword> &controllers, string user, string job) throw (ApplicationError);
+
+		/** @brief Start the idle script immediately when a new job appears in the given directory
+
+		    See IdleScript::watch(). Does nothing if no idle script is used.
+
+		    @param dir directory to watch, usually a send queue
+		    @throw ApplicationError Thrown if the directory can't be watched
+		*/
+		void watchQueue(string dir) throw (ApplicationError);
+
 		/** @brief Main Loop. Event Loop (handling incoming connections)
 
 		    For each incoming connection, an object of IncomingScript is created
@@ -110,7 +141,8 @@ class CapiSuite: public ApplicationInterface
 
 		/** @brief restart some aspects if the process gets a SIGHUP
 
-		    Currently, this only reactivates the idle script if it was deactivated by too much errors in a row.
+		    Reactivates the idle script if it was deactivated by too much errors in a row
+		    and requests mainLoop() to re-read the script configuration (see ScriptConfig).
 		*/
 		void reload();
 
@@ -145,8 +177,17 @@ class CapiSuite: public ApplicationInterface
   		*/
 		void checkOption(string key, string value);
 
+		/** @brief Delete the connections rejected by callWaiting() which are down
+
+		    @param all delete all rejected connections, even if they're not down yet
+		*/
+		void deleteRejected(bool all);
+
 		queue <Connection*> waiting; ///< queue for waiting connection instances
+		list <Connection*> rejected; ///< connections rejected by callWaiting(), waiting for their disconnection
+		pthread_mutex_t rejected_mutex; ///< to protect rejected, which is used from the CAPI thread
 		IdleScript *idle; ///< reference to the IdleScript object created
+		JobServer *jobserver; ///< reference to the JobServer object created, NULL if the job socket isn't used
 
 		PyThreadState *py_state; ///< saves the created thread state of the main python interpreter
 		PycStringIO_CAPI* save_cStringIO; ///< holds a pointer to the Python cStringIO C API
@@ -158,6 +199,8 @@ class CapiSuite: public ApplicationInterface
 
 		bool finish_flag; ///< flag to finish mainLoop()
 
+		bool reload_flag; ///< flag to re-read the script configuration in mainLoop()
+
 		bool daemonmode; ///< flag set when we're running as daemon
 
 		map<string,string> config; ///< holds the configuration read from the configfile
@@ -16,10 +16,17 @@
 
 #include <Python.h>
 #include <string>
+#include <map>
+#include <pthread.h>
 #include <unistd.h> // for sleep()
+#include "../backend/capi.h"
 #include "../backend/connection.h"
 #include "../modules/audiosend.h"
 #include "../modules/audioreceive.h"
+#include "../modules/audiostreamsend.h"
+#include "../modules/audiostreamreceive.h"
+#include "../modules/audiosendreceive.h"
+#include "../modules/callbridge.h"
 #include "../modules/faxreceive.h"
 #include "../modules/faxsend.h"
 #include "../modules/connectmodule.h"
@@ -29,8 +36,16 @@
 #include "../modules/calloutgoing.h"
 #include "capisuitemodule.h"   
 #include "capisuite.h"
+#include "audioconvert.h"
+#include "faxconvert.h"
+#include "jobschedule.h"
+#include "jobcounter.h"
+#include "scriptconfig.h"
+#include "callrouting.h"
+#include "sendjobscript.h"
 
 #define TEMPORARY_FAILURE 0x34A9    // see ETS 300 102-1, Table 4.13 (cause information element)
+#define NO_CHANNEL_AVAILABLE 0x34A2 // see ETS 300 102-1, Table 4.13 (cause information element)
 
 extern CapiSuite* capisuiteInstance;
 
@@ -97,6 +112,72 @@ convertConnRef(PyObject *conn_ref, Connection** conn)
 	return 1;
 }
 
+/** @brief Private converter function to get a list of controllers from a python int or sequence of ints
+
+    0 and empty sequences stand for all controllers, so the list is empty then.
+    This function is defined for the use in PyArg_ParseTuple() calls.
+
+    @param arg - python int or sequence of ints
+    @param controllers address of the vector where the controllers will be stored
+    @return 1=successful, 0=error
+*/
+bool
+convertControllers(PyObject *arg, vector<_cdword>* controllers)
+{
+	if (PyInt_Check(arg)) {
+		if (PyInt_AsLong(arg)>0)
+			controllers->push_back(PyInt_AsLong(arg));
+		return 1;
+	}
+	PyObject *seq=PySequence_Fast(arg,"controller must be an int or a sequence of ints");
+	if (!seq)
+		return 0;
+	for (int i=0;i<PySequence_Fast_GET_SIZE(seq);i++) {
+		PyObject *item=PySequence_Fast_GET_ITEM(seq,i);
+		if (!PyInt_Check(item)) {
+			Py_DECREF(seq);
+			PyErr_SetString(PyExc_TypeError,"controller must be an int or a sequence of ints");
+			return 0;
+		}
+		if (PyInt_AsLong(item)>0)
+			controllers->push_back(PyInt_AsLong(item));
+	}
+	Py_DECREF(seq);
+	return 1;
+}
+
+/** @brief Private converter function to get a list of file names from a python sequence of strings
+
+    A single string isn't accepted, as it would be taken as a sequence of one-letter file names.
+    This function is defined for the use in PyArg_ParseTuple() calls.
+
+    @param arg - python sequence of strings
+    @param files address of the vector where the file names will be stored
+    @return 1=successful, 0=error
+*/
+bool
+convertFileNames(PyObject *arg, vector<string>* files)
+{
+	if (PyString_Check(arg)) {
+		PyErr_SetString(PyExc_TypeError,"file names must be given as a sequence of strings");
+		return 0;
+	}
+	PyObject *seq=PySequence_Fast(arg,"file names must be given as a sequence of strings");
+	if (!seq)
+		return 0;
+	for (int i=0;i<PySequence_Fast_GET_SIZE(seq);i++) {
+		PyObject *item=PySequence_Fast_GET_ITEM(seq,i);
+		if (!PyString_Check(item)) {
+			Py_DECREF(seq);
+			PyErr_SetString(PyExc_TypeError,"file names must be given as a sequence of strings");
+			return 0;
+		}
+		files->push_back(PyString_AsString(item));
+	}
+	Py_DECREF(seq);
+	return 1;
+}
+
 /** @brief Private converter function to extract the contained Capi* from a PyCObject
 
     This function is defined for the use in PyArg_ParseTuple() calls.
@@ -119,6 +200,49 @@ convertCapiRef(PyObject *capi_ref, Capi** capi)
 	}
 	return 1;
 }
+
+/** @brief Private FaxReceive variant calling a python function for each received page
+
+    The module runs w/o holding the python lock, so it's acquired for each call of the
+    progress function.
+*/
+class PyFaxReceive: public FaxReceive
+{
+	public:
+		/** @brief Constructor. See FaxReceive::FaxReceive() for details.
+
+		    @param conn reference to Connection object
+		    @param file name of file to save the fax to
+		    @param progress python function to call for each page, NULL for none
+		    @param save address of the thread state saved by Py_UNBLOCK_THREADS
+		*/
+		PyFaxReceive(Connection *conn, string file, PyObject *progress, PyThreadState **save) throw (CapiWrongState,CapiExternalError)
+		:FaxReceive(conn,file),progress(progress),save(save)
+		{}
+
+		/** @brief log the page and call the python function
+
+		    @param pages number of pages received completely so far
+		*/
+		void pageReceived(unsigned pages)
+		{
+			FaxReceive::pageReceived(pages);
+			if (!progress)
+				return;
+			PyEval_RestoreThread(*save);
+			char format[]="(ik)"; // Python 2 takes char*, a literal would give a -Wwrite-strings warning
+			PyObject *r=PyObject_CallFunction(progress,format,pages,conn->getFaxIndex()->bytes());
+			if (r)
+				Py_DECREF(r);
+			else
+				PyErr_Print();
+			*save=PyEval_SaveThread();
+		}
+
+	private:
+		PyObject *progress; ///< python function to call for each page
+		PyThreadState **save; ///< thread state saved when the python lock was released
+};
                           
 /** @brief Write an informational message to the CapiSuite log.
     @ingroup python
@@ -185,6 +309,266 @@ capisuite_error(PyObject*, PyObject *args)
 	return (Py_None);
 }
 
+/** @brief Convert a received audio file to WAV.
+    @ingroup python
+
+    Converts a file in bit-reversed A-Law format (as saved by capisuite_audio_receive()) to a WAV file
+    with 16 bit linear PCM, 8 kHz, mono. The conversion is done in memory, so no external tool like sox is needed.
+
+    If no output file is given, the WAV data is returned, e.g. to attach it to a mail w/o creating a temporary file.
+
+    @param args Contains the python parameters. These are:
+    	- <b>infile (string)</b> the A-Law file to convert
+    	- <b>outfile (string, optional)</b> where to save the WAV file
+    @return None if outfile was given, string containing the WAV data otherwise
+*/
+static PyObject*
+capisuite_la2wav(PyObject*, PyObject *args)
+{
+	char *infile, *outfile=NULL;
+	PyThreadState *_save;
+	string wav;
+
+	if (!PyArg_ParseTuple(args,"s|s:la2wav",&infile,&outfile))
+		return NULL;
+
+	try {
+		Py_UNBLOCK_THREADS
+		wav=AudioConvert::la2wav(AudioConvert::readAudioFile(infile));
+		if (outfile)
+			AudioConvert::writeFile(outfile,wav);
+		Py_BLOCK_THREADS
+	}
+	catch (ApplicationError e) {
+		Py_BLOCK_THREADS
+		PyErr_SetString(PyExc_IOError,(e.message()).c_str());
+		return NULL;
+	}
+
+	if (outfile) {
+		Py_XINCREF(Py_None);
+		return (Py_None);
+	}
+	return PyString_FromStringAndSize(wav.data(),wav.size());
+}
+
+/** @brief Convert audio data from A-Law to linear PCM.
+    @ingroup python
+
+    @param args Contains the python parameters. These are:
+    	- <b>data (string)</b> audio data in bit-reversed A-Law format
+    @return string containing signed 16 bit samples in little endian byte order
+*/
+static PyObject*
+capisuite_la2pcm(PyObject*, PyObject *args)
+{
+	char *data;
+	int length;
+
+	if (!PyArg_ParseTuple(args,"s#:la2pcm",&data,&length))
+		return NULL;
+
+	string pcm=AudioConvert::la2pcm(string(data,length));
+	return PyString_FromStringAndSize(pcm.data(),pcm.size());
+}
+
+/** @brief Convert a received fax file to TIFF.
+    @ingroup python
+
+    Converts a file in Structured Fax File format (as saved by capisuite_fax_receive()) to a multi-page TIFF
+    Class F file. The MH coded lines are copied w/o decoding, so this is much cheaper than calling sfftobmp.
+
+    @param args Contains the python parameters. These are:
+    	- <b>infile (string)</b> the SFF file to convert
+    	- <b>outfile (string)</b> where to save the TIFF file
+    @return None
+*/
+static PyObject*
+capisuite_sff2tiff(PyObject*, PyObject *args)
+{
+	char *infile, *outfile;
+	PyThreadState *_save;
+
+	if (!PyArg_ParseTuple(args,"ss:sff2tiff",&infile,&outfile))
+		return NULL;
+
+	try {
+		Py_UNBLOCK_THREADS
+		AudioConvert::writeFile(outfile,FaxConvert::sff2tiff(AudioConvert::readFile(infile)));
+		Py_BLOCK_THREADS
+	}
+	catch (ApplicationError e) {
+		Py_BLOCK_THREADS
+		PyErr_SetString(PyExc_IOError,(e.message()).c_str());
+		return NULL;
+	}
+
+	Py_XINCREF(Py_None);
+	return (Py_None);
+}
+
+/** @brief Convert a received fax file to PDF.
+    @ingroup python
+
+    Converts a file in Structured Fax File format (as saved by capisuite_fax_receive()) to a PDF file. Each page
+    is embedded as CCITT coded image w/o decoding it, so no external tools like sfftobmp, tiff2pdf or ghostscript
+    are needed.
+
+    If no output file is given, the PDF data is returned, e.g. to attach it to a mail w/o creating a temporary file.
+
+    @param args Contains the python parameters. These are:
+    	- <b>infile (string)</b> the SFF file to convert
+    	- <b>outfile (string, optional)</b> where to save the PDF file
+    @return None if outfile was given, string containing the PDF data otherwise
+*/
+static PyObject*
+capisuite_sff2pdf(PyObject*, PyObject *args)
+{
+	char *infile, *outfile=NULL;
+	PyThreadState *_save;
+	string pdf;
+
+	if (!PyArg_ParseTuple(args,"s|s:sff2pdf",&infile,&outfile))
+		return NULL;
+
+	try {
+		Py_UNBLOCK_THREADS
+		pdf=FaxConvert::sff2pdf(AudioConvert::readFile(infile));
+		if (outfile)
+			AudioConvert::writeFile(outfile,pdf);
+		Py_BLOCK_THREADS
+	}
+	catch (ApplicationError e) {
+		Py_BLOCK_THREADS
+		PyErr_SetString(PyExc_IOError,(e.message()).c_str());
+		return NULL;
+	}
+
+	if (outfile) {
+		Py_XINCREF(Py_None);
+		return (Py_None);
+	}
+	return PyString_FromStringAndSize(pdf.data(),pdf.size());
+}
+
+/** @brief Convert a received color fax file to PDF.
+    @ingroup python
+
+    Converts a file in CFF format (concatenated JPEG images, as saved by capisuite_fax_receive() for color faxes)
+    to a PDF file. The JPEG images are embedded w/o decompressing them, so no external tools like jpeg2ps or
+    ghostscript are needed.
+
+    If no output file is given, the PDF data is returned, e.g. to attach it to a mail w/o creating a temporary file.
+
+    @param args Contains the python parameters. These are:
+    	- <b>infile (string)</b> the CFF file to convert
+    	- <b>outfile (string, optional)</b> where to save the PDF file
+    @return None if outfile was given, string containing the PDF data otherwise
+*/
+static PyObject*
+capisuite_cff2pdf(PyObject*, PyObject *args)
+{
+	char *infile, *outfile=NULL;
+	PyThreadState *_save;
+	string pdf;
+
+	if (!PyArg_ParseTuple(args,"s|s:cff2pdf",&infile,&outfile))
+		return NULL;
+
+	try {
+		Py_UNBLOCK_THREADS
+		pdf=FaxConvert::cff2pdf(AudioConvert::readFile(infile));
+		if (outfile)
+			AudioConvert::writeFile(outfile,pdf);
+		Py_BLOCK_THREADS
+	}
+	catch (ApplicationError e) {
+		Py_BLOCK_THREADS
+		PyErr_SetString(PyExc_IOError,(e.message()).c_str());
+		return NULL;
+	}
+
+	if (outfile) {
+		Py_XINCREF(Py_None);
+		return (Py_None);
+	}
+	return PyString_FromStringAndSize(pdf.data(),pdf.size());
+}
+
+/** @brief Remove the first pages from a fax file.
+    @ingroup python
+
+    Creates a copy of a file in Structured Fax File format which starts with the given page. The pages
+    are copied w/o decoding them, so this is suitable to resend the rest of an interrupted fax w/o
+    converting the document again.
+
+    @param args Contains the python parameters. These are:
+    	- <b>infile (string)</b> the SFF file to read
+    	- <b>outfile (string)</b> where to save the new SFF file
+    	- <b>first_page (integer)</b> number of the first page to copy, starting with 0
+    @return None
+*/
+static PyObject*
+capisuite_sff_slice(PyObject*, PyObject *args)
+{
+	char *infile, *outfile;
+	int first_page;
+	PyThreadState *_save;
+
+	if (!PyArg_ParseTuple(args,"ssi:sff_slice",&infile,&outfile,&first_page))
+		return NULL;
+
+	if (first_page<0) {
+		PyErr_SetString(PyExc_ValueError,"first_page must not be negative");
+		return NULL;
+	}
+
+	try {
+		Py_UNBLOCK_THREADS
+		AudioConvert::writeFile(outfile,FaxConvert::sffSlice(AudioConvert::readFile(infile),first_page));
+		Py_BLOCK_THREADS
+	}
+	catch (ApplicationError e) {
+		Py_BLOCK_THREADS
+		PyErr_SetString(PyExc_IOError,(e.message()).c_str());
+		return NULL;
+	}
+
+	Py_XINCREF(Py_None);
+	return (Py_None);
+}
+
+/** @brief Count the pages of a fax file.
+    @ingroup python
+
+    @param args Contains the python parameters. These are:
+    	- <b>infile (string)</b> the SFF file to read
+    @return number of pages
+*/
+static PyObject*
+capisuite_sff_pages(PyObject*, PyObject *args)
+{
+	char *infile;
+	unsigned pages;
+	PyThreadState *_save;
+
+	if (!PyArg_ParseTuple(args,"s:sff_pages",&infile))
+		return NULL;
+
+	try {
+		Py_UNBLOCK_THREADS
+		pages=FaxConvert::sffPages(AudioConvert::readFile(infile));
+		Py_BLOCK_THREADS
+	}
+	catch (ApplicationError e) {
+		Py_BLOCK_THREADS
+		PyErr_SetString(PyExc_IOError,(e.message()).c_str());
+		return NULL;
+	}
+
+	return Py_BuildValue("i",pages);
+}
+
 /** @brief Send an audio file in a speech mode connection.
     @ingroup python
 
@@ -201,25 +585,496 @@ capisuite_error(PyObject*, PyObject *args)
     	- <b>call</b> Reference to the current call
     	- <b>filename (string)</b> file to send
     	- <b>exit_DTMF (integer, optional)</b> if set to 1, sending is aborted when a DTMF signal is received (0=off, default)
+    	- <b>cache (integer, optional)</b> if set to 0, the file isn't added to the announcement cache, use this for files played only once (1=on, default)
+    @return int containing duration of send in seconds
+*/
+static PyObject*
+capisuite_audio_send(PyObject*, PyObject *args)
+{
+	Connection* conn;
+	char *filename;
+	PyThreadState *_save;
+	int exit_DTMF=0, cache=1;
+	long duration=0;
+
+	if (!PyArg_ParseTuple(args,"O&s|ii:audio_send",convertConnRef,&conn,&filename,&exit_DTMF,&cache))
+		return NULL;
+
+	try {
+		Py_UNBLOCK_THREADS
+		AudioSend active(conn,filename,exit_DTMF,cache);
+		active.mainLoop();
+		duration=active.duration();
+		Py_BLOCK_THREADS
+	}
+	catch (CapiWrongState e) {
+		Py_BLOCK_THREADS
+		PyErr_SetString(CallGoneError,"Call was finished from partner.");
+		return NULL;
+	}
+	catch (CapiMsgError e) {
+		Py_BLOCK_THREADS
+		PyErr_SetString(BackendError,(e.message()).c_str());
+		return NULL;
+	}
+	catch (CapiExternalError e) {
+		Py_BLOCK_THREADS
+		PyErr_SetString(BackendError,(e.message()).c_str());
+		return NULL;
+	}
+	catch (CapiError e) {
+		Py_BLOCK_THREADS
+		PyErr_SetString(BackendError,(e.message()).c_str());
+		return NULL;
+	}
+
+	PyObject *r=PyInt_FromLong(duration);
+	return (r);
+}
+
+/** @brief Send several audio files in a row in a speech mode connection.
+    @ingroup python
+
+    This function sends a list of audio files as one transmission. The files are played w/o gaps between them,
+    so this should be used for announcements which are put together from several snippets (e.g. numbers).
+    The audio files must be in bit-inversed A-Law format (".la" for sox).
+
+    DTMF abort works as in capisuite_audio_send() and aborts the whole sequence.
+
+    The connction must be in audio mode (use capisuite_connect_voice()), otherwise an exception will be caused.
+
+    @param args Contains the python parameters. These are:
+    	- <b>call</b> Reference to the current call
+    	- <b>filenames (sequence of strings)</b> files to send
+    	- <b>exit_DTMF (integer, optional)</b> if set to 1, sending is aborted when a DTMF signal is received (0=off, default)
     @return int containing duration of send in seconds
 */
 static PyObject*
-capisuite_audio_send(PyObject*, PyObject *args)
+capisuite_audio_send_sequence(PyObject*, PyObject *args)
+{
+	Connection* conn;
+	vector<string> files;
+	PyThreadState *_save;
+	int exit_DTMF=0;
+	long duration=0;
+
+	if (!PyArg_ParseTuple(args,"O&O&|i:audio_send_sequence",convertConnRef,&conn,convertFileNames,&files,&exit_DTMF))
+		return NULL;
+
+	try {
+		Py_UNBLOCK_THREADS
+		AudioSend active(conn,files,exit_DTMF);
+		active.mainLoop();
+		duration=active.duration();
+		Py_BLOCK_THREADS
+	}
+	catch (CapiWrongState e) {
+		Py_BLOCK_THREADS
+		PyErr_SetString(CallGoneError,"Call was finished from partner.");
+		return NULL;
+	}
+	catch (CapiMsgError e) {
+		Py_BLOCK_THREADS
+		PyErr_SetString(BackendError,(e.message()).c_str());
+		return NULL;
+	}
+	catch (CapiExternalError e) {
+		Py_BLOCK_THREADS
+		PyErr_SetString(BackendError,(e.message()).c_str());
+		return NULL;
+	}
+	catch (CapiError e) {
+		Py_BLOCK_THREADS
+		PyErr_SetString(BackendError,(e.message()).c_str());
+		return NULL;
+	}
+
+	PyObject *r=PyInt_FromLong(duration);
+	return (r);
+}
+
+/** @brief Start sending audio data which is given in memory in a speech mode connection.
+    @ingroup python
+
+    After this, the data is given with capisuite_audio_stream_write(). When all data was given,
+    capisuite_audio_stream_finish() must be called. This allows to play generated audio (e.g. from a TTS
+    engine) without writing it to a temporary file first.
+
+    The connction must be in audio mode (use capisuite_connect_voice()), otherwise an exception will be caused.
+
+    @param args Contains the python parameters. These are:
+    	- <b>call</b> Reference to the current call
+    @return None
+*/
+static PyObject*
+capisuite_audio_stream_start(PyObject*, PyObject *args)
+{
+	Connection* conn;
+
+	if (!PyArg_ParseTuple(args,"O&:audio_stream_start",convertConnRef,&conn))
+		return NULL;
+
+	try {
+		if (conn->getService()!=Connection::VOICE)
+	 		throw CapiExternalError("Connection not in speech mode","capisuite_audio_stream_start()");
+		conn->start_stream_transmission();
+	}
+	catch (CapiWrongState e) {
+		PyErr_SetString(CallGoneError,"Call was finished from partner.");
+		return NULL;
+	}
+	catch (CapiExternalError e) {
+		PyErr_SetString(BackendError,(e.message()).c_str());
+		return NULL;
+	}
+
+	Py_XINCREF(Py_None);
+	return (Py_None);
+}
+
+/** @brief Give audio data to a stream transmission.
+    @ingroup python
+
+    The data is sent as soon as the B channel permits. If the stream buffer is full, this function waits until
+    enough data was sent, so the script automatically produces the data at the speed it's played.
+
+    The data must be in bit-inversed A-Law format. If DTMF abort is enabled, the function returns as soon as
+    DTMF is received (or immediately if DTMF was received before). The stream is not stopped then.
+
+    If the call is finished before all data was accepted, CallGoneError is raised.
+
+    @param args Contains the python parameters. These are:
+    	- <b>call</b> Reference to the current call
+    	- <b>data (string)</b> the audio data to send
+    	- <b>exit_DTMF (integer, optional)</b> if set to 1, writing is aborted when a DTMF signal is received (0=off, default)
+    @return int containing the number of bytes which were accepted
+*/
+static PyObject*
+capisuite_audio_stream_write(PyObject*, PyObject *args)
+{
+	Connection* conn;
+	char *data;
+	int length;
+	PyThreadState *_save;
+	int exit_DTMF=0;
+	unsigned long written=0;
+
+	if (!PyArg_ParseTuple(args,"O&s#|i:audio_stream_write",convertConnRef,&conn,&data,&length,&exit_DTMF))
+		return NULL;
+
+	try {
+		string buffer(data,length); // copy it as we release the interpreter lock
+		Py_UNBLOCK_THREADS
+		AudioStreamSend active(conn,buffer,false,exit_DTMF);
+		active.mainLoop();
+		written=active.written();
+		Py_BLOCK_THREADS
+	}
+	catch (CapiWrongState e) {
+		Py_BLOCK_THREADS
+		PyErr_SetString(CallGoneError,"Call was finished from partner.");
+		return NULL;
+	}
+	catch (CapiMsgError e) {
+		Py_BLOCK_THREADS
+		PyErr_SetString(BackendError,(e.message()).c_str());
+		return NULL;
+	}
+	catch (CapiExternalError e) {
+		Py_BLOCK_THREADS
+		PyErr_SetString(BackendError,(e.message()).c_str());
+		return NULL;
+	}
+	catch (CapiError e) {
+		Py_BLOCK_THREADS
+		PyErr_SetString(BackendError,(e.message()).c_str());
+		return NULL;
+	}
+
+	PyObject *r=PyInt_FromLong(written);
+	return (r);
+}
+
+/** @brief Finish a stream transmission.
+    @ingroup python
+
+    Waits until all data given with capisuite_audio_stream_write() was sent and stops the stream. If DTMF abort
+    is enabled, the stream is stopped immediately when DTMF is received.
+
+    @param args Contains the python parameters. These are:
+    	- <b>call</b> Reference to the current call
+    	- <b>exit_DTMF (integer, optional)</b> if set to 1, sending is aborted when a DTMF signal is received (0=off, default)
+    @return None
+*/
+static PyObject*
+capisuite_audio_stream_finish(PyObject*, PyObject *args)
+{
+	Connection* conn;
+	PyThreadState *_save;
+	int exit_DTMF=0;
+
+	if (!PyArg_ParseTuple(args,"O&|i:audio_stream_finish",convertConnRef,&conn,&exit_DTMF))
+		return NULL;
+
+	try {
+		Py_UNBLOCK_THREADS
+		AudioStreamSend active(conn,"",true,exit_DTMF);
+		active.mainLoop();
+		conn->stop_file_transmission();
+		Py_BLOCK_THREADS
+	}
+	catch (CapiWrongState e) {
+		Py_BLOCK_THREADS
+		PyErr_SetString(CallGoneError,"Call was finished from partner.");
+		return NULL;
+	}
+	catch (CapiMsgError e) {
+		Py_BLOCK_THREADS
+		PyErr_SetString(BackendError,(e.message()).c_str());
+		return NULL;
+	}
+	catch (CapiExternalError e) {
+		Py_BLOCK_THREADS
+		PyErr_SetString(BackendError,(e.message()).c_str());
+		return NULL;
+	}
+	catch (CapiError e) {
+		Py_BLOCK_THREADS
+		PyErr_SetString(BackendError,(e.message()).c_str());
+		return NULL;
+	}
+
+	Py_XINCREF(Py_None);
+	return (Py_None);
+}
+
+/** @brief Start receiving audio data to memory in a speech mode connection.
+    @ingroup python
+
+    From now on, the received audio data is collected and can be read with capisuite_audio_stream_read().
+    If the script doesn't read the data fast enough, the reception is slowed down by holding back the
+    confirmations to the CAPI. Call capisuite_audio_stream_receive_stop() to finish.
+
+    @param args Contains the python parameters. These are:
+    	- <b>call</b> Reference to the current call
+    @return None
+*/
+static PyObject*
+capisuite_audio_stream_receive_start(PyObject*, PyObject *args)
+{
+	Connection* conn;
+
+	if (!PyArg_ParseTuple(args,"O&:audio_stream_receive_start",convertConnRef,&conn))
+		return NULL;
+
+	try {
+		if (conn->getService()!=Connection::VOICE)
+	 		throw CapiExternalError("Connection not in speech mode","capisuite_audio_stream_receive_start()");
+		conn->start_stream_reception();
+	}
+	catch (CapiWrongState e) {
+		PyErr_SetString(CallGoneError,"Call was finished from partner.");
+		return NULL;
+	}
+	catch (CapiExternalError e) {
+		PyErr_SetString(BackendError,(e.message()).c_str());
+		return NULL;
+	}
+
+	Py_XINCREF(Py_None);
+	return (Py_None);
+}
+
+/** @brief Read received audio data.
+    @ingroup python
+
+    Returns the audio data received since the last call. If no data is available, it waits until data
+    arrives or the timeout is reached.
+
+    The data is in bit-inversed A-Law format. If DTMF abort is enabled, the function returns an empty
+    string as soon as DTMF is received (or immediately if DTMF was received before).
+
+    @param args Contains the python parameters. These are:
+    	- <b>call</b> Reference to the current call
+    	- <b>maxlength (integer)</b> maximum number of bytes to return (at most 8192 are returned per call)
+    	- <b>timeout (integer)</b> timeout in seconds to wait for data (-1 = infinite, 0 = don't wait)
+    	- <b>exit_DTMF (integer, optional)</b> if set to 1, reading is aborted when a DTMF signal is received (0=off, default)
+    @return string containing the data (empty if no data is available)
+*/
+static PyObject*
+capisuite_audio_stream_read(PyObject*, PyObject *args)
+{
+	Connection* conn;
+	PyThreadState *_save;
+	int maxlength, timeout, exit_DTMF=0;
+	string data;
+
+	if (!PyArg_ParseTuple(args,"O&ii|i:audio_stream_read",convertConnRef,&conn,&maxlength,&timeout,&exit_DTMF))
+		return NULL;
+
+	if (maxlength<=0) {
+		PyErr_SetString(PyExc_ValueError,"maxlength must be positive.");
+		return NULL;
+	}
+
+	try {
+		Py_UNBLOCK_THREADS
+		AudioStreamReceive active(conn,maxlength,timeout,exit_DTMF);
+		active.mainLoop();
+		data=active.getData();
+		Py_BLOCK_THREADS
+	}
+	catch (CapiWrongState e) {
+		Py_BLOCK_THREADS
+		PyErr_SetString(CallGoneError,"Call was finished from partner.");
+		return NULL;
+	}
+	catch (CapiMsgError e) {
+		Py_BLOCK_THREADS
+		PyErr_SetString(BackendError,(e.message()).c_str());
+		return NULL;
+	}
+	catch (CapiExternalError e) {
+		Py_BLOCK_THREADS
+		PyErr_SetString(BackendError,(e.message()).c_str());
+		return NULL;
+	}
+	catch (CapiError e) {
+		Py_BLOCK_THREADS
+		PyErr_SetString(BackendError,(e.message()).c_str());
+		return NULL;
+	}
+
+	PyObject *r=PyString_FromStringAndSize(data.data(),data.size());
+	return (r);
+}
+
+/** @brief Stop receiving audio data to memory.
+    @ingroup python
+
+    Data which wasn't read yet is discarded.
+
+    @param args Contains the python parameters. These are:
+    	- <b>call</b> Reference to the current call
+    @return None
+*/
+static PyObject*
+capisuite_audio_stream_receive_stop(PyObject*, PyObject *args)
+{
+	Connection* conn;
+
+	if (!PyArg_ParseTuple(args,"O&:audio_stream_receive_stop",convertConnRef,&conn))
+		return NULL;
+
+	conn->stop_stream_reception();
+
+	Py_XINCREF(Py_None);
+	return (Py_None);
+}
+
+/** @brief Play audio files and record at the same time, stop playing if the caller interrupts.
+    @ingroup python
+
+    The given files are played w/o gaps between them like in capisuite_audio_send_sequence(). At the same
+    time, the received audio is recorded like in capisuite_audio_receive(). If the caller starts speaking or
+    sends a DTMF signal during the playback, the playback is stopped immediately ("barge-in") and the position
+    at which this happened is returned. The recording continues until one of the timeouts is reached.
+
+    Silence detection starts when the playback has finished. If DTMF abort is enabled, a DTMF signal also finishes
+    the recording and the command will abort immediately if DTMF was received before it is called.
+
+    The connction must be in audio mode (use capisuite_connect_voice()), otherwise an exception will be caused.
+
+    @param args Contains the python parameters. These are:
+    	- <b>call</b> Reference to the current call
+    	- <b>filenames (sequence of strings)</b> files to play
+    	- <b>record_filename (string)</b> where to save received audio
+	- <b>timeout (integer)</b> receive length in seconds (-1 = infinite)
+	- <b>silence_timeout (integer, optional)</b> abort after x seconds of silence after the playback (0=off, default)
+	- <b>exit_DTMF (integer, optional)</b> if set to 1, recording is aborted when a DTMF signal is received (0=off, default)
+    @return tuple (barge_in, duration): barge_in is the position in milliseconds at which the playback was interrupted
+            (-1 if it was played completely), duration is the duration of the recording in seconds
+*/
+static PyObject*
+capisuite_audio_send_receive(PyObject*, PyObject *args)
+{
+	Connection* conn;
+	vector<string> files;
+	char *record_filename;
+	int timeout, silence_timeout=0;
+	PyThreadState *_save;
+	int exit_DTMF=0;
+	long duration=0, barge_in=-1;
+
+	if (!PyArg_ParseTuple(args,"O&O&si|ii:audio_send_receive",convertConnRef,&conn,convertFileNames,&files,&record_filename,&timeout,&silence_timeout,&exit_DTMF))
+		return NULL;
+
+	try {
+		Py_UNBLOCK_THREADS
+		AudioSendReceive active(conn,files,record_filename,timeout,silence_timeout,exit_DTMF);
+		active.mainLoop();
+		duration=active.duration();
+		barge_in=active.bargeInOffset();
+		Py_BLOCK_THREADS
+	}
+	catch (CapiWrongState e) {
+		Py_BLOCK_THREADS
+		PyErr_SetString(CallGoneError,"Call was finished from partner.");
+		return NULL;
+	}
+	catch (CapiMsgError e) {
+		Py_BLOCK_THREADS
+		PyErr_SetString(BackendError,(e.message()).c_str());
+		return NULL;
+	}
+	catch (CapiExternalError e) {
+		Py_BLOCK_THREADS
+		PyErr_SetString(BackendError,(e.message()).c_str());
+		return NULL;
+	}
+	catch (CapiError e) {
+		Py_BLOCK_THREADS
+		PyErr_SetString(BackendError,(e.message()).c_str());
+		return NULL;
+	}
+
+	return Py_BuildValue("ll",barge_in,duration);
+}
+
+/** @brief Connect two calls through.
+    @ingroup python
+
+    The B channels of both calls are bridged by the backend, i.e. everything received on one call is sent
+    on the other one and vice versa. The audio data isn't passed through Python, so this is very cheap.
+
+    The function blocks until one of the calls is finished, the timeout is reached or a DTMF signal is received
+    on the first call (if exit_DTMF is set). The bridge is removed then and both calls can be used normally again.
+
+    Both calls must be in audio mode (use capisuite_connect_voice() or capisuite_call_voice()) and no
+    transmission must be in progress.
+
+    @param args Contains the python parameters. These are:
+    	- <b>call</b> Reference to the current call
+    	- <b>other_call</b> Reference to the call to connect with
+	- <b>timeout (integer)</b> maximum duration of the bridge in seconds (-1 = infinite)
+	- <b>exit_DTMF (integer, optional)</b> if set to 1, the bridge is removed when a DTMF signal is received on call (0=off, default)
+    @return None
+*/
+static PyObject*
+capisuite_bridge(PyObject*, PyObject *args)
 {
-	Connection* conn;
-	char *filename;
+	Connection *conn, *peer;
+	int timeout;
 	PyThreadState *_save;
 	int exit_DTMF=0;
-	long duration=0;
 
-	if (!PyArg_ParseTuple(args,"O&s|i:audio_send",convertConnRef,&conn,&filename,&exit_DTMF))
+	if (!PyArg_ParseTuple(args,"O&O&i|i:bridge",convertConnRef,&conn,convertConnRef,&peer,&timeout,&exit_DTMF))
 		return NULL;
 
 	try {
 		Py_UNBLOCK_THREADS
-		AudioSend active(conn,filename,exit_DTMF);
+		CallBridge active(conn,peer,timeout,exit_DTMF);
 		active.mainLoop();
-		duration=active.duration();
 		Py_BLOCK_THREADS
 	}
 	catch (CapiWrongState e) {
@@ -227,24 +1082,14 @@ capisuite_audio_send(PyObject*, PyObject *args)
 		PyErr_SetString(CallGoneError,"Call was finished from partner.");
 		return NULL;
 	}
-	catch (CapiMsgError e) {
-		Py_BLOCK_THREADS
-		PyErr_SetString(BackendError,(e.message()).c_str());
-		return NULL;
-	}
 	catch (CapiExternalError e) {
 		Py_BLOCK_THREADS
 		PyErr_SetString(BackendError,(e.message()).c_str());
 		return NULL;
 	}
-	catch (CapiError e) {
-		Py_BLOCK_THREADS
-		PyErr_SetString(BackendError,(e.message()).c_str());
-		return NULL;
-	}
 
-	PyObject *r=PyInt_FromLong(duration);
-	return (r);
+	Py_XINCREF(Py_None);
+	return (Py_None);
 }
 
 /** @brief Receive an audio file in a speech mode connection.
@@ -261,7 +1106,9 @@ capisuite_audio_send(PyObject*, PyObject *args)
 
     The connction must be in audio mode (use capisuite_connect_voice()), otherwise an exception will be caused.
 
-    The created file will be saved in bit-reversed A-Law format, 8 kHz mono. Use sox to convert it to a normal wav file.
+    The created file will be saved in bit-reversed A-Law format, 8 kHz mono. Use capisuite_la2wav() to convert it to a normal wav file.
+    If compression is enabled, the file is saved in IMA ADPCM with half the size instead. capisuite_audio_send() and
+    capisuite_la2wav() decode such files automatically, but other tools like sox can't read them.
 
     @param args Contains the python parameters. These are:
     	- <b>call</b> Reference to the current call
@@ -269,6 +1116,7 @@ capisuite_audio_send(PyObject*, PyObject *args)
 	- <b>timeout (integer)</b> receive length in seconds (-1 = infinite)
 	- <b>silence_timeout (integer, optional)</b> abort after x seconds of silence (0=off, default)
 	- <b>exit_DTMF (integer, optional)</b> if set to 1, sending is aborted when a DTMF signal is received (0=off, default)
+	- <b>compress (integer, optional)</b> if set to 1, the file is compressed with IMA ADPCM (0=off, default)
     @return int containing duration of receive in seconds
 */
 static PyObject*
@@ -278,15 +1126,15 @@ capisuite_audio_receive(PyObject *, PyObject *args)
 	char *filename;
 	int timeout, silence_timeout=0;
 	PyThreadState *_save;
-	int exit_DTMF=0;
+	int exit_DTMF=0, compress=0;
 	long duration=0;
 
-	if (!PyArg_ParseTuple(args,"O&si|ii:audio_receive",convertConnRef,&conn,&filename, &timeout, &silence_timeout,&exit_DTMF))
+	if (!PyArg_ParseTuple(args,"O&si|iii:audio_receive",convertConnRef,&conn,&filename, &timeout, &silence_timeout,&exit_DTMF,&compress))
 		return NULL;
 
 	try {
 		Py_UNBLOCK_THREADS
-		AudioReceive active(conn,filename,timeout,silence_timeout,exit_DTMF);
+		AudioReceive active(conn,filename,timeout,silence_timeout,exit_DTMF,compress);
 		active.mainLoop();
 		duration=active.duration();
 		Py_BLOCK_THREADS
@@ -316,9 +1164,14 @@ capisuite_audio_receive(PyObject *, PyObject *args)
 
     The created file will be saved in the Structured Fax File (SFF) format.
 
+    If a progress function is given, it's called each time a page was received completely with the
+    number of complete pages and the number of bytes received so far as parameters. Exceptions raised
+    by it are printed and ignored.
+
     @param args Contains the python parameters. These are:
     	- <b>call</b> Reference to the current call
     	- <b>filename (string)</b> where to save received fax
+    	- <b>progress (callable, optional)</b> function to call for each received page
     @return None or a tuple (stationID,rate,hiRes,format,pages) containing the values:
     	- fax station ID from the calling party (String)
 	- bit rate which was used for connecting (Integer)
@@ -331,14 +1184,22 @@ capisuite_fax_receive(PyObject *, PyObject *args)
 {
 	Connection *conn;
 	char *filename;
+	PyObject *progress=NULL;
 	PyThreadState *_save;
 
-	if (!PyArg_ParseTuple(args,"O&s:fax_receive",convertConnRef,&conn,&filename))
+	if (!PyArg_ParseTuple(args,"O&s|O:fax_receive",convertConnRef,&conn,&filename,&progress))
+		return NULL;
+
+	if (progress==Py_None)
+		progress=NULL;
+	if (progress && !PyCallable_Check(progress)) {
+		PyErr_SetString(PyExc_TypeError,"progress must be callable");
 		return NULL;
+	}
 
 	try {
 		Py_UNBLOCK_THREADS
-		FaxReceive active(conn,filename);
+		PyFaxReceive active(conn,filename,progress,&_save);
 		active.mainLoop();
 		Py_BLOCK_THREADS
 	}
@@ -355,7 +1216,10 @@ capisuite_fax_receive(PyObject *, PyObject *args)
 
 	Connection::fax_info_t* fax_info = conn->getFaxInfo();
 	if (fax_info) {
-		PyObject *r=Py_BuildValue("siiii",fax_info->stationID.c_str(),fax_info->rate,fax_info->hiRes,fax_info->format,fax_info->pages);
+		int pages=fax_info->pages;
+		if (!pages && conn->getFaxIndex()) // not all drivers report the page count
+			pages=conn->getFaxIndex()->completePages();
+		PyObject *r=Py_BuildValue("siiii",fax_info->stationID.c_str(),fax_info->rate,fax_info->hiRes,fax_info->format,pages);
 		return (r);
 	} else {
 		Py_XINCREF(Py_None);
@@ -363,6 +1227,45 @@ capisuite_fax_receive(PyObject *, PyObject *args)
 	}
 }
 
+/** @brief Get the page index of a received fax
+    @ingroup python
+
+    The page index is built while the fax is received, so this can be used to check the progress of a reception
+    (e.g. from the progress function given to capisuite_fax_receive()) or to access single pages of the received
+    file w/o parsing it again.
+
+    @param args Contains the python parameters. These are:
+    	- <b>call</b> Reference to the current call
+    @return list of tuples (offset,hiRes,width,lines), one for each page received so far:
+    	- position of the page header in the SFF file (Integer)
+	- high (1) or low (0) resolution (Integer)
+	- width of the page in pixels (Integer)
+	- number of lines (Integer)
+*/
+static PyObject*
+capisuite_fax_pages(PyObject *, PyObject *args)
+{
+	Connection *conn;
+
+	if (!PyArg_ParseTuple(args,"O&:fax_pages",convertConnRef,&conn))
+		return NULL;
+
+	PyObject *l=PyList_New(0);
+	if (!l || !conn->getFaxIndex())
+		return l;
+	vector<SffIndex::Page> pages=conn->getFaxIndex()->pages();
+	for (vector<SffIndex::Page>::iterator it=pages.begin();it!=pages.end();it++) {
+		PyObject *p=Py_BuildValue("kiii",it->offset,it->vres,it->width,it->lines);
+		if (!p || PyList_Append(l,p)) {
+			Py_XDECREF(p);
+			Py_DECREF(l);
+			return NULL;
+		}
+		Py_DECREF(p);
+	}
+	return l;
+}
+
 /** @brief Send a fax in a fax mode connection
     @ingroup python
 
@@ -642,8 +1545,11 @@ capisuite_connect_faxG3(PyObject *, PyObject *args)
 
 /** @brief helper function for capisuite_call_voice() and capisuite_call_faxG3()
 
+    If more than one controller is allowed, the call is placed on the least loaded one
+    (see Capi::selectController()).
+
     @param capi reference to object of Capi to use
-    @param controller controller number to use
+    @param controllers controllers which may be used, all if empty
     @param call_from string containing the own number to use
     @param call_to string containing the number to call
     @param service service to call with as described in Connection::service_t
@@ -651,17 +1557,23 @@ capisuite_connect_faxG3(PyObject *, PyObject *args)
     @param faxStationID fax station ID, only necessary when connecting in FAXG3 mode
     @param faxHeadline fax headline, only necessary when connecting in FAXG3 mode
     @param clir set to true to disable sending of own number
-    @return tuple (call,result) - call=reference to the created call object / result(int)=result of the call establishment
+    @return tuple (call,result) - call=reference to the created call object (None if no controller is free) / result(int)=result of the call establishment
 */
 static PyObject*
-capisuite_call(Capi *capi, unsigned short controller, string call_from, string call_to, Connection::service_t service, int timeout, string faxStationID, string faxHeadline, bool clir)
+capisuite_call(Capi *capi, const vector<_cdword> &controllers, string call_from, string call_to, Connection::service_t service, int timeout, string faxStationID, string faxHeadline, bool clir)
 {
 	PyThreadState *_save;
 	Connection* conn=NULL;
 	int result;
+	_cdword controller;
+	if (controllers.size()==1)
+		controller=controllers[0]; // chosen explicitly, so use it in any case
+	else if (!(controller=capi->selectController(service,controllers)))
+		return Py_BuildValue("Oi",Py_None,NO_CHANNEL_AVAILABLE);
 	try {
 		Py_UNBLOCK_THREADS
 		CallOutgoing active(capi,controller,call_from,call_to,service,timeout,faxStationID,faxHeadline,clir);
+		SendJobScript::callPlaced(); // the connection is counted by capi now
 		active.mainLoop();
 		conn=active.getConnection();
 		result=active.getResult();
@@ -700,10 +1612,12 @@ capisuite_call(Capi *capi, unsigned short controller, string call_from, string c
 		- 2 = connection wasn't successful and no reason for this failure is available
 		- 0x3301-0x34FF: Error reported by CAPI. For a complete description see 
 		  the annex of the user manual
+		- 0x34A2: none of the controllers has a free B channel (call is None then)
 
     @param args Contains the python parameters. These are:
 	- <b>capi</b> reference to object of Capi to use (given to the idle function as parameter)
-    	- <b>controller (int)</b> ISDN controller ID to use (1=first controller)
+    	- <b>controller (int or sequence of ints)</b> ISDN controller ID to use (1=first controller). For
+	  a sequence or 0 (all controllers), the least loaded controller supporting voice is taken.
     	- <b>call_from (string)</b>own number to use
     	- <b>call_to (string)</b>the number to call
     	- <b>timeout (int)</b>timeout to wait for connection establishment in seconds
@@ -714,13 +1628,14 @@ static PyObject*
 capisuite_call_voice(PyObject *, PyObject *args)
 {
 	Capi *capi;
-	int controller, timeout, clir=0;
+	vector<_cdword> controllers;
+	int timeout, clir=0;
 	char *call_from,*call_to;
 
-	if (!PyArg_ParseTuple(args,"O&issi|i:call_voice",convertCapiRef,&capi,&controller,&call_from,&call_to,&timeout,&clir))
+	if (!PyArg_ParseTuple(args,"O&O&ssi|i:call_voice",convertCapiRef,&capi,convertControllers,&controllers,&call_from,&call_to,&timeout,&clir))
 		return NULL;
 
-	return capisuite_call(capi,controller,call_from,call_to,Connection::VOICE,timeout,"","",clir);
+	return capisuite_call(capi,controllers,call_from,call_to,Connection::VOICE,timeout,"","",clir);
 }
 
 /** @brief Initiate an outgoing call with service faxG3 and wait for successful connection
@@ -741,10 +1656,12 @@ capisuite_call_voice(PyObject *, PyObject *args)
 		- 2 = connection wasn't successful and no reason for this failure is available
 		- 0x3301-0x34FF: Error reported by CAPI. For a complete 
 		  description see the annex of the user manual
+		- 0x34A2: none of the controllers has a free B channel (call is None then)
 
     @param args Contains the python parameters. These are:
 	- <b>capi</b> reference to object of Capi to use (given to the idle function as parameter)
-    	- <b>controller (int)</b> ISDN controller ID to use (1=first controller)
+    	- <b>controller (int or sequence of ints)</b> ISDN controller ID to use (1=first controller). For
+	  a sequence or 0 (all controllers), the least loaded controller supporting fax is taken.
     	- <b>call_from (string)</b>own number to use
     	- <b>call_to (string)</b>the number to call
     	- <b>timeout (int)</b>timeout to wait for connection establishment in seconds
@@ -757,13 +1674,452 @@ static PyObject*
 capisuite_call_faxG3(PyObject *, PyObject *args)
 {
 	Capi *capi;
-	int controller, timeout, clir=0;
+	vector<_cdword> controllers;
+	int timeout, clir=0;
 	char *call_from,*call_to,*faxStationID,*faxHeadline;
 
-	if (!PyArg_ParseTuple(args,"O&ississ|i:call_faxG3",convertCapiRef,&capi,&controller,&call_from,&call_to,&timeout,&faxStationID,&faxHeadline,&clir))
+	if (!PyArg_ParseTuple(args,"O&O&ssiss|i:call_faxG3",convertCapiRef,&capi,convertControllers,&controllers,&call_from,&call_to,&timeout,&faxStationID,&faxHeadline,&clir))
+		return NULL;
+
+	return capisuite_call(capi,controllers,call_from,call_to,Connection::FAXG3,timeout,faxStationID,faxHeadline,clir);
+}
+
+/** @brief Send a job of the send queue in an own thread
+    @ingroup python
+
+    The job is handed over to the function sendJob(capi,controller,user,job) of the
+    idle script which is started in an own thread with an own interpreter. So several
+    jobs can be sent in parallel - one for each free B channel of the controllers.
+    The least loaded of the given controllers which supports fax is chosen for the
+    job and given to sendJob().
+
+    The function returns immediately. Its result is:
+	- 1 = the job was started
+	- 0 = all B channels of these controllers are busy, try again later
+	- -1 = this job is already being sent
+
+    @param args Contains the python parameters. These are:
+	- <b>capi</b> reference to object of Capi to use (given to the idle function as parameter)
+    	- <b>controller (int or sequence of ints)</b> ISDN controller ID(s) to use (1=first controller, 0=all controllers)
+    	- <b>user (string)</b> owner of the job
+    	- <b>job (string)</b> name of the job, usually the control file
+    @return result - see above.
+*/
+static PyObject*
+capisuite_send_job(PyObject *, PyObject *args)
+{
+	Capi *capi;
+	vector<_cdword> controllers;
+	int ret;
+	char *user,*job;
+
+	if (!PyArg_ParseTuple(args,"O&O&ss:send_job",convertCapiRef,&capi,convertControllers,&controllers,&user,&job))
+		return NULL;
+
+	if (!capisuiteInstance) {
+		PyErr_SetString(PyExc_IOError,"send_job can only be used in the CapiSuite daemon");
+		return NULL;
+	}
+
+	try {
+		ret=capisuiteInstance->startSendJob(controllers,user,job);
+	}
+	catch (ApplicationError e) {
+		PyErr_SetString(PyExc_IOError,e.message().c_str());
+		return NULL;
+	}
+
+	return Py_BuildValue("i",ret);
+}
+
+/** @brief Check if a job is currently sent
+    @ingroup python
+
+    File locks can't tell if a job is sent by another thread of this process, so
+    use this before changing or removing jobs from within CapiSuite.
+
+    @param args Contains the python parameters. These are:
+    	- <b>job (string)</b> name of the job as given to capisuite_send_job()
+    @return 1 if the job is being sent, 0 otherwise
+*/
+static PyObject*
+capisuite_job_running(PyObject *, PyObject *args)
+{
+	char *job;
+
+	if (!PyArg_ParseTuple(args,"s:job_running",&job))
+		return NULL;
+
+	return Py_BuildValue("i",SendJobScript::isRunning(job));
+}
+
+/** @brief Start the idle script immediately when a new job appears in a directory
+    @ingroup python
+
+    The directory is watched for new control files (*.txt), so the idle script
+    doesn't have to wait for the next interval to find new jobs.
+
+    @param args Contains the python parameters. These are:
+    	- <b>dir (string)</b> directory to watch, usually a send queue
+    @return None
+*/
+static PyObject*
+capisuite_watch_queue(PyObject *, PyObject *args)
+{
+	char *dir;
+
+	if (!PyArg_ParseTuple(args,"s:watch_queue",&dir))
+		return NULL;
+
+	if (capisuiteInstance) {
+		try {
+			capisuiteInstance->watchQueue(dir);
+		}
+		catch (ApplicationError e) {
+			PyErr_SetString(PyExc_IOError,e.message().c_str());
+			return NULL;
+		}
+	}
+
+	Py_XINCREF(Py_None);
+	return (Py_None);
+}
+
+/** @brief Add a job to the send schedule or change its send time
+    @ingroup python
+
+    The schedule holds the time at which each queued job is due, so the
+    idle script doesn't have to check all jobs of all queues in each run. It's
+    shared by all scripts running in this CapiSuite process. See JobSchedule for details.
+
+    @param args Contains the python parameters. These are:
+    	- <b>job (string)</b> name of the job, usually the control file
+    	- <b>user (string)</b> owner of the job
+    	- <b>time (float)</b> time at which the job is due (seconds since the epoch)
+    @return None
+*/
+static PyObject*
+capisuite_schedule_job(PyObject *, PyObject *args)
+{
+	char *job,*user;
+	double time;
+
+	if (!PyArg_ParseTuple(args,"ssd:schedule_job",&job,&user,&time))
+		return NULL;
+
+	JobSchedule::add(job,user,static_cast<time_t>(time));
+
+	Py_XINCREF(Py_None);
+	return (Py_None);
+}
+
+/** @brief Remove a job from the send schedule
+    @ingroup python
+
+    @param args Contains the python parameters. These are:
+    	- <b>job (string)</b> name of the job
+    @return 1 if the job was scheduled, 0 otherwise
+*/
+static PyObject*
+capisuite_unschedule_job(PyObject *, PyObject *args)
+{
+	char *job;
+
+	if (!PyArg_ParseTuple(args,"s:unschedule_job",&job))
+		return NULL;
+
+	return Py_BuildValue("i",JobSchedule::remove(job));
+}
+
+/** @brief Check if a job is part of the send schedule
+    @ingroup python
+
+    @param args Contains the python parameters. These are:
+    	- <b>job (string)</b> name of the job
+    @return 1 if the job is scheduled, 0 otherwise
+*/
+static PyObject*
+capisuite_job_scheduled(PyObject *, PyObject *args)
+{
+	char *job;
+
+	if (!PyArg_ParseTuple(args,"s:job_scheduled",&job))
+		return NULL;
+
+	return Py_BuildValue("i",JobSchedule::contains(job));
+}
+
+/** @brief Get the due jobs from the send schedule
+    @ingroup python
+
+    The returned jobs are removed from the schedule. Jobs which can't be sent now
+    must be added again with capisuite_schedule_job().
+
+    @param args Contains the python parameters. These are:
+    	- <b>time (float, optional)</b> current time (seconds since the epoch), default is now
+    @return list of (job,user,time) tuples ordered by their send time
+*/
+static PyObject*
+capisuite_due_jobs(PyObject *, PyObject *args)
+{
+	double now=time(NULL);
+
+	if (!PyArg_ParseTuple(args,"|d:due_jobs",&now))
+		return NULL;
+
+	vector<JobSchedule::Job> jobs=JobSchedule::due(static_cast<time_t>(now));
+
+	PyObject *result=PyList_New(jobs.size()); // new ref
+	if (!result)
+		return NULL;
+	for (unsigned i=0;i<jobs.size();i++) {
+		PyObject *item=Py_BuildValue("(ssd)",jobs[i].name.c_str(),jobs[i].user.c_str(),static_cast<double>(jobs[i].time)); // new ref
+		if (!item) {
+			Py_DECREF(result);
+			return NULL;
+		}
+		PyList_SET_ITEM(result,i,item); // steals ref
+	}
+	return result;
+}
+
+/** @brief Get a unique number for a new file in a spool directory
+    @ingroup python
+
+    The number is taken from the counter file of the directory, see JobCounter for
+    details.
+
+    @param args Contains the python parameters. These are:
+    	- <b>dir (string)</b> directory to work in
+    	- <b>basename (string)</b> base name of the files (e.g. "fax" for fax-001.sff)
+    @return the next free number
+*/
+static PyObject*
+capisuite_unique_number(PyObject *, PyObject *args)
+{
+	char *dir, *basename;
+	unsigned nr;
+
+	if (!PyArg_ParseTuple(args,"ss:unique_number",&dir,&basename))
+		return NULL;
+
+	try {
+		nr=JobCounter::next(dir,basename);
+	}
+	catch (ApplicationError e) {
+		PyErr_SetString(PyExc_IOError,e.message().c_str());
+		return NULL;
+	}
+
+	return Py_BuildValue("i",nr);
+}
+
+static map<string,pthread_mutex_t*> process_locks; ///< locks of capisuite_process_lock(), referenced by name
+static pthread_mutex_t process_locks_mutex=PTHREAD_MUTEX_INITIALIZER; ///< to realize critical sections when accessing process_locks
+
+/** @brief Take a lock shared by all threads and interpreters of capisuite
+    @ingroup python
+
+    Each script runs in an own interpreter, so the locks of the python module threading don't exclude
+    the scripts from each other. Locks on files don't help either on NFS, as they belong to the process
+    there. So python code guarding a shared file takes this lock before the lock of the file.
+
+    The python lock is released while waiting for the lock.
+
+    @param args Contains the python parameters. These are:
+    	- <b>name (string)</b> name of the lock (e.g. the path of the guarded file)
+    @return None
+*/
+static PyObject*
+capisuite_process_lock(PyObject *, PyObject *args)
+{
+	char *name;
+	PyThreadState *_save;
+
+	if (!PyArg_ParseTuple(args,"s:process_lock",&name))
+		return NULL;
+
+	pthread_mutex_lock(&process_locks_mutex);
+	pthread_mutex_t* &lock=process_locks[name];
+	if (!lock) {
+		lock=new pthread_mutex_t;
+		pthread_mutex_init(lock,NULL);
+	}
+	pthread_mutex_t *mutex=lock;
+	pthread_mutex_unlock(&process_locks_mutex);
+
+	Py_UNBLOCK_THREADS
+	pthread_mutex_lock(mutex);
+	Py_BLOCK_THREADS
+
+	Py_INCREF(Py_None);
+	return Py_None;
+}
+
+/** @brief Release a lock taken with capisuite_process_lock()
+    @ingroup python
+
+    The lock must be released by the thread which took it.
+
+    @param args Contains the python parameters. These are:
+    	- <b>name (string)</b> name of the lock
+    @return None
+*/
+static PyObject*
+capisuite_process_unlock(PyObject *, PyObject *args)
+{
+	char *name;
+
+	if (!PyArg_ParseTuple(args,"s:process_unlock",&name))
+		return NULL;
+
+	pthread_mutex_lock(&process_locks_mutex);
+	map<string,pthread_mutex_t*>::iterator it=process_locks.find(name);
+	if (it!=process_locks.end())
+		pthread_mutex_unlock(it->second);
+	pthread_mutex_unlock(&process_locks_mutex);
+
+	Py_INCREF(Py_None);
+	return Py_None;
+}
+
+/** @brief Convert a python sequence of strings to a vector
+
+    @param seq the sequence
+    @param result vector to store the strings in
+    @return true if successful, false if an error occured (python exception is set)
+*/
+static bool
+convertStringList(PyObject *seq, vector<string> &result)
+{
+	PyObject *fast=PySequence_Fast(seq,"sequence of strings expected"); // new ref
+	if (!fast)
+		return false;
+	for (int i=0;i<PySequence_Fast_GET_SIZE(fast);i++) {
+		char *s=PyString_AsString(PySequence_Fast_GET_ITEM(fast,i)); // borrowed ref
+		if (!s) {
+			Py_DECREF(fast);
+			return false;
+		}
+		result.push_back(s);
+	}
+	Py_DECREF(fast);
+	return true;
+}
+
+/** @brief Convert options of a config section to a list of (name,value) tuples
+
+    @return new reference to the list, NULL if an error occured
+*/
+static PyObject*
+convertOptions(const ScriptConfig::Options &options)
+{
+	PyObject *result=PyList_New(options.size()); // new ref
+	if (!result)
+		return NULL;
+	for (unsigned i=0;i<options.size();i++) {
+		PyObject *item=Py_BuildValue("(ss)",options[i].first.c_str(),options[i].second.c_str()); // new ref
+		if (!item) {
+			Py_DECREF(result);
+			return NULL;
+		}
+		PyList_SET_ITEM(result,i,item); // steals ref
+	}
+	return result;
+}
+
+/** @brief Get the parsed contents of the script config files
+    @ingroup python
+
+    The files are only parsed for the first call and after a SIGHUP, see ScriptConfig
+    for details.
+
+    @param args Contains the python parameters. These are:
+    	- <b>files (sequence of strings)</b> names of the config files, later ones override earlier ones
+    @return None if the files contain errors, otherwise a tuple (defaults,sections) containing
+    	- the options of the DEFAULT section as list of (name,value) tuples
+    	- a list of (section,options) tuples for all other sections in file order,
+	  options given as list of (name,value) tuples
+*/
+static PyObject*
+capisuite_script_config(PyObject *, PyObject *args)
+{
+	PyObject *seq;
+
+	if (!PyArg_ParseTuple(args,"O:script_config",&seq))
+		return NULL;
+
+	vector<string> files;
+	if (!convertStringList(seq,files))
+		return NULL;
+
+	const ScriptConfig::Snapshot *snapshot=ScriptConfig::acquire(files);
+	if (!snapshot->valid) {
+		ScriptConfig::release(snapshot);
+		Py_INCREF(Py_None);
+		return Py_None;
+	}
+
+	PyObject *defaults=NULL, *sections=NULL, *result=NULL;
+	if ((defaults=convertOptions(snapshot->defaults)) && (sections=PyList_New(snapshot->sections.size()))) {
+		unsigned i;
+		for (i=0;i<snapshot->sections.size();i++) {
+			PyObject *options=convertOptions(snapshot->sections[i].options); // new ref
+			PyObject *item=options ? Py_BuildValue("(sN)",snapshot->sections[i].name.c_str(),options) : NULL; // new ref, steals options
+			if (!item)
+				break;
+			PyList_SET_ITEM(sections,i,item); // steals ref
+		}
+		if (i==snapshot->sections.size())
+			result=Py_BuildValue("(OO)",defaults,sections); // new ref
+	}
+	ScriptConfig::release(snapshot);
+	Py_XDECREF(defaults);
+	Py_XDECREF(sections);
+	return result;
+}
+
+/** @brief Find the user responsible for an incoming call
+    @ingroup python
+
+    The user is looked up in an index of the voice_numbers and fax_numbers of all users
+    which is built from the script configuration once and after each SIGHUP, see
+    CallRouting for details.
+
+    @param args Contains the python parameters. These are:
+    	- <b>files (sequence of strings)</b> names of the script config files, see capisuite_script_config()
+    	- <b>ignore (sequence of strings)</b> sections which don't belong to users
+    	- <b>number (string)</b> the called number
+    	- <b>service (int)</b> service of the call (SERVICE_VOICE, SERVICE_FAXG3 or SERVICE_OTHER)
+    @return tuple (user,service) containing the user and the service to handle the call with,
+    	None if no user takes the call
+*/
+static PyObject*
+capisuite_route_call(PyObject *, PyObject *args)
+{
+	PyObject *files_seq, *ignore_seq;
+	char *number;
+	int service;
+
+	if (!PyArg_ParseTuple(args,"OOsi:route_call",&files_seq,&ignore_seq,&number,&service))
 		return NULL;
 
-	return capisuite_call(capi,controller,call_from,call_to,Connection::FAXG3,timeout,faxStationID,faxHeadline,clir);
+	vector<string> files, ignore;
+	if (!convertStringList(files_seq,files) || !convertStringList(ignore_seq,ignore))
+		return NULL;
+
+	CallRouting::setup(files,ignore);
+	string user;
+	Connection::service_t user_service;
+	int ret=CallRouting::route(number,static_cast<Connection::service_t>(service),user,user_service);
+	if (ret<0) {
+		PyErr_SetString(PyExc_IOError,"script configuration contains errors");
+		return NULL;
+	} else if (!ret) {
+		Py_INCREF(Py_None);
+		return Py_None;
+	}
+	return Py_BuildValue("(si)",user.c_str(),user_service);
 }
 
 /** @brief Switch a connection from voice mode to fax mode.
@@ -941,13 +2297,35 @@ capisuite_read_DTMF(PyObject *, PyObject *args)
 static PyMethodDef PCallControlMethods[] = {
         {"audio_receive", 	capisuite_audio_receive, 	METH_VARARGS, "Receive audio. For further details see capisuite module reference."},
         {"audio_send", 		capisuite_audio_send, 		METH_VARARGS, "Send audio. For further details see capisuite module reference."},
+        {"audio_send_sequence",	capisuite_audio_send_sequence,	METH_VARARGS, "Send several audio files w/o gaps. For further details see capisuite module reference."},
+        {"audio_stream_start",	capisuite_audio_stream_start,	METH_VARARGS, "Start sending audio data from memory. For further details see capisuite module reference."},
+        {"audio_stream_write",	capisuite_audio_stream_write,	METH_VARARGS, "Give audio data to a stream. For further details see capisuite module reference."},
+        {"audio_stream_finish",	capisuite_audio_stream_finish,	METH_VARARGS, "Finish sending audio data from memory. For further details see capisuite module reference."},
+        {"audio_stream_receive_start", capisuite_audio_stream_receive_start, METH_VARARGS, "Start receiving audio data to memory. For further details see capisuite module reference."},
+        {"audio_stream_read",	capisuite_audio_stream_read,	METH_VARARGS, "Read received audio data. For further details see capisuite module reference."},
+        {"audio_stream_receive_stop", capisuite_audio_stream_receive_stop, METH_VARARGS, "Stop receiving audio data to memory. For further details see capisuite module reference."},
+        {"audio_send_receive",	capisuite_audio_send_receive,	METH_VARARGS, "Play audio while recording, with barge-in. For further details see capisuite module reference."},
+        {"bridge",		capisuite_bridge,		METH_VARARGS, "Connect two calls through. For further details see capisuite module reference."},
  	{"fax_receive",		capisuite_fax_receive, 		METH_VARARGS, "Receive fax. For further details see capisuite module reference."},
+	{"fax_pages",		capisuite_fax_pages,		METH_VARARGS, "Get page index of received fax. For further details see capisuite module reference."},
  	{"fax_send",		capisuite_fax_send, 		METH_VARARGS, "Send fax. For further details see capisuite module reference."},
 	{"disconnect", 		capisuite_disconnect, 		METH_VARARGS, "Disconnect call. For further details see capisuite module reference."},
 	{"connect_voice",	capisuite_connect_voice,	METH_VARARGS, "Connect pending call with Telephony services. Arguments: call, delay"},
 	{"connect_faxG3",	capisuite_connect_faxG3,	METH_VARARGS, "Connect pending call with FaxG3 services. For further details see capisuite module reference."},
 	{"call_voice",		capisuite_call_voice,		METH_VARARGS, "Initiate an outgoing call with service voice. For further details see capisuite module reference."},
 	{"call_faxG3",		capisuite_call_faxG3,		METH_VARARGS, "Initiate an outgoing call with service FaxG3. For further details see capisuite module reference."},
+	{"send_job",		capisuite_send_job,		METH_VARARGS, "Send a job of the send queue in an own thread. For further details see capisuite module reference."},
+	{"job_running",		capisuite_job_running,		METH_VARARGS, "Check if a job is currently sent. For further details see capisuite module reference."},
+	{"watch_queue",		capisuite_watch_queue,		METH_VARARGS, "Start the idle script when a new job appears in a directory. For further details see capisuite module reference."},
+	{"schedule_job",	capisuite_schedule_job,		METH_VARARGS, "Add a job to the send schedule. For further details see capisuite module reference."},
+	{"unschedule_job",	capisuite_unschedule_job,	METH_VARARGS, "Remove a job from the send schedule. For further details see capisuite module reference."},
+	{"job_scheduled",	capisuite_job_scheduled,	METH_VARARGS, "Check if a job is part of the send schedule. For further details see capisuite module reference."},
+	{"due_jobs",		capisuite_due_jobs,		METH_VARARGS, "Get the due jobs from the send schedule. For further details see capisuite module reference."},
+	{"unique_number",	capisuite_unique_number,	METH_VARARGS, "Get a unique number for a new file in a spool directory. For further details see capisuite module reference."},
+	{"process_lock",	capisuite_process_lock,		METH_VARARGS, "Take a lock shared by all scripts. For further details see capisuite module reference."},
+	{"process_unlock",	capisuite_process_unlock,	METH_VARARGS, "Release a lock taken with process_lock(). For further details see capisuite module reference."},
+	{"script_config",	capisuite_script_config,	METH_VARARGS, "Get the parsed contents of the script config files. For further details see capisuite module reference."},
+	{"route_call",		capisuite_route_call,		METH_VARARGS, "Find the user responsible for an incoming call. For further details see capisuite module reference."},
 	{"switch_to_faxG3",	capisuite_switch_to_faxG3,	METH_VARARGS, "Switch from telephony to FaxG3 services. For further details see capisuite module reference."},
 	{"reject",		capisuite_reject, 		METH_VARARGS, "Reject waiting call. For further details see capisuite module reference."},
 	{"enable_DTMF",		capisuite_enable_DTMF,		METH_VARARGS, "Enable DTMF recognition. For further details see capisuite module reference."},
@@ -955,6 +2333,13 @@ static PyMethodDef PCallControlMethods[] = {
 	{"read_DTMF",		capisuite_read_DTMF,		METH_VARARGS, "Read and clear received DTMF. For further details see capisuite module reference."},
 	{"log",			capisuite_log,			METH_VARARGS, "Write log message. For further details see capisuite module reference."},
 	{"error",		capisuite_error,		METH_VARARGS, "Write error message. For further details see capisuite module reference."},
+	{"la2wav",		capisuite_la2wav,		METH_VARARGS, "Convert A-Law file to WAV. For further details see capisuite module reference."},
+	{"la2pcm",		capisuite_la2pcm,		METH_VARARGS, "Convert A-Law data to linear PCM. For further details see capisuite module reference."},
+	{"sff2tiff",		capisuite_sff2tiff,		METH_VARARGS, "Convert SFF file to TIFF. For further details see capisuite module reference."},
+	{"sff2pdf",		capisuite_sff2pdf,		METH_VARARGS, "Convert SFF file to PDF. For further details see capisuite module reference."},
+	{"cff2pdf",		capisuite_cff2pdf,		METH_VARARGS, "Convert CFF file to PDF. For further details see capisuite module reference."},
+	{"sff_slice",		capisuite_sff_slice,		METH_VARARGS, "Remove first pages from SFF file. For further details see capisuite module reference."},
+	{"sff_pages",		capisuite_sff_pages,		METH_VARARGS, "Count the pages of SFF file. For further details see capisuite module reference."},
         {NULL,NULL,0,NULL}
 };
 
@@ -0,0 +1,418 @@
+/*  @file faxconvert.cpp
+    @brief Contains FaxConvert - conversion of received fax files to common formats
+
+    @author agent <agent@local>
+*/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include <sstream>
+#include "../backend/sffindex.h"
+#include "faxconvert.h"
+
+/** @brief MH code of a run
+
+    The lowest bits bits of code hold the code with the bit sent first as the most
+    significant one, as it's written in ITU T.4.
+*/
+struct MHCode {
+	unsigned short code; ///< the code bits
+	unsigned char bits; ///< length of the code
+};
+
+/// MH terminating codes for white runs of 0..63 pixels (ITU T.4, table 2)
+static const MHCode white_terminating[64] = {
+	{0x35,8},{0x07,6},{0x07,4},{0x08,4},{0x0b,4},{0x0c,4},{0x0e,4},{0x0f,4},
+	{0x13,5},{0x14,5},{0x07,5},{0x08,5},{0x08,6},{0x03,6},{0x34,6},{0x35,6},
+	{0x2a,6},{0x2b,6},{0x27,7},{0x0c,7},{0x08,7},{0x17,7},{0x03,7},{0x04,7},
+	{0x28,7},{0x2b,7},{0x13,7},{0x24,7},{0x18,7},{0x02,8},{0x03,8},{0x1a,8},
+	{0x1b,8},{0x12,8},{0x13,8},{0x14,8},{0x15,8},{0x16,8},{0x17,8},{0x28,8},
+	{0x29,8},{0x2a,8},{0x2b,8},{0x2c,8},{0x2d,8},{0x04,8},{0x05,8},{0x0a,8},
+	{0x0b,8},{0x52,8},{0x53,8},{0x54,8},{0x55,8},{0x24,8},{0x25,8},{0x58,8},
+	{0x59,8},{0x5a,8},{0x5b,8},{0x4a,8},{0x4b,8},{0x32,8},{0x33,8},{0x34,8}
+};
+
+/// MH make-up codes for white runs of 64..2560 pixels in steps of 64 (ITU T.4, tables 3 and 4)
+static const MHCode white_makeup[40] = {
+	{0x1b,5},{0x12,5},{0x17,6},{0x37,7},{0x36,8},{0x37,8},{0x64,8},{0x65,8},
+	{0x68,8},{0x67,8},{0xcc,9},{0xcd,9},{0xd2,9},{0xd3,9},{0xd4,9},{0xd5,9},
+	{0xd6,9},{0xd7,9},{0xd8,9},{0xd9,9},{0xda,9},{0xdb,9},{0x98,9},{0x99,9},
+	{0x9a,9},{0x18,6},{0x9b,9},{0x08,11},{0x0c,11},{0x0d,11},{0x12,12},{0x13,12},
+	{0x14,12},{0x15,12},{0x16,12},{0x17,12},{0x1c,12},{0x1d,12},{0x1e,12},{0x1f,12}
+};
+
+/** @brief Collects MH codes to bytes, LSB first (the bit order used by CAPI)
+*/
+class MHWriter
+{
+	public:
+		MHWriter():acc(0),used(0)
+		{}
+
+		/** @brief append one code
+
+		    @param c the code to append
+		*/
+		void put(const MHCode &c)
+		{
+			for (int i=c.bits-1;i>=0;i--) {
+				if (c.code & (1 << i))
+					acc|=1 << used;
+				if (++used==8) {
+					data+=static_cast<char>(acc);
+					acc=used=0;
+				}
+			}
+		}
+
+		/** @brief pad to the next byte boundary and return the collected data
+
+		    @return the coded bytes
+		*/
+		string& flush()
+		{
+			if (used) {
+				data+=static_cast<char>(acc);
+				acc=used=0;
+			}
+			return data;
+		}
+
+	private:
+		string data; ///< complete bytes
+		unsigned char acc; ///< the current byte
+		int used; ///< number of bits used in acc
+};
+
+string
+FaxConvert::sff2tiff(const string &sff) throw (ApplicationError)
+{
+	SffDocument doc(sff);
+	if (!doc.pageCount())
+		throw ApplicationError("SFF file contains no pages","FaxConvert::sff2tiff()");
+
+	string tiff("II*\0\0\0\0\0",8);
+	string::size_type next_ifd=4; // where to save the offset of the next IFD
+	for (unsigned i=0;i<doc.pageCount();i++) {
+		const SffDocument::Page &p=doc.page(i);
+
+		string::size_type strip=tiff.size();
+		tiff+=codePage(p,true,false);
+		string::size_type strip_size=tiff.size()-strip;
+		if (tiff.size()%2) // IFDs must start on a word boundary
+			tiff+='\0';
+
+		setLE(tiff,next_ifd,tiff.size());
+		// 16 entries, the rationals for the resolution follow the IFD
+		unsigned long res_x=tiff.size()+2+16*12+4, res_y=res_x+8;
+		putLE(tiff,16,2);
+		putTag(tiff,254,4,2); // NewSubfileType: page of a multi-page document
+		putTag(tiff,256,4,p.width); // ImageWidth
+		putTag(tiff,257,4,p.lines.size()); // ImageLength
+		putTag(tiff,258,3,1); // BitsPerSample
+		putTag(tiff,259,3,3); // Compression: CCITT T.4
+		putTag(tiff,262,3,0); // PhotometricInterpretation: white is zero
+		putTag(tiff,266,3,2); // FillOrder: LSB first
+		putTag(tiff,273,4,strip); // StripOffsets
+		putTag(tiff,277,3,1); // SamplesPerPixel
+		putTag(tiff,278,4,p.lines.size()); // RowsPerStrip
+		putTag(tiff,279,4,strip_size); // StripByteCounts
+		putTag(tiff,282,5,res_x); // XResolution
+		putTag(tiff,283,5,res_y); // YResolution
+		putTag(tiff,292,4,4); // T4Options: 1D coding, byte aligned EOLs
+		putTag(tiff,296,3,2); // ResolutionUnit: inch
+		putTag(tiff,297,3,i | (doc.pageCount() << 16),2); // PageNumber: page, total pages
+		next_ifd=tiff.size();
+		putLE(tiff,0,4);
+		putLE(tiff,p.dpiX(),4);
+		putLE(tiff,1,4);
+		putLE(tiff,p.dpiY(),4);
+		putLE(tiff,1,4);
+	}
+	return tiff;
+}
+
+string
+FaxConvert::sff2pdf(const string &sff) throw (ApplicationError)
+{
+	SffDocument doc(sff);
+	if (!doc.pageCount())
+		throw ApplicationError("SFF file contains no pages","FaxConvert::sff2pdf()");
+
+	vector<PdfImage> images(doc.pageCount());
+	for (unsigned i=0;i<doc.pageCount();i++) {
+		const SffDocument::Page &p=doc.page(i);
+		PdfImage &img=images[i];
+		img.width=p.width;
+		img.height=p.lines.size();
+		img.dpi_x=p.dpiX();
+		img.dpi_y=p.dpiY();
+		ostringstream params;
+		params << "/ColorSpace /DeviceGray /BitsPerComponent 1 /Filter /CCITTFaxDecode"
+		  << " /DecodeParms << /K 0 /Columns " << img.width << " /Rows " << img.height
+		  << " /EncodedByteAlign true /EndOfBlock false >>";
+		img.parameters=params.str();
+		img.data=codePage(p,false,true);
+	}
+	return writePdf(images);
+}
+
+string
+FaxConvert::cff2pdf(const string &cff) throw (ApplicationError)
+{
+	vector<PdfImage> images;
+	string::size_type pos=cff.find("\xff\xd8");
+	while (pos!=string::npos) {
+		images.push_back(PdfImage());
+		readJpeg(cff,pos,images.back());
+		pos=cff.find("\xff\xd8",pos);
+	}
+	if (images.empty())
+		throw ApplicationError("CFF file contains no pages","FaxConvert::cff2pdf()");
+	return writePdf(images);
+}
+
+void
+FaxConvert::readJpeg(const string &cff, string::size_type &pos, PdfImage &img) throw (ApplicationError)
+{
+	const unsigned char *d=reinterpret_cast<const unsigned char*>(cff.data());
+	string::size_type size=cff.size(), start=pos, sof=0;
+	unsigned components=0, precision=8;
+	bool t42=false;
+	img.width=img.height=0;
+	img.dpi_x=img.dpi_y=200;
+
+	// read the marker segments in front of the scan data
+	pos+=2;
+	while (true) {
+		if (pos+4>size || d[pos]!=0xff)
+			throw ApplicationError("invalid JPEG marker","FaxConvert::readJpeg()");
+		unsigned char marker=d[pos+1];
+		if (marker==0xff) { // fill byte
+			pos++;
+			continue;
+		}
+		string::size_type length=(d[pos+2] << 8) | d[pos+3];
+		if (pos+2+length>size)
+			throw ApplicationError("unexpected end of file","FaxConvert::readJpeg()");
+		const unsigned char *seg=d+pos+4;
+		if (marker>=0xc0 && marker<=0xcf && marker!=0xc4 && marker!=0xc8 && marker!=0xcc && length>=8) { // SOFn
+			sof=pos;
+			precision=seg[0];
+			img.height=(seg[1] << 8) | seg[2];
+			img.width=(seg[3] << 8) | seg[4];
+			components=seg[5];
+		} else if (marker==0xe0 && length>=16 && !cff.compare(pos+4,5,"JFIF\0",5) && seg[7]==1) { // JFIF with density in dpi
+			img.dpi_x=(seg[8] << 8) | seg[9];
+			img.dpi_y=(seg[10] << 8) | seg[11];
+		} else if (marker==0xe1 && length>=12 && !cff.compare(pos+4,6,"G3FAX\0",6)) { // T.42: version, resolution
+			t42=true;
+			img.dpi_x=img.dpi_y=(seg[8] << 8) | seg[9];
+		}
+		pos+=2+length;
+		if (marker==0xda) // SOS, scan data follows
+			break;
+	}
+	if (!sof || !img.width || !components)
+		throw ApplicationError("JPEG image without frame header","FaxConvert::readJpeg()");
+	if (img.dpi_x<=0 || img.dpi_y<=0)
+		img.dpi_x=img.dpi_y=200;
+
+	// find the end of the image, remember the height given by DNL
+	while (true) {
+		pos=cff.find('\xff',pos);
+		if (pos==string::npos || pos+1>=size)
+			throw ApplicationError("unexpected end of file","FaxConvert::readJpeg()");
+		unsigned char marker=d[pos+1];
+		if (marker==0xd9) { // EOI
+			pos+=2;
+			break;
+		} else if (marker==0xdc && pos+6<=size) // DNL
+			img.height=(d[pos+4] << 8) | d[pos+5];
+		pos++;
+	}
+	if (!img.height)
+		throw ApplicationError("JPEG image without height","FaxConvert::readJpeg()");
+
+	img.data=cff.substr(start,pos-start);
+	img.data[sof-start+5]=static_cast<char>(img.height >> 8);
+	img.data[sof-start+6]=static_cast<char>(img.height & 0xff);
+
+	ostringstream params;
+	if (t42 && components==3) // CIELab with default gamut and D50 illuminant, see ITU T.42
+		params << "/ColorSpace [/Lab << /WhitePoint [0.9642 1 0.8249] /Range [-85 85 -75 125] >>]"
+		  << " /Decode [0 100 -85 85 -75 125]";
+	else if (components==4)
+		params << "/ColorSpace /DeviceCMYK";
+	else if (components==3)
+		params << "/ColorSpace /DeviceRGB";
+	else
+		params << "/ColorSpace /DeviceGray";
+	params << " /BitsPerComponent " << precision << " /Filter /DCTDecode";
+	if (t42 && components==3) // data is Lab, not YCbCr
+		params << " /DecodeParms << /ColorTransform 0 >>";
+	img.parameters=params.str();
+}
+
+string
+FaxConvert::sffSlice(const string &sff, unsigned first) throw (ApplicationError)
+{
+	SffIndex index;
+	index.feed(reinterpret_cast<const unsigned char*>(sff.data()),sff.size());
+	vector<SffIndex::Page> pages=index.pages();
+	if (!index.valid() || pages.empty())
+		throw ApplicationError("file is no valid SFF file","FaxConvert::sffSlice()");
+	if (first>=pages.size())
+		throw ApplicationError("SFF file has no page after the given one","FaxConvert::sffSlice()");
+
+	// document header, then everything from the first page to keep
+	unsigned long shift=pages[first].offset-pages[0].offset;
+	string result=sff.substr(0,pages[0].offset)+sff.substr(pages[first].offset);
+
+	unsigned count=pages.size()-first;
+	result[8]=static_cast<char>(count & 0xff);
+	result[9]=static_cast<char>(count >> 8);
+	// offsets of the last page header and of the document end, 0 if unknown
+	for (string::size_type pos=12;pos<=16;pos+=4) {
+		const unsigned char *d=reinterpret_cast<const unsigned char*>(result.data())+pos;
+		unsigned long offset=d[0] | (d[1] << 8) | (d[2] << 16) | (static_cast<unsigned long>(d[3]) << 24);
+		if (offset>shift)
+			setLE(result,pos,offset-shift);
+	}
+	return result;
+}
+
+unsigned
+FaxConvert::sffPages(const string &sff) throw (ApplicationError)
+{
+	SffIndex index;
+	index.feed(reinterpret_cast<const unsigned char*>(sff.data()),sff.size());
+	if (!index.valid())
+		throw ApplicationError("file is no valid SFF file","FaxConvert::sffPages()");
+	return index.pages().size();
+}
+
+string
+FaxConvert::writePdf(const vector<PdfImage> &images)
+{
+	// objects: 1 catalog, 2 page tree, then page, contents and image for each page
+	vector<string::size_type> offsets;
+	ostringstream pdf;
+	pdf << "%PDF-1.3\n%\xe2\xe3\xcf\xd3\n";
+
+	offsets.push_back(pdf.tellp());
+	pdf << "1 0 obj\n<< /Type /Catalog /Pages 2 0 R >>\nendobj\n";
+	offsets.push_back(pdf.tellp());
+	pdf << "2 0 obj\n<< /Type /Pages /Count " << images.size() << " /Kids [";
+	for (unsigned i=0;i<images.size();i++)
+		pdf << " " << 3+3*i << " 0 R";
+	pdf << " ] >>\nendobj\n";
+
+	for (unsigned i=0;i<images.size();i++) {
+		const PdfImage &img=images[i];
+		unsigned obj=3+3*i;
+		string w=points(img.width,img.dpi_x), h=points(img.height,img.dpi_y);
+		string contents="q "+w+" 0 0 "+h+" 0 0 cm /Im0 Do Q\n";
+
+		offsets.push_back(pdf.tellp());
+		pdf << obj << " 0 obj\n<< /Type /Page /Parent 2 0 R /MediaBox [0 0 " << w << " " << h << "]"
+		  << " /Resources << /XObject << /Im0 " << obj+2 << " 0 R >> >> /Contents " << obj+1 << " 0 R >>\nendobj\n";
+		offsets.push_back(pdf.tellp());
+		pdf << obj+1 << " 0 obj\n<< /Length " << contents.size() << " >>\nstream\n" << contents << "endstream\nendobj\n";
+		offsets.push_back(pdf.tellp());
+		pdf << obj+2 << " 0 obj\n<< /Type /XObject /Subtype /Image /Width " << img.width << " /Height " << img.height
+		  << " " << img.parameters << " /Length " << img.data.size() << " >>\nstream\n";
+		pdf.write(img.data.data(),img.data.size());
+		pdf << "\nendstream\nendobj\n";
+	}
+
+	string::size_type xref=pdf.tellp();
+	pdf << "xref\n0 " << offsets.size()+1 << "\n0000000000 65535 f \n";
+	for (unsigned i=0;i<offsets.size();i++) {
+		pdf.width(10);
+		pdf.fill('0');
+		pdf << offsets[i] << " 00000 n \n";
+	}
+	pdf << "trailer\n<< /Size " << offsets.size()+1 << " /Root 1 0 R >>\nstartxref\n" << xref << "\n%%EOF\n";
+	return pdf.str();
+}
+
+string
+FaxConvert::points(unsigned pixels, int dpi)
+{
+	unsigned long hundredths=pixels*7200UL/dpi; // so we can do w/o floating point output
+	ostringstream s;
+	s << hundredths/100 << "." << (hundredths%100)/10 << hundredths%10;
+	return s.str();
+}
+
+string
+FaxConvert::codePage(const SffDocument::Page &page, bool eol, bool msb_first)
+{
+	string white=whiteLine(page.width);
+	string data;
+	data.reserve(page.lines.size()*32);
+	for (vector<string>::const_iterator it=page.lines.begin();it!=page.lines.end();it++) {
+		if (eol) {
+			data+='\x00'; // EOL (000000000001) preceded by 4 fill bits, LSB first
+			data+='\x80';
+		}
+		data+=it->empty() ? white : *it;
+	}
+	if (msb_first) {
+		static const unsigned char reverse[16]={0x0,0x8,0x4,0xc,0x2,0xa,0x6,0xe,0x1,0x9,0x5,0xd,0x3,0xb,0x7,0xf};
+		for (string::iterator it=data.begin();it!=data.end();it++) {
+			unsigned char b=*it;
+			*it=(reverse[b & 0xf] << 4) | reverse[b >> 4];
+		}
+	}
+	return data;
+}
+
+string
+FaxConvert::whiteLine(unsigned width)
+{
+	MHWriter w;
+	while (width>2560) {
+		w.put(white_makeup[39]);
+		width-=2560;
+	}
+	if (width>=64)
+		w.put(white_makeup[width/64-1]);
+	w.put(white_terminating[width%64]);
+	return w.flush();
+}
+
+void
+FaxConvert::putLE(string &s, unsigned long value, int bytes)
+{
+	for (int i=0;i<bytes;i++)
+		s+=static_cast<char>((value >> (8*i)) & 0xff);
+}
+
+void
+FaxConvert::setLE(string &s, string::size_type pos, unsigned long value)
+{
+	for (int i=0;i<4;i++)
+		s[pos+i]=static_cast<char>((value >> (8*i)) & 0xff);
+}
+
+void
+FaxConvert::putTag(string &s, unsigned short tag, unsigned short type, unsigned long value, unsigned count)
+{
+	putLE(s,tag,2);
+	putLE(s,type,2);
+	putLE(s,count,4);
+	if (type==3 && count==1) { // SHORT values are left justified in the value field
+		putLE(s,value,2);
+		putLE(s,0,2);
+	} else
+		putLE(s,value,4);
+}
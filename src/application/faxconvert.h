@@ -0,0 +1,186 @@
+/** @file faxconvert.h
+    @brief Contains FaxConvert - conversion of received fax files to common formats
+
+    @author agent <agent@local>
+*/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef FAXCONVERT_H
+#define FAXCONVERT_H
+
+#include <string>
+#include <vector>
+#include "sffdocument.h"
+#include "applicationexception.h"
+
+using namespace std;
+
+/** @brief Conversion of the fax files used by CapiSuite to common formats
+
+    Received faxes are saved in the Structured Fax File format (see SffDocument).
+    This class converts them to formats which can be read by common tools w/o
+    calling external converters like sfftobmp.
+
+    The lines of an SFF file are already coded with Modified Huffman (MH), which is
+    also used by TIFF Class F and by the CCITTFaxDecode filter of PDF. So the conversion
+    only rewraps the coded lines, they're copied unchanged or only bit-reversed.
+    White lines, which SFF saves as a simple counter, are the only ones which must be
+    coded here.
+
+    All methods are static and thread safe.
+
+    @author agent
+*/
+class FaxConvert
+{
+	public:
+		/** @brief Convert an SFF file to a TIFF Class F file
+
+		    Each page is saved as one strip with MH coding (Compression=3, T4Options=4,
+		    i.e. byte aligned EOLs) and FillOrder=2 like SFF itself.
+
+		    @param sff contents of the SFF file
+		    @return contents of the TIFF file
+		    @throw ApplicationError Thrown if the SFF data is invalid
+		*/
+		static string sff2tiff(const string &sff) throw (ApplicationError);
+
+		/** @brief Convert an SFF file to a PDF file
+
+		    Each page is embedded as one image with CCITTFaxDecode filter (K=0,
+		    EncodedByteAlign) and scaled to its real size using the resolution of
+		    the page. No rasterization is done.
+
+		    @param sff contents of the SFF file
+		    @return contents of the PDF file
+		    @throw ApplicationError Thrown if the SFF data is invalid
+		*/
+		static string sff2pdf(const string &sff) throw (ApplicationError);
+
+		/** @brief Convert a CFF file (color fax) to a PDF file
+
+		    A CFF file consists of concatenated JPEG images, one per page. Each of them is
+		    embedded as one image with DCTDecode filter w/o decompressing it. Images coded
+		    in CIELab as defined by ITU T.42 (recognized by the "G3FAX" APP1 marker) are
+		    shown using a Lab color space with the default gamut and illuminant of T.42.
+
+		    @param cff contents of the CFF file
+		    @return contents of the PDF file
+		    @throw ApplicationError Thrown if no valid JPEG image was found
+		*/
+		static string cff2pdf(const string &cff) throw (ApplicationError);
+
+		/** @brief Remove the first pages from an SFF file
+
+		    The pages are found with SffIndex and copied as they are, only the page
+		    count and the offsets in the document header are corrected. This is used to
+		    resend the rest of a fax which was interrupted after some pages.
+
+		    @param sff contents of the SFF file
+		    @param first number of the first page to keep (starting with 0)
+		    @return contents of the new SFF file
+		    @throw ApplicationError Thrown if the SFF data is invalid or has no page with the given number
+		*/
+		static string sffSlice(const string &sff, unsigned first) throw (ApplicationError);
+
+		/** @brief Count the pages of an SFF file
+
+		    @param sff contents of the SFF file
+		    @return number of pages found with SffIndex
+		    @throw ApplicationError Thrown if the SFF data is invalid
+		*/
+		static unsigned sffPages(const string &sff) throw (ApplicationError);
+
+	private:
+		/** @brief One image to embed in a PDF file as a page
+		*/
+		struct PdfImage
+		{
+			unsigned width; ///< width in pixels
+			unsigned height; ///< height in pixels
+			int dpi_x; ///< horizontal resolution, used to calculate the page size
+			int dpi_y; ///< vertical resolution, used to calculate the page size
+			string parameters; ///< additional entries for the image dictionary (color space, filter, ...)
+			string data; ///< the encoded image data
+		};
+
+		/** @brief Create a PDF file showing one image per page
+
+		    @param images the pages
+		    @return contents of the PDF file
+		*/
+		static string writePdf(const vector<PdfImage> &images);
+
+		/** @brief Calculate a length in PDF units
+
+		    @param pixels length in pixels
+		    @param dpi resolution
+		    @return the length in points (1/72 inch) with two decimals
+		*/
+		static string points(unsigned pixels, int dpi);
+
+		/** @brief Code the lines of one page as MH
+
+		    @param page the page to code
+		    @param eol true: prefix each line with a byte aligned EOL (for TIFF), false: only align each line to a byte boundary (for PDF)
+		    @param msb_first true: return data with the first bit in the MSB (for PDF), false: LSB first like SFF (for TIFF)
+		    @return MH data
+		*/
+		static string codePage(const SffDocument::Page &page, bool eol, bool msb_first);
+
+		/** @brief Code a white line with the given width as MH
+
+		    @param width width of the line in pixels
+		    @return MH code of the line w/o EOL, LSB first and padded to the next byte boundary
+		*/
+		static string whiteLine(unsigned width);
+
+		/** @brief Read one JPEG image from a CFF file
+
+		    The image data is copied unchanged except the height in the frame header
+		    which is filled in from the DNL marker if necessary, as not all JPEG decoders
+		    support it.
+
+		    @param cff contents of the CFF file
+		    @param pos position of the SOI marker, will be set to the position after the EOI marker
+		    @param img will be filled with the image data and its parameters
+		    @throw ApplicationError Thrown if the image is invalid
+		*/
+		static void readJpeg(const string &cff, string::size_type &pos, PdfImage &img) throw (ApplicationError);
+
+		/** @brief append a number in little endian byte order
+
+		    @param s the string to append to
+		    @param value the number
+		    @param bytes number of bytes to append
+		*/
+		static void putLE(string &s, unsigned long value, int bytes);
+
+		/** @brief overwrite a 32 bit number in little endian byte order
+
+		    @param s the string to change
+		    @param pos position of the number in s
+		    @param value the number
+		*/
+		static void setLE(string &s, string::size_type pos, unsigned long value);
+
+		/** @brief append one TIFF directory entry
+
+		    @param s the string to append to
+		    @param tag the TIFF tag
+		    @param type TIFF type of the value (3=SHORT, 4=LONG, 5=RATIONAL)
+		    @param value the value or the offset of the value, two SHORT values are given as low and high word
+		    @param count number of values
+		*/
+		static void putTag(string &s, unsigned short tag, unsigned short type, unsigned long value, unsigned count=1);
+};
+
+#endif
@@ -15,7 +15,14 @@
  ***************************************************************************/
 
 #include <Python.h>
+#include <sys/inotify.h>
+#include <poll.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
 #include "idlescript.h"
+#include "jobschedule.h"
+#include "sendjobscript.h"
 #include "capisuitemodule.h"
 
 void* idlescript_exec_handler(void* arg)
@@ -44,6 +51,11 @@ void idlescript_cleanup_handler(void* arg)
 IdleScript::IdleScript(ostream &debug, unsigned short debug_level, ostream &error, Capi *capi, string idlescript, int idlescript_interval, PyThreadState *py_state, PycStringIO_CAPI* cStringIO) throw (ApplicationError)
 :PythonScript(debug,debug_level,error,idlescript,"idle",cStringIO),idlescript_interval(idlescript_interval),py_state(py_state),capi(capi),active(true)
 {
+	pthread_mutex_init(&watched_mutex,NULL);
+	inotify_fd=inotify_init();
+	if (inotify_fd<0)
+		error << prefix() << "Warning: can't initialize inotify (" << strerror(errno) << "), new jobs will only be found in regular intervals" << endl;
+
         pthread_attr_t attr;
         pthread_attr_init(&attr);
         pthread_attr_setdetachstate(&attr,PTHREAD_CREATE_DETACHED);
@@ -57,6 +69,9 @@ IdleScript::IdleScript(ostream &debug, unsigned short debug_level, ostream &erro
 
 IdleScript::~IdleScript()
 {
+	if (inotify_fd>=0)
+		close(inotify_fd);
+	pthread_mutex_destroy(&watched_mutex);
 	if (debug_level>=3)
 		debug << prefix() << "IdleScript deleted" << endl;
 }
@@ -65,13 +80,15 @@ void
 IdleScript::run() throw()
 {
 	int count=idlescript_interval*9,errorcount=0;
-	timespec delay_time;
-	delay_time.tv_sec=0; delay_time.tv_nsec=100000000;  // 100 msec
 	while (1) {
 		pthread_testcancel(); // cancellation point
-		nanosleep(&delay_time,NULL);
+		bool new_jobs=waitForJobs();
 		count++;
-		if (active && (count>=idlescript_interval*10)) {
+		time_t next_job=JobSchedule::next();
+		bool due=next_job && next_job<=time(NULL) && !SendJobScript::channelsBusy(); // due jobs must wait for a free B channel
+		if (active && (count>=idlescript_interval*10 || new_jobs || (due && count>=10))) { // due jobs are checked once a second at most
+			if (debug_level>=3 && count<idlescript_interval*10)
+				debug << prefix() << "starting idlescript early for " << (new_jobs ? "new" : "due") << " jobs" << endl;
 			count=0;
 			PyObject *capi_ref=NULL;
 			try {
@@ -135,6 +152,58 @@ IdleScript::activate()
 	active=true;
 }
 
+void
+IdleScript::watch(string dir) throw (ApplicationError)
+{
+	if (inotify_fd<0)
+		return;
+	pthread_mutex_lock(&watched_mutex);
+	if (watched.count(dir)) {
+		pthread_mutex_unlock(&watched_mutex);
+		return;
+	}
+	if (inotify_add_watch(inotify_fd,dir.c_str(),IN_CLOSE_WRITE|IN_MOVED_TO)<0) {
+		pthread_mutex_unlock(&watched_mutex);
+		throw ApplicationError("can't watch directory "+dir+" ("+strerror(errno)+")","IdleScript::watch()");
+	}
+	watched.insert(dir);
+	pthread_mutex_unlock(&watched_mutex);
+
+	if (debug_level>=3)
+		debug << prefix() << "watching " << dir << " for new jobs" << endl;
+}
+
+bool
+IdleScript::waitForJobs()
+{
+	if (inotify_fd<0) {
+		timespec delay_time;
+		delay_time.tv_sec=0; delay_time.tv_nsec=100000000;  // 100 msec
+		nanosleep(&delay_time,NULL);
+		return false;
+	}
+
+	pollfd fds;
+	fds.fd=inotify_fd;
+	fds.events=POLLIN;
+	if (poll(&fds,1,100)<=0) // timeout (100 msec) or signal
+		return false;
+
+	char buffer[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+	bool found=false;
+	ssize_t len=read(inotify_fd,buffer,sizeof(buffer));
+	for (ssize_t pos=0;pos<len;) {
+		inotify_event *event=reinterpret_cast<inotify_event*>(buffer+pos);
+		if (event->len) {
+			string name(event->name);
+			if (name.size()>4 && name.substr(name.size()-4)==".txt") // only control files, not the data or lock files
+				found=true;
+		}
+		pos+=sizeof(inotify_event)+event->len;
+	}
+	return found;
+}
+
 /* History
 
 Old Log (for new changes see ChangeLog):
@@ -18,6 +18,7 @@
 #define IDLESCRIPT_H
 
 #include <string>
+#include <set>
 #include "applicationexception.h"
 #include "pythonscript.h"
 
@@ -44,6 +45,14 @@ void idlescript_cleanup_handler(void* arg);
     do arbitrary things. The main use is surely initiating outgoing calls, e.g. to send faxes.
 
     It creates one new thread which will execute the idle script over and over...
+
+    Besides the regular interval, the script is started immediately when a job is
+    due in the JobSchedule or when a new control file (*.txt) was written to one of
+    the directories registered with watch() (usually the send queues). The directories
+    are watched with inotify, so new jobs are sent without waiting for the next interval.
+    While all B channels are busy (see SendJobScript::channelsBusy()), due jobs don't start
+    the script until a send job finishes, only the regular interval does (for channels freed
+    by incoming calls).
     
     If the script fails too often, it's deactivated. After fixing the script, it can be reactivated
     with activate().
@@ -82,6 +91,15 @@ class IdleScript: public PythonScript
 		*/
 		void activate(void);
 
+		/** @brief start the script immediately when a new control file appears in the given directory
+
+		    Directories already watched are ignored.
+
+		    @param dir the directory to watch
+		    @throw ApplicationError Thrown if the directory can't be watched
+		*/
+		void watch(string dir) throw (ApplicationError);
+
 	private:
 		/** @brief Thread body. Calls the python function idle().
 
@@ -103,12 +121,21 @@ class IdleScript: public PythonScript
 		    The python global lock will be acquired while the function runs.
 		*/
 		virtual void run(void) throw();
+
+		/** @brief Wait for 100 msec or until a new control file is written to a watched directory
+
+		    @return true if a new control file was written
+		*/
+		bool waitForJobs();
 		
 		PyThreadState *py_state; ///< py_state of the main python interpreter used for run().   
 		string idlescript; ///< name of the python script which is called at regular intervals
 		int idlescript_interval; ///< interval between subsequent executions of idle script
 		Capi *capi; ///< reference to Capi object
 		bool active; ///< used to disable IdleScript in case of too much errors
+		int inotify_fd; ///< inotify instance used to watch the directories, -1 if not available
+		set<string> watched; ///< directories already watched
+		pthread_mutex_t watched_mutex; ///< to realize critical sections when accessing watched
 		
 		pthread_t thread_handle; ///< handle for the created pthread thread
 };
@@ -0,0 +1,129 @@
+/*  @file jobcounter.cpp
+    @brief Contains JobCounter - allocation of unique job numbers from a counter file
+
+    @author agent <agent@local>
+*/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include <fstream>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "jobcounter.h"
+
+map<string,int> JobCounter::counters;
+pthread_mutex_t JobCounter::mutex=PTHREAD_MUTEX_INITIALIZER;
+
+unsigned
+JobCounter::next(string directory, string basename) throw (ApplicationError)
+{
+	string filename=directory+"/"+basename+"-counter";
+
+	pthread_mutex_lock(&mutex);
+	unsigned nr;
+	try {
+		int fd;
+		map<string,int>::iterator it=counters.find(filename);
+		if (it!=counters.end())
+			fd=it->second;
+		else
+			fd=counters[filename]=open(filename);
+
+		if (lockf(fd,F_LOCK,0))
+			throw ApplicationError("can't lock counter file "+filename+" ("+strerror(errno)+")","JobCounter::next()");
+		try {
+			nr=increment(fd,filename,directory,basename);
+		}
+		catch (ApplicationError) {
+			lockf(fd,F_ULOCK,0);
+			throw;
+		}
+		lockf(fd,F_ULOCK,0);
+	}
+	catch (ApplicationError) {
+		pthread_mutex_unlock(&mutex);
+		throw;
+	}
+	pthread_mutex_unlock(&mutex);
+	return nr;
+}
+
+int
+JobCounter::open(string filename) throw (ApplicationError)
+{
+	int fd=::open(filename.c_str(),O_RDWR|O_CREAT,0600);
+	if (fd<0)
+		throw ApplicationError("can't open counter file "+filename+" ("+strerror(errno)+")","JobCounter::open()");
+	fcntl(fd,F_SETFD,FD_CLOEXEC);
+	return fd;
+}
+
+unsigned
+JobCounter::increment(int fd, string filename, string directory, string basename) throw (ApplicationError)
+{
+	Counter counter;
+	bool created=false;
+	ssize_t len=pread(fd,&counter,sizeof(Counter),0);
+	if (len<0)
+		throw ApplicationError("can't read counter file "+filename+" ("+strerror(errno)+")","JobCounter::increment()");
+	if (len<static_cast<ssize_t>(sizeof(Counter))) { // new counter file
+		counter.magic=counter_magic;
+		counter.next=firstFree(directory,basename);
+		struct stat dirstat;
+		if (!getuid() && !stat(directory.c_str(),&dirstat)) // the owner of the directory needs it, too
+			fchown(fd,dirstat.st_uid,dirstat.st_gid);
+		created=true;
+	} else if (counter.magic!=counter_magic)
+		throw ApplicationError("counter file "+filename+" is corrupt","JobCounter::increment()");
+
+	unsigned nr=counter.next++;
+	if (pwrite(fd,&counter,sizeof(Counter),0)!=sizeof(Counter))
+		throw ApplicationError("can't write counter file "+filename+" ("+strerror(errno)+")","JobCounter::increment()");
+	// the number must be on disk before its file is created, otherwise it's handed out again after a crash
+	if (created ? fsync(fd) : fdatasync(fd))
+		throw ApplicationError("can't sync counter file "+filename+" ("+strerror(errno)+")","JobCounter::increment()");
+	if (created)
+		unlink((directory+"/"+basename+"-nextnr").c_str()); // not used any more
+	return nr;
+}
+
+unsigned
+JobCounter::firstFree(string directory, string basename)
+{
+	unsigned nr=1;
+
+	ifstream nextnr((directory+"/"+basename+"-nextnr").c_str());
+	unsigned old;
+	if (nextnr >> old && old>nr)
+		nr=old;
+
+	DIR *dir=opendir(directory.c_str());
+	if (!dir)
+		return nr;
+	string prefix=basename+"-";
+	struct dirent *entry;
+	while ((entry=readdir(dir))) {
+		if (strncmp(entry->d_name,prefix.c_str(),prefix.size()))
+			continue;
+		char *end;
+		const char *digits=entry->d_name+prefix.size();
+		unsigned long found=strtoul(digits,&end,10);
+		if (end!=digits && *end=='.' && found>=nr)
+			nr=found+1;
+	}
+	closedir(dir);
+	return nr;
+}
@@ -0,0 +1,111 @@
+/** @file jobcounter.h
+    @brief Contains JobCounter - allocation of unique job numbers from a counter file
+
+    @author agent <agent@local>
+*/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef JOBCOUNTER_H
+#define JOBCOUNTER_H
+
+#include <pthread.h>
+#include <string>
+#include <map>
+#include "applicationexception.h"
+
+using namespace std;
+
+/** @brief Allocation of unique job numbers from a counter file
+
+    Each received fax, voice message and send job gets a number which must be unique
+    in its spool directory. The next number is kept in a small binary counter file
+    (<basename>-counter) in the directory, so taking a number doesn't need the spool
+    lock or a scan of the directory.
+
+    The counter file is opened once per process and kept open. A number is taken by
+    reading and rewriting the counter under a lockf() lock on the file. Tools running
+    outside of capisuite (like capisuitefax, see capisuite.fileutils.uniqueName()) use
+    exactly the same protocol, so all of them can share the counter. As lockf() locks
+    belong to the process, the threads of capisuite are serialized by a mutex in addition.
+
+    The counter is deliberately not mapped to memory: a shared mapping isn't coherent
+    between the clients of a spool on NFS, while the NFS client revalidates its cache when
+    a lock is taken and writes the data back when it's released. So the counter also
+    works for spool directories shared over NFS (given a working lock manager).
+
+    Each new value is written to disk (fdatasync()) before the number is returned, so a
+    crash can't make the counter go back to a number whose file already exists.
+
+    When the counter file is created, its value is initialized with the highest number
+    found in the directory (or the value of an old nextnr file).
+
+    @author agent
+*/
+class JobCounter
+{
+	public:
+		/** @brief Return the next unique number for files named <basename>-<number>.* in a directory
+
+		    @param directory the directory to work in
+		    @param basename the base name of the files
+		    @return the next unique number
+		    @throw ApplicationError if the counter file can't be created, locked, read or written
+		*/
+		static unsigned next(string directory, string basename) throw (ApplicationError);
+
+	private:
+		/** @brief Layout of the counter file
+		*/
+		struct Counter
+		{
+			unsigned magic; ///< must be counter_magic
+			unsigned next; ///< next free number
+		};
+
+		/** @brief Open the counter file of a directory and basename, create it if needed
+
+		    @param filename name of the counter file
+		    @return descriptor of the opened counter file
+		    @throw ApplicationError if the counter file can't be created
+		*/
+		static int open(string filename) throw (ApplicationError);
+
+		/** @brief Take the next number from a counter file, must be called with the file locked
+
+		    Initializes the counter if the file is empty.
+
+		    @param fd descriptor of the counter file
+		    @param filename name of the counter file
+		    @param directory the directory to work in
+		    @param basename the base name of the files
+		    @return the next unique number
+		    @throw ApplicationError if the counter can't be read or written
+		*/
+		static unsigned increment(int fd, string filename, string directory, string basename) throw (ApplicationError);
+
+		/** @brief Find the first free number in a directory
+
+		    Takes the highest number of all files named <basename>-<number>.* in the
+		    directory and the value of an old <basename>-nextnr file into account.
+
+		    @param directory the directory to work in
+		    @param basename the base name of the files
+		    @return the first free number
+		*/
+		static unsigned firstFree(string directory, string basename);
+
+		static const unsigned counter_magic=0x43534e31; ///< "CSN1", identifies counter files
+
+		static map<string,int> counters; ///< descriptors of all opened counter files, referenced by file name
+		static pthread_mutex_t mutex; ///< serializes the threads taking numbers, as lockf() doesn't
+};
+
+#endif
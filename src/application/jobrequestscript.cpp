@@ -0,0 +1,141 @@
+/*  @file jobrequestscript.cpp
+    @brief Contains JobRequestScript - Python thread for handling one connection of the job socket
+
+    @author agent <agent@local>
+*/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include <Python.h>
+#include <unistd.h>
+#include "jobrequestscript.h"
+#include "capisuitemodule.h"
+
+map<uid_t,unsigned> JobRequestScript::connections;
+pthread_mutex_t JobRequestScript::connections_mutex=PTHREAD_MUTEX_INITIALIZER;
+
+void* jobrequestscript_exec_handler(void* arg)
+{
+	if (!arg) {
+                cerr << "FATAL ERROR: no JobRequestScript reference given in jobrequestscript_exec_handler" << endl;
+		exit(1);
+	}
+	pthread_cleanup_push(jobrequestscript_cleanup_handler,arg);
+	JobRequestScript *instance=static_cast<JobRequestScript*>(arg);
+	instance->run();
+	pthread_cleanup_pop(1); // run the cleanup_handler and then deregister it
+	return NULL;
+}
+
+void jobrequestscript_cleanup_handler(void* arg)
+{
+	if (!arg) {
+                cerr << "FATAL ERROR: no JobRequestScript reference given in jobrequestscript_cleanup_handler" << endl;
+		exit(1);
+	}
+	JobRequestScript *instance=static_cast<JobRequestScript*>(arg);
+	instance->final();
+}
+
+JobRequestScript::JobRequestScript(ostream &debug, unsigned short debug_level, ostream &error, int fd, uid_t uid, string user, string script, PycStringIO_CAPI* cStringIO) throw (ApplicationError)
+:PythonScript(debug,debug_level,error,script,"jobRequest",cStringIO),fd(fd),uid(uid),user(user)
+{
+	pthread_mutex_lock(&connections_mutex);
+	connections[uid]++;
+	pthread_mutex_unlock(&connections_mutex);
+
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+        pthread_attr_setdetachstate(&attr,PTHREAD_CREATE_DETACHED);
+        int ret=pthread_create(&thread_handle, &attr, jobrequestscript_exec_handler, this);   // start thread as detached
+	if (ret) {
+		pthread_mutex_lock(&connections_mutex);
+		if (!--connections[uid])
+			connections.erase(uid);
+		pthread_mutex_unlock(&connections_mutex);
+		throw ApplicationError("error while creating thread","JobRequestScript::JobRequestScript()");
+	}
+
+	if (debug_level>=2)
+		debug << prefix() << "JobRequestScript created for user " << user << endl;
+}
+
+JobRequestScript::~JobRequestScript()
+{
+	close(fd);
+	pthread_mutex_lock(&connections_mutex);
+	if (!--connections[uid])
+		connections.erase(uid);
+	pthread_mutex_unlock(&connections_mutex);
+	if (debug_level>=2)
+		debug << prefix() << "JobRequestScript deleted" << endl;
+}
+
+unsigned
+JobRequestScript::running()
+{
+	pthread_mutex_lock(&connections_mutex);
+	unsigned count=0;
+	for (map<uid_t,unsigned>::iterator it=connections.begin();it!=connections.end();it++)
+		count+=it->second;
+	pthread_mutex_unlock(&connections_mutex);
+	return count;
+}
+
+unsigned
+JobRequestScript::running(uid_t uid)
+{
+	pthread_mutex_lock(&connections_mutex);
+	map<uid_t,unsigned>::iterator it=connections.find(uid);
+	unsigned count=(it!=connections.end()) ? it->second : 0;
+	pthread_mutex_unlock(&connections_mutex);
+	return count;
+}
+
+void
+JobRequestScript::run() throw()
+{
+	PyThreadState *py_state=NULL;
+
+	try {
+		PyEval_AcquireLock();
+
+		if (!(py_state=Py_NewInterpreter() )) {
+			PyEval_ReleaseLock();
+			throw ApplicationError("error while creating new python interpreter","JobRequestScript::run()");
+		}
+
+		capisuitemodule_init();
+
+		args=Py_BuildValue("is",fd,user.c_str());
+		if (!args)
+			throw ApplicationError("error during argument building","JobRequestScript::run()");
+
+		PythonScript::run();
+
+		Py_DECREF(args);
+		args=NULL;
+
+		Py_EndInterpreter(py_state);
+		py_state=NULL;
+		PyEval_ReleaseLock(); // release lock
+	}
+	catch(ApplicationError e) {
+		error << prefix() << "Error occured. message was: " << e << endl;
+
+		if (args)
+			Py_DECREF(args);
+		if (py_state) {
+			Py_EndInterpreter(py_state);
+			py_state=NULL;
+			PyEval_ReleaseLock();
+		}
+	}
+}
@@ -0,0 +1,115 @@
+/** @file jobrequestscript.h
+    @brief Contains JobRequestScript - Python thread for handling one connection of the job socket
+
+    @author agent <agent@local>
+*/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef JOBREQUESTSCRIPT_H
+#define JOBREQUESTSCRIPT_H
+
+#include <pthread.h>
+#include <sys/types.h>
+#include <string>
+#include <map>
+#include "applicationexception.h"
+#include "pythonscript.h"
+
+class PycStringIO_CAPI;
+
+/** @brief Thread exec handler for JobRequestScript class
+
+    This is a handler which will call this->run() for the use in pthread_create().
+    It will also register jobrequestscript_cleanup_handler
+*/
+void* jobrequestscript_exec_handler(void* arg);
+
+/** @brief Thread clean handler for JobRequestScript class
+
+    This is a handler which is called by pthreads at cleanup.
+    It will call this->final().
+*/
+void jobrequestscript_cleanup_handler(void* arg);
+
+/** @brief Handles the requests of one connection to the job socket in an own thread
+
+    JobServer creates an object of this class for each accepted connection. It runs
+    the python function jobRequest() of the idle script in a new thread with an own
+    python subinterpreter. The connection is closed when the function returns.
+
+    The open connections are counted per user, so JobServer can limit them.
+
+    @author agent
+*/
+class JobRequestScript: public PythonScript
+{
+	friend void* jobrequestscript_exec_handler(void*);
+	friend void jobrequestscript_cleanup_handler(void*);
+
+	public:
+		/** @brief Constructor. Create Object and start detached thread
+
+		    @param debug stream for debugging info
+		    @param debug_level verbosity level for debug messages
+		    @param error stream for error messages
+		    @param fd file descriptor of the connection, will be closed in the destructor
+		    @param uid uid of the user who opened the connection
+		    @param user name of the user who opened the connection
+		    @param script file name of the python script providing the function jobRequest()
+		    @param cStringIO pointer to the Python cStringIO C API
+		    @throw ApplicationError Thrown if thread can't be started
+		*/
+		JobRequestScript(ostream &debug, unsigned short debug_level, ostream &error, int fd, uid_t uid, string user, string script, PycStringIO_CAPI* cStringIO) throw (ApplicationError);
+
+		/** @brief Destructor. Close the connection.
+		*/
+		virtual ~JobRequestScript();
+
+		/** @brief Return the number of open connections
+
+		    @return number of connections of all users
+		*/
+		static unsigned running();
+
+		/** @brief Return the number of open connections of a user
+
+		    @param uid uid of the user
+		    @return number of connections of this user
+		*/
+		static unsigned running(uid_t uid);
+
+	private:
+		/** @brief Thread body. Calls the python function jobRequest().
+
+		    The read Python script must provide a function named jobRequest with the following signature:
+
+		    def jobRequest(fd, user):
+		    	# function body
+
+		    The parameters given to the python function are:
+			- fd: file descriptor of the connection (use socket.fromfd() to get a socket object)
+			- user: the user who opened the connection
+
+		    The function should handle all requests until the connection is closed by the client.
+		*/
+		virtual void run() throw();
+
+		int fd; ///< file descriptor of the connection
+		uid_t uid; ///< uid of the user who opened the connection
+		string user; ///< the user who opened the connection
+
+		static map<uid_t,unsigned> connections; ///< number of open connections, referenced by uid
+		static pthread_mutex_t connections_mutex; ///< to realize critical sections when accessing connections
+
+		pthread_t thread_handle; ///< handle for the created pthread thread
+};
+
+#endif
@@ -0,0 +1,97 @@
+/*  @file jobschedule.cpp
+    @brief Contains JobSchedule - process-wide schedule of the next send times of all queued jobs
+
+    @author agent <agent@local>
+*/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "jobschedule.h"
+
+map<string,JobSchedule::Job> JobSchedule::jobs;
+priority_queue<JobSchedule::Entry,vector<JobSchedule::Entry>,greater<JobSchedule::Entry> > JobSchedule::heap;
+pthread_mutex_t JobSchedule::mutex=PTHREAD_MUTEX_INITIALIZER;
+
+void
+JobSchedule::add(string name, string user, time_t time)
+{
+	pthread_mutex_lock(&mutex);
+	Job &job=jobs[name];
+	if (job.name.empty() || job.time!=time) // the old heap entry will be skipped in due()
+		heap.push(Entry(time,name));
+	job.name=name;
+	job.user=user;
+	job.time=time;
+	pthread_mutex_unlock(&mutex);
+}
+
+bool
+JobSchedule::remove(string name)
+{
+	pthread_mutex_lock(&mutex);
+	bool found=jobs.erase(name);
+	if (jobs.empty()) // drop the outdated entries
+		heap=priority_queue<Entry,vector<Entry>,greater<Entry> >();
+	pthread_mutex_unlock(&mutex);
+	return found;
+}
+
+bool
+JobSchedule::contains(string name)
+{
+	pthread_mutex_lock(&mutex);
+	bool found=jobs.count(name);
+	pthread_mutex_unlock(&mutex);
+	return found;
+}
+
+vector<JobSchedule::Job>
+JobSchedule::due(time_t now)
+{
+	vector<Job> result;
+	pthread_mutex_lock(&mutex);
+	while (!heap.empty() && heap.top().first<=now) {
+		Entry entry=heap.top();
+		heap.pop();
+		map<string,Job>::iterator it=jobs.find(entry.second);
+		if (it==jobs.end() || it->second.time!=entry.first) // job was removed or rescheduled
+			continue;
+		result.push_back(it->second);
+		jobs.erase(it);
+	}
+	pthread_mutex_unlock(&mutex);
+	return result;
+}
+
+time_t
+JobSchedule::next()
+{
+	time_t result=0;
+	pthread_mutex_lock(&mutex);
+	while (!heap.empty()) {
+		map<string,Job>::iterator it=jobs.find(heap.top().second);
+		if (it!=jobs.end() && it->second.time==heap.top().first) {
+			result=heap.top().first;
+			break;
+		}
+		heap.pop(); // job was removed or rescheduled
+	}
+	pthread_mutex_unlock(&mutex);
+	return result;
+}
+
+unsigned
+JobSchedule::size()
+{
+	pthread_mutex_lock(&mutex);
+	unsigned count=jobs.size();
+	pthread_mutex_unlock(&mutex);
+	return count;
+}
@@ -0,0 +1,108 @@
+/** @file jobschedule.h
+    @brief Contains JobSchedule - process-wide schedule of the next send times of all queued jobs
+
+    @author agent <agent@local>
+*/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef JOBSCHEDULE_H
+#define JOBSCHEDULE_H
+
+#include <pthread.h>
+#include <time.h>
+#include <string>
+#include <map>
+#include <vector>
+#include <queue>
+#include <functional>
+
+using namespace std;
+
+/** @brief Process-wide schedule of the next send times of all queued jobs
+
+    Checking all jobs of all send queues in each run of the idle script gets
+    expensive for big queues, especially as most of the jobs are usually waiting for
+    their next try. So the idle script keeps the time at which each job will be due
+    here. It only has to look at the jobs returned by due() then.
+
+    The jobs are kept in a heap ordered by their send time, so adding a job and
+    getting the due jobs needs logarithmic time per job. If a job is added again with
+    another time (e.g. because it was deferred), the old heap entry isn't removed but
+    skipped when it comes to the top.
+
+    The schedule is filled by the idle script from the spool directories at startup
+    and updated when jobs are added or deferred. All methods are static and protected
+    by a mutex, so they can be used from the idle script and all SendJobScript threads
+    (each running in an own interpreter) in parallel.
+
+    @author agent
+*/
+class JobSchedule
+{
+	public:
+		/** @brief One scheduled job
+		*/
+		class Job
+		{
+			public:
+				string name; ///< name of the job (usually its control file)
+				string user; ///< owner of the job
+				time_t time; ///< time at which the job is due
+		};
+
+		/** @brief Add a job to the schedule or change its send time if it's already scheduled
+
+		    @param name name of the job (usually its control file)
+		    @param user owner of the job
+		    @param time time at which the job is due
+		*/
+		static void add(string name, string user, time_t time);
+
+		/** @brief Remove a job from the schedule
+
+		    @param name name of the job
+		    @return true if the job was scheduled
+		*/
+		static bool remove(string name);
+
+		/** @brief Check if a job is scheduled
+
+		    @param name name of the job
+		    @return true if the job is scheduled
+		*/
+		static bool contains(string name);
+
+		/** @brief Get all jobs which are due and remove them from the schedule
+
+		    @param now current time
+		    @return due jobs, ordered by their send time
+		*/
+		static vector<Job> due(time_t now);
+
+		/** @brief Return the send time of the job which is due next
+
+		    @return send time of the next job, 0 if no job is scheduled
+		*/
+		static time_t next();
+
+		/** @brief Return the number of scheduled jobs
+		*/
+		static unsigned size();
+
+	private:
+		typedef pair<time_t,string> Entry; ///< heap entry: send time and job name
+
+		static map<string,Job> jobs; ///< all scheduled jobs, referenced by name
+		static priority_queue<Entry,vector<Entry>,greater<Entry> > heap; ///< send times of the jobs, next due first (may contain outdated entries)
+		static pthread_mutex_t mutex; ///< to realize critical sections in all methods
+};
+
+#endif
@@ -0,0 +1,170 @@
+/*  @file jobserver.cpp
+    @brief Contains JobServer - local socket for job submission and control
+
+    @author agent <agent@local>
+*/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <poll.h>
+#include <pwd.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sstream>
+#include "jobrequestscript.h"
+#include "jobserver.h"
+
+void* jobserver_exec_handler(void* arg)
+{
+	if (!arg) {
+                cerr << "FATAL ERROR: no JobServer reference given in jobserver_exec_handler" << endl;
+		exit(1);
+	}
+	pthread_cleanup_push(jobserver_cleanup_handler,arg);
+	JobServer *instance=static_cast<JobServer*>(arg);
+	instance->run();
+	pthread_cleanup_pop(1); // run the cleanup_handler and then deregister it
+	return NULL;
+}
+
+void jobserver_cleanup_handler(void* arg)
+{
+	if (!arg) {
+                cerr << "FATAL ERROR: no JobServer reference given in jobserver_cleanup_handler" << endl;
+		exit(1);
+	}
+	JobServer *instance=static_cast<JobServer*>(arg);
+	delete instance;
+}
+
+JobServer::JobServer(ostream &debug, unsigned short debug_level, ostream &error, string socketname, string script, PycStringIO_CAPI* cStringIO) throw (ApplicationError)
+:debug(debug),debug_level(debug_level),error(error),socketname(socketname),script(script),cStringIO(cStringIO),sock(-1)
+{
+	sockaddr_un addr;
+	if (socketname.size()>=sizeof(addr.sun_path))
+		throw ApplicationError("name of job socket too long ("+socketname+")","JobServer::JobServer()");
+	memset(&addr,0,sizeof(addr));
+	addr.sun_family=AF_UNIX;
+	strcpy(addr.sun_path,socketname.c_str());
+
+	if ((sock=socket(AF_UNIX,SOCK_STREAM,0))<0)
+		throw ApplicationError(string("can't create job socket (")+strerror(errno)+")","JobServer::JobServer()");
+
+	unlink(socketname.c_str()); // remove socket of former runs
+	if (bind(sock,reinterpret_cast<sockaddr*>(&addr),sizeof(addr)) || listen(sock,16)) {
+		string message=string("can't bind job socket to ")+socketname+" ("+strerror(errno)+")";
+		close(sock);
+		throw ApplicationError(message,"JobServer::JobServer()");
+	}
+	chmod(socketname.c_str(),0666); // access is checked per connection with the peer credentials
+
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+        pthread_attr_setdetachstate(&attr,PTHREAD_CREATE_DETACHED);
+        int ret=pthread_create(&thread_handle, &attr, jobserver_exec_handler, this);   // start thread as detached
+	if (ret) {
+		close(sock);
+		unlink(socketname.c_str());
+		throw ApplicationError("error while creating thread","JobServer::JobServer()");
+	}
+
+	if (debug_level>=2)
+		debug << prefix() << "JobServer listening on " << socketname << endl;
+}
+
+JobServer::~JobServer()
+{
+	close(sock);
+	unlink(socketname.c_str());
+	if (debug_level>=3)
+		debug << prefix() << "JobServer deleted" << endl;
+}
+
+void
+JobServer::requestTerminate()
+{
+	pthread_cancel(thread_handle);
+}
+
+void
+JobServer::run() throw()
+{
+	pollfd fds;
+	fds.fd=sock;
+	fds.events=POLLIN;
+	while (1) {
+		pthread_testcancel(); // cancellation point
+		if (poll(&fds,1,100)<=0) // timeout (100 msec) or signal
+			continue;
+		int fd=accept(sock,NULL,NULL);
+		if (fd<0) {
+			if (errno!=EINTR && errno!=ECONNABORTED)
+				error << prefix() << "can't accept connection on job socket (" << strerror(errno) << ")" << endl;
+			continue;
+		}
+		handleConnection(fd);
+	}
+}
+
+void
+JobServer::handleConnection(int fd)
+{
+	ucred cred;
+	socklen_t len=sizeof(cred);
+	if (getsockopt(fd,SOL_SOCKET,SO_PEERCRED,&cred,&len)) {
+		error << prefix() << "can't get credentials of job socket connection (" << strerror(errno) << ")" << endl;
+		close(fd);
+		return;
+	}
+
+	passwd pwd, *result=NULL;
+	char buffer[1024];
+	if (getpwuid_r(cred.uid,&pwd,buffer,sizeof(buffer),&result) || !result) {
+		error << prefix() << "unknown uid " << cred.uid << " connected to job socket" << endl;
+		close(fd);
+		return;
+	}
+
+	if (debug_level>=3)
+		debug << prefix() << "connection from user " << pwd.pw_name << " (pid " << cred.pid << ")" << endl;
+
+	if (JobRequestScript::running()>=max_connections || JobRequestScript::running(cred.uid)>=max_user_connections) {
+		if (debug_level>=1)
+			debug << prefix() << "too many connections, refusing connection from user " << pwd.pw_name << endl;
+		const char reply[]="ERROR too%20many%20connections\n"; // see capisuite.jobsocket for the protocol
+		send(fd,reply,sizeof(reply)-1,MSG_DONTWAIT|MSG_NOSIGNAL);
+		close(fd);
+		return;
+	}
+
+	try {
+		new JobRequestScript(debug,debug_level,error,fd,cred.uid,pwd.pw_name,script,cStringIO); // will self-delete
+	}
+	catch (ApplicationError e) {
+		error << prefix() << "ERROR: can't start JobRequestScript thread, message was: " << e << endl;
+		close(fd);
+	}
+}
+
+string
+JobServer::prefix()
+{
+	stringstream s;
+	time_t t=time(NULL);
+	char* ct=ctime(&t);
+	ct[24]='\0';
+	s << ct << " JobServer " << hex << this << ": ";
+	return (s.str());
+}
@@ -0,0 +1,120 @@
+/** @file jobserver.h
+    @brief Contains JobServer - local socket for job submission and control
+
+    @author agent <agent@local>
+*/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef JOBSERVER_H
+#define JOBSERVER_H
+
+#include <pthread.h>
+#include <string>
+#include <iostream>
+#include "applicationexception.h"
+
+using namespace std;
+
+class PycStringIO_CAPI;
+
+/** @brief Thread exec handler for JobServer class
+
+    This is a handler which will call this->run() for the use in pthread_create().
+    It will also register jobserver_cleanup_handler
+*/
+void* jobserver_exec_handler(void* arg);
+
+/** @brief Thread clean handler for JobServer class
+
+    This is a handler which is called by pthreads at cleanup.
+    It will delete the JobServer object.
+*/
+void jobserver_cleanup_handler(void* arg);
+
+/** @brief Local socket for submitting and controlling send jobs
+
+    Submitting jobs with capisuitefax needs lock files, counter files and a scan
+    of the queue directories by the idle script. Applications submitting many jobs
+    can talk to the running daemon over a unix domain socket instead.
+
+    This class creates the listening socket and accepts the connections in an own thread.
+    The user of each connection is determined from the credentials of the connected
+    process (SO_PEERCRED), so nobody can access the jobs of another user (except root).
+    The requests are handled by the python function jobRequest() of the idle script
+    which is called in an own thread for each connection (see JobRequestScript). The
+    protocol is defined there.
+
+    Each connection needs a thread and a python interpreter, so at most max_connections
+    connections are handled at a time, and at most max_user_connections of them for
+    each user. Further connections are refused with an error message.
+
+    @author agent
+*/
+class JobServer
+{
+	friend void* jobserver_exec_handler(void*);
+	friend void jobserver_cleanup_handler(void*);
+
+	public:
+		/** @brief Constructor. Create the socket and start a detached thread listening on it.
+
+		    An existing socket file with this name is removed.
+
+		    @param debug stream for debugging info
+		    @param debug_level verbosity level for debug messages
+		    @param error stream for error messages
+		    @param socketname path of the socket to create
+		    @param script file name of the python script providing the function jobRequest()
+		    @param cStringIO pointer to the Python cStringIO C API
+		    @throw ApplicationError Thrown if the socket or the thread can't be created
+		*/
+		JobServer(ostream &debug, unsigned short debug_level, ostream &error, string socketname, string script, PycStringIO_CAPI* cStringIO) throw (ApplicationError);
+
+		/** @brief Destructor. Close and remove the socket.
+		*/
+		~JobServer();
+
+		/** @brief terminate thread, the object will delete itself
+		*/
+		void requestTerminate();
+
+	private:
+		/** @brief Thread body. Accept connections and start a JobRequestScript for each of them.
+		*/
+		void run() throw();
+
+		/** @brief Start a JobRequestScript for an accepted connection
+
+		    @param fd file descriptor of the connection, will be closed by JobRequestScript or here in case of errors
+		*/
+		void handleConnection(int fd);
+
+		/** @brief return a prefix containing this pointer and date for log messages
+
+		    @return constructed prefix as string
+		*/
+		string prefix();
+
+		ostream &debug; ///< debug stream
+		unsigned short debug_level; ///< verbosity level for debug stream
+		ostream &error; ///< stream for error messages
+		string socketname; ///< path of the socket
+		string script; ///< name of the python script handling the requests
+		PycStringIO_CAPI* cStringIO; ///< pointer to the Python cStringIO C API
+		int sock; ///< the listening socket
+
+		static const unsigned max_connections=16; ///< maximal number of connections handled at a time
+		static const unsigned max_user_connections=4; ///< maximal number of connections of one user handled at a time
+
+		pthread_t thread_handle; ///< handle for the created pthread thread
+};
+
+#endif
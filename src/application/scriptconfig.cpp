@@ -0,0 +1,227 @@
+/*  @file scriptconfig.cpp
+    @brief Contains ScriptConfig - process-wide parsed snapshot of the script configuration
+
+    @author agent <agent@local>
+*/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include <fstream>
+#include <ctype.h>
+#include "scriptconfig.h"
+
+map<string,ScriptConfig::Snapshot*> ScriptConfig::snapshots;
+unsigned long ScriptConfig::reloads=0;
+pthread_mutex_t ScriptConfig::mutex=PTHREAD_MUTEX_INITIALIZER;
+
+const ScriptConfig::Section*
+ScriptConfig::Snapshot::section(const string &name) const
+{
+	map<string,unsigned>::const_iterator it=index.find(name);
+	return it==index.end() ? NULL : &sections[it->second];
+}
+
+const string*
+ScriptConfig::Snapshot::option(const string &sectionname, const string &name) const
+{
+	const Section *s=section(sectionname);
+	if (s) {
+		map<string,unsigned>::const_iterator it=s->index.find(name);
+		if (it!=s->index.end())
+			return &s->options[it->second].second;
+	}
+	for (unsigned i=0;i<defaults.size();i++)
+		if (defaults[i].first==name)
+			return &defaults[i].second;
+	return NULL;
+}
+
+const ScriptConfig::Snapshot*
+ScriptConfig::acquire(const vector<string> &files)
+{
+	string k=key(files);
+	pthread_mutex_lock(&mutex);
+	map<string,Snapshot*>::iterator it=snapshots.find(k);
+	if (it==snapshots.end()) {
+		pthread_mutex_unlock(&mutex);
+		// parse w/o holding the lock, if another thread was quicker, take its snapshot
+		Snapshot *parsed=parse(files);
+		pthread_mutex_lock(&mutex);
+		parsed->generation=reloads;
+		it=snapshots.find(k);
+		if (it==snapshots.end())
+			it=snapshots.insert(make_pair(k,parsed)).first;
+		else
+			delete parsed;
+	}
+	Snapshot *snapshot=it->second;
+	snapshot->refcount++;
+	pthread_mutex_unlock(&mutex);
+	return snapshot;
+}
+
+void
+ScriptConfig::release(const Snapshot *snapshot)
+{
+	if (!snapshot)
+		return;
+	Snapshot *s=const_cast<Snapshot*>(snapshot);
+	pthread_mutex_lock(&mutex);
+	if (s->refcount)
+		s->refcount--;
+	if (!s->current && !s->refcount)
+		delete s;
+	pthread_mutex_unlock(&mutex);
+}
+
+void
+ScriptConfig::reload()
+{
+	vector<vector<string> > files;
+	pthread_mutex_lock(&mutex);
+	for (map<string,Snapshot*>::iterator it=snapshots.begin();it!=snapshots.end();it++)
+		files.push_back(it->second->files);
+	pthread_mutex_unlock(&mutex);
+
+	vector<Snapshot*> parsed;
+	for (unsigned i=0;i<files.size();i++)
+		parsed.push_back(parse(files[i]));
+
+	pthread_mutex_lock(&mutex);
+	reloads++;
+	for (unsigned i=0;i<parsed.size();i++) {
+		parsed[i]->generation=reloads;
+		Snapshot* &entry=snapshots[key(files[i])];
+		if (entry) {
+			entry->current=false;
+			if (!entry->refcount)
+				delete entry;
+		}
+		entry=parsed[i];
+	}
+	pthread_mutex_unlock(&mutex);
+}
+
+unsigned long
+ScriptConfig::generation()
+{
+	pthread_mutex_lock(&mutex);
+	unsigned long g=reloads;
+	pthread_mutex_unlock(&mutex);
+	return g;
+}
+
+ScriptConfig::Snapshot*
+ScriptConfig::parse(const vector<string> &files)
+{
+	Snapshot *snapshot=new Snapshot;
+	snapshot->files=files;
+	snapshot->valid=true;
+	snapshot->generation=0;
+	snapshot->refcount=0;
+	snapshot->current=true;
+	for (unsigned i=0;i<files.size();i++) {
+		ifstream file(files[i].c_str());
+		if (file) // missing files are ignored like in RawConfigParser.read()
+			parseFile(file,snapshot);
+	}
+	return snapshot;
+}
+
+static string
+strip(const string &s)
+{
+	string::size_type start=s.find_first_not_of(" \t\r\n\f\v");
+	if (start==string::npos)
+		return "";
+	return s.substr(start,s.find_last_not_of(" \t\r\n\f\v")-start+1);
+}
+
+void
+ScriptConfig::parseFile(istream &file, Snapshot *snapshot)
+{
+	Options *options=NULL; // options of the current section
+	map<string,unsigned> *index=NULL; // index of the current section, NULL for DEFAULT
+	int current=-1; // position of the current option in options
+	string line;
+	while (getline(file,line)) {
+		if (strip(line).empty() || line[0]=='#' || line[0]==';')
+			continue;
+		if ((line[0]=='r' || line[0]=='R') && line.size()>=3 && tolower(line[1])=='e' && tolower(line[2])=='m'
+		  && (line.size()==3 || isspace(line[3])))
+			continue; // "rem" comment
+		if (isspace(line[0]) && options && current>=0) { // continuation line
+			string value=strip(line);
+			if (!value.empty())
+				(*options)[current].second+="\n"+value;
+			continue;
+		}
+		string::size_type end;
+		if (line[0]=='[' && (end=line.find(']'))!=string::npos && end>1) { // section header
+			string name=line.substr(1,end-1);
+			if (name=="DEFAULT") {
+				options=&snapshot->defaults;
+				index=NULL;
+			} else {
+				map<string,unsigned>::iterator it=snapshot->index.find(name);
+				if (it==snapshot->index.end()) {
+					it=snapshot->index.insert(make_pair(name,snapshot->sections.size())).first;
+					snapshot->sections.push_back(Section());
+					snapshot->sections.back().name=name;
+				}
+				options=&snapshot->sections[it->second].options;
+				index=&snapshot->sections[it->second].index;
+			}
+			current=-1;
+			continue;
+		}
+		string::size_type sep=line.find_first_of(":=");
+		if (!options || isspace(line[0]) || sep==string::npos || sep==0) {
+			snapshot->valid=false; // let RawConfigParser report the error
+			continue;
+		}
+		string name=strip(line.substr(0,sep)), value=line.substr(sep+1);
+		for (unsigned i=0;i<name.size();i++)
+			name[i]=tolower(name[i]);
+		string::size_type comment=value.find(';');
+		if (comment!=string::npos && comment>0 && isspace(value[comment-1]))
+			value.erase(comment);
+		value=strip(value);
+		if (value=="\"\"")
+			value="";
+
+		current=-1;
+		if (index) {
+			map<string,unsigned>::iterator it=index->find(name);
+			if (it!=index->end())
+				current=it->second;
+		} else {
+			for (unsigned i=0;i<options->size();i++)
+				if ((*options)[i].first==name)
+					current=i;
+		}
+		if (current<0) {
+			current=options->size();
+			options->push_back(make_pair(name,value));
+			if (index)
+				(*index)[name]=current;
+		} else
+			(*options)[current].second=value;
+	}
+}
+
+string
+ScriptConfig::key(const vector<string> &files)
+{
+	string k;
+	for (unsigned i=0;i<files.size();i++)
+		k+=files[i]+'\n';
+	return k;
+}
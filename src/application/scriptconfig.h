@@ -0,0 +1,126 @@
+/** @file scriptconfig.h
+    @brief Contains ScriptConfig - process-wide parsed snapshot of the script configuration
+
+    @author agent <agent@local>
+*/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef SCRIPTCONFIG_H
+#define SCRIPTCONFIG_H
+
+#include <pthread.h>
+#include <istream>
+#include <string>
+#include <vector>
+#include <map>
+
+using namespace std;
+
+/** @brief Process-wide parsed snapshot of the script configuration
+
+    The scripts read their configuration (fax.conf and answering_machine.conf) with
+    capisuite.config.readGlobalConfig(). As each incoming call is handled in a new
+    interpreter, reading and parsing the files there would delay answering each call.
+
+    So the files are parsed once by this class into a snapshot which is shared by all
+    interpreters. readGlobalConfig() only has to convert it to a CSConfigParser object.
+    A snapshot is never changed after it was created. On reload() (called when the
+    process gets a SIGHUP), new snapshots are parsed from the files and replace the old
+    ones, while scripts still using an old snapshot keep it until they release it.
+
+    The files are parsed like the Python RawConfigParser does, so the scripts get
+    the same values as if they read the files themselves.
+
+    All methods are static and thread-safe.
+
+    @author agent
+*/
+class ScriptConfig
+{
+	public:
+		typedef vector<pair<string,string> > Options; ///< options of a section (name, raw value) in file order
+
+		/** @brief One section of the configuration
+		*/
+		class Section
+		{
+			public:
+				string name; ///< name of the section
+				Options options; ///< options of the section
+				map<string,unsigned> index; ///< position of each option in options
+		};
+
+		/** @brief Parsed contents of some config files
+		*/
+		class Snapshot
+		{
+			public:
+				/** @brief Return a section, NULL if it doesn't exist
+				*/
+				const Section* section(const string &name) const;
+
+				/** @brief Return an option of a section, NULL if it doesn't exist
+				*/
+				const string* option(const string &section, const string &name) const;
+
+				vector<string> files; ///< the files which were read
+				Options defaults; ///< options of the DEFAULT section
+				vector<Section> sections; ///< all other sections in file order
+				map<string,unsigned> index; ///< position of each section in sections
+				bool valid; ///< false if a file contained errors, the scripts must read the files themselves then
+				unsigned long generation; ///< number of the reload() which created this snapshot
+				unsigned refcount; ///< number of users of this snapshot, protected by mutex
+				bool current; ///< false if this snapshot was replaced, protected by mutex
+		};
+
+		/** @brief Get the current snapshot of the given files, parse them if they weren't read before
+
+		    Files which don't exist are ignored. The snapshot must be given back with
+		    release() after use.
+
+		    @param files names of the config files to read, later ones override earlier ones
+		    @return the snapshot
+		*/
+		static const Snapshot* acquire(const vector<string> &files);
+
+		/** @brief Release a snapshot got from acquire()
+		*/
+		static void release(const Snapshot *snapshot);
+
+		/** @brief Parse all files again and replace the current snapshots
+
+		    Must not be called from a signal handler.
+		*/
+		static void reload();
+
+		/** @brief Return the number of reload() calls, increased after the snapshots were replaced
+		*/
+		static unsigned long generation();
+
+	private:
+		/** @brief Read the given files into a new snapshot
+		*/
+		static Snapshot* parse(const vector<string> &files);
+
+		/** @brief Parse one config file into a snapshot
+		*/
+		static void parseFile(istream &file, Snapshot *snapshot);
+
+		/** @brief Return the key for the given file names in snapshots
+		*/
+		static string key(const vector<string> &files);
+
+		static map<string,Snapshot*> snapshots; ///< current snapshots, referenced by key()
+		static unsigned long reloads; ///< number of reload() calls
+		static pthread_mutex_t mutex; ///< to realize critical sections in all methods
+};
+
+#endif
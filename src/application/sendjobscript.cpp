@@ -0,0 +1,202 @@
+/*  @file sendjobscript.cpp
+    @brief Contains SendJobScript - Python thread for sending one job of the send queue
+
+    @author agent <agent@local>
+*/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include <Python.h>
+#include "../backend/capi.h"
+#include "../backend/connection.h"
+#include "sendjobscript.h"
+#include "capisuitemodule.h"
+
+map<string,SendJobScript::JobT> SendJobScript::jobs;
+pthread_mutex_t SendJobScript::jobs_mutex=PTHREAD_MUTEX_INITIALIZER;
+bool SendJobScript::busy=false;
+
+void* sendjobscript_exec_handler(void* arg)
+{
+	if (!arg) {
+                cerr << "FATAL ERROR: no SendJobScript reference given in sendjobscript_exec_handler" << endl;
+		exit(1);
+	}
+	pthread_cleanup_push(sendjobscript_cleanup_handler,arg);
+	SendJobScript *instance=static_cast<SendJobScript*>(arg);
+	instance->run();
+	pthread_cleanup_pop(1); // run the cleanup_handler and then deregister it
+	return NULL;
+}
+
+void sendjobscript_cleanup_handler(void* arg)
+{
+	if (!arg) {
+                cerr << "FATAL ERROR: no SendJobScript reference given in sendjobscript_cleanup_handler" << endl;
+		exit(1);
+	}
+	SendJobScript *instance=static_cast<SendJobScript*>(arg);
+	instance->final();
+}
+
+int
+SendJobScript::start(ostream &debug, unsigned short debug_level, ostream &error, Capi *capi, const vector<_cdword> &controllers, string user, string job, string script, PycStringIO_CAPI* cStringIO) throw (ApplicationError)
+{
+	pthread_mutex_lock(&jobs_mutex);
+	if (jobs.count(job)) {
+		pthread_mutex_unlock(&jobs_mutex);
+		return -1;
+	}
+	map<_cdword,unsigned> pending; // jobs which haven't created their connection yet
+	for (map<string,JobT>::iterator it=jobs.begin();it!=jobs.end();it++)
+		if (!it->second.called)
+			pending[it->second.controller]++;
+	_cdword controller=capi->selectController(Connection::FAXG3,controllers,pending);
+	busy=!controller;
+	if (!controller) {
+		pthread_mutex_unlock(&jobs_mutex);
+		return 0;
+	}
+	jobs[job].controller=controller;
+	pthread_mutex_unlock(&jobs_mutex);
+
+	try {
+		new SendJobScript(debug,debug_level,error,capi,controller,user,job,script,cStringIO); // will self-delete
+	}
+	catch (ApplicationError e) {
+		pthread_mutex_lock(&jobs_mutex);
+		jobs.erase(job);
+		pthread_mutex_unlock(&jobs_mutex);
+		throw;
+	}
+	return 1;
+}
+
+unsigned
+SendJobScript::running(_cdword controller)
+{
+	pthread_mutex_lock(&jobs_mutex);
+	unsigned count=0;
+	for (map<string,JobT>::iterator it=jobs.begin();it!=jobs.end();it++)
+		if (!controller || it->second.controller==controller)
+			count++;
+	pthread_mutex_unlock(&jobs_mutex);
+	return count;
+}
+
+bool
+SendJobScript::isRunning(string job)
+{
+	pthread_mutex_lock(&jobs_mutex);
+	bool found=jobs.count(job);
+	pthread_mutex_unlock(&jobs_mutex);
+	return found;
+}
+
+bool
+SendJobScript::channelsBusy()
+{
+	pthread_mutex_lock(&jobs_mutex);
+	bool result=busy;
+	pthread_mutex_unlock(&jobs_mutex);
+	return result;
+}
+
+void
+SendJobScript::callPlaced()
+{
+	pthread_mutex_lock(&jobs_mutex);
+	for (map<string,JobT>::iterator it=jobs.begin();it!=jobs.end();it++)
+		if (it->second.running && pthread_equal(it->second.thread,pthread_self()))
+			it->second.called=true;
+	pthread_mutex_unlock(&jobs_mutex);
+}
+
+SendJobScript::SendJobScript(ostream &debug, unsigned short debug_level, ostream &error, Capi *capi, _cdword controller, string user, string job, string script, PycStringIO_CAPI* cStringIO) throw (ApplicationError)
+:PythonScript(debug,debug_level,error,script,"sendJob",cStringIO),capi(capi),controller(controller),user(user),job(job)
+{
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+        pthread_attr_setdetachstate(&attr,PTHREAD_CREATE_DETACHED);
+        int ret=pthread_create(&thread_handle, &attr, sendjobscript_exec_handler, this);   // start thread as detached
+	if (ret)
+		throw ApplicationError("error while creating thread","SendJobScript::SendJobScript()");
+
+	if (debug_level>=2)
+		debug << prefix() << "SendJobScript created for job " << job << " on controller " << controller << endl;
+}
+
+SendJobScript::~SendJobScript()
+{
+	pthread_mutex_lock(&jobs_mutex);
+	jobs.erase(job);
+	busy=false; // our B channel is free now
+	pthread_mutex_unlock(&jobs_mutex);
+
+	if (debug_level>=2)
+		debug << prefix() << "SendJobScript deleted" << endl;
+}
+
+void
+SendJobScript::run() throw()
+{
+	PyObject *capi_ref=NULL;
+	PyThreadState *py_state=NULL;
+
+	pthread_mutex_lock(&jobs_mutex);
+	JobT &state=jobs[job];
+	state.thread=pthread_self();
+	state.running=true;
+	pthread_mutex_unlock(&jobs_mutex);
+
+	try {
+		PyEval_AcquireLock();
+
+		if (!(py_state=Py_NewInterpreter() )) {
+			PyEval_ReleaseLock();
+			throw ApplicationError("error while creating new python interpreter","SendJobScript::run()");
+		}
+
+		capisuitemodule_init();
+
+		capi_ref=PyCObject_FromVoidPtr(capi,NULL); // new ref
+		if (!capi_ref)
+			throw ApplicationError("unable to create CObject from Capi reference","SendJobScript::run()");
+
+		args=Py_BuildValue("Oiss",capi_ref,controller,user.c_str(),job.c_str());
+		if (!args)
+			throw ApplicationError("error during argument building","SendJobScript::run()");
+
+		PythonScript::run();
+
+		Py_DECREF(args);
+		args=NULL;
+
+		Py_DECREF(capi_ref);
+		capi_ref=NULL;
+
+		Py_EndInterpreter(py_state);
+		py_state=NULL;
+		PyEval_ReleaseLock(); // release lock
+	}
+	catch(ApplicationError e) {
+		error << prefix() << "Error occured. message was: " << e << endl;
+
+		if (args)
+			Py_DECREF(args);
+		if (capi_ref)
+			Py_DECREF(capi_ref);
+		if (py_state) {
+			Py_EndInterpreter(py_state);
+			py_state=NULL;
+			PyEval_ReleaseLock();
+		}
+	}
+}
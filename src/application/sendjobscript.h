@@ -0,0 +1,174 @@
+/** @file sendjobscript.h
+    @brief Contains SendJobScript - Python thread for sending one job of the send queue
+
+    @author agent <agent@local>
+*/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef SENDJOBSCRIPT_H
+#define SENDJOBSCRIPT_H
+
+#include <pthread.h>
+#include <capi20.h>
+#include <string>
+#include <map>
+#include <vector>
+#include "applicationexception.h"
+#include "pythonscript.h"
+
+class Capi;
+class PycStringIO_CAPI;
+
+/** @brief Thread exec handler for SendJobScript class
+
+    This is a handler which will call this->run() for the use in pthread_create().
+    It will also register sendjobscript_cleanup_handler
+*/
+void* sendjobscript_exec_handler(void* arg);
+
+/** @brief Thread clean handler for SendJobScript class
+
+    This is a handler which is called by pthreads at cleanup.
+    It will call this->final().
+*/
+void sendjobscript_cleanup_handler(void* arg);
+
+/** @brief Send scheduler. One object for each job sent in parallel is created.
+
+    The idle script doesn't send the jobs itself, but hands them over to start().
+    start() chooses the least loaded of the allowed controllers which has a free
+    B channel (see Capi::selectController()) and creates an object of this class then. It runs the python function sendJob() of the idle
+    script in a new thread with an own python subinterpreter, so as many jobs
+    can be sent in parallel as B channels are available.
+
+    The number of free B channels is calculated from the B channels of each controller
+    (see Capi::getBChannels()), the connections currently existing on it (including
+    incoming calls, see Capi::getActiveConnections()) and the jobs started on it
+    which haven't created their connection yet. A job reports its connection by
+    callPlaced().
+
+    All running jobs are registered by name, so a job can't be started twice.
+
+    @author agent
+*/
+class SendJobScript: public PythonScript
+{
+	friend void* sendjobscript_exec_handler(void*);
+	friend void sendjobscript_cleanup_handler(void*);
+
+	public:
+		/** @brief Start sending a job if a B channel is free
+
+		    @param debug stream for debugging info
+		    @param debug_level verbosity level for debug messages
+		    @param error stream for error messages
+		    @param capi reference to Capi object
+		    @param controllers controllers which may be used for the job, all if empty
+		    @param user owner of the job
+		    @param job name of the job (e.g. its control file), must be unique
+		    @param script file name of the python script providing the function sendJob()
+		    @param cStringIO pointer to the Python cStringIO C API
+		    @return 1 if the job was started, 0 if no B channel is free on these controllers, -1 if the job is already running
+		    @throw ApplicationError Thrown if thread can't be started
+		*/
+		static int start(ostream &debug, unsigned short debug_level, ostream &error, Capi *capi, const vector<_cdword> &controllers, string user, string job, string script, PycStringIO_CAPI* cStringIO) throw (ApplicationError);
+
+		/** @brief Return the number of jobs currently sent
+
+		    @param controller count only jobs on this controller, 0 for all
+		    @return number of running jobs
+		*/
+		static unsigned running(_cdword controller=0);
+
+		/** @brief Check if a job is currently sent
+
+		    @param job name of the job
+		    @return true if the job is running
+		*/
+		static bool isRunning(string job);
+
+		/** @brief Check if the last call of start() found no free B channel
+
+		    This stays true until a job finishes or start() succeeds, so the idle script
+		    doesn't need to retry the waiting jobs before.
+
+		    @return true if all B channels were busy
+		*/
+		static bool channelsBusy();
+
+		/** @brief Note that the job sent by the calling thread has created its connection
+
+		    From now on, the connection of the job is counted by Capi::getActiveConnections(),
+		    so start() doesn't count the job itself any more. Nothing is done if the calling
+		    thread doesn't send a job.
+		*/
+		static void callPlaced();
+
+		/** @brief Destructor. Unregister the job.
+		*/
+		virtual ~SendJobScript();
+
+	private:
+		/** @brief Constructor. Create Object and start detached thread
+
+		    See start() for a description of the parameters.
+
+		    @throw ApplicationError Thrown if thread can't be started
+		*/
+		SendJobScript(ostream &debug, unsigned short debug_level, ostream &error, Capi *capi, _cdword controller, string user, string job, string script, PycStringIO_CAPI* cStringIO) throw (ApplicationError);
+
+		/** @brief Thread body. Calls the python function sendJob() which will send the job.
+
+		    The read Python script must provide a function named sendJob with the following signature:
+
+		    def sendJob(capi, controller, user, job):
+		    	# function body
+
+		    The parameters given to the python function are:
+			- capi: reference to the capi providing the interface to the ISDN hardware (needed for the call_*() functions)
+			- controller: controller to use for the call
+			- user: owner of the job
+			- job: the job name given to start()
+
+		    A new python subinterpreter is created for each job.
+		*/
+		virtual void run() throw();
+
+		Capi *capi; ///< reference to Capi object
+		_cdword controller; ///< controller used for this job
+		string user, ///< owner of the job
+		       job; ///< name of the job
+
+		pthread_t thread_handle; ///< handle for the created pthread thread
+
+		/** @brief type for storing the state of a running job
+		*/
+		class JobT
+		{
+			public:
+			/** @brief default constructor
+			*/
+			JobT()
+			:controller(0),running(false),called(false)
+			{}
+
+			_cdword controller; ///< controller used for the job
+			pthread_t thread; ///< thread sending the job, only valid if running is true
+			bool running; ///< true when the thread sending the job is running
+			bool called; ///< true when the job has created its connection (see callPlaced())
+		};
+
+		static map<string,JobT> jobs; ///< state of all running jobs, referenced by job name
+		static pthread_mutex_t jobs_mutex; ///< to realize critical sections when accessing jobs
+		static bool busy; ///< true if start() found no free B channel and no job finished since, protected by jobs_mutex
+};
+
+#endif
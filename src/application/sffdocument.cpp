@@ -0,0 +1,104 @@
+/*  @file sffdocument.cpp
+    @brief Contains SffDocument - parser for Structured Fax Files
+
+    @author agent <agent@local>
+*/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "sffdocument.h"
+
+int
+SffDocument::Page::dpiX() const
+{
+	return 204; // only 203 dpi is used, TIFF Class F and most viewers expect 204
+}
+
+int
+SffDocument::Page::dpiY() const
+{
+	switch (vres) {
+		case 1:
+			return 196;
+		case 2:
+			return 391;
+		default:
+			return 98;
+	}
+}
+
+SffDocument::SffDocument(const string &data) throw (ApplicationError)
+{
+	const unsigned char *d=reinterpret_cast<const unsigned char*>(data.data());
+	string::size_type size=data.size();
+
+	if (size<20 || data.compare(0,4,"Sfff"))
+		throw ApplicationError("file is no SFF file","SffDocument::SffDocument()");
+
+	string::size_type pos=d[10] | (d[11] << 8); // offset of first page header
+	while (pos<size) {
+		unsigned char type=d[pos];
+		if (type==254) { // page header
+			if (pos+1>=size || !d[pos+1]) // length 0 marks the end of the document
+				break;
+			unsigned char length=d[pos+1];
+			if (length<4 || pos+2+length>size)
+				throw ApplicationError("invalid page header","SffDocument::SffDocument()");
+			if (d[pos+4]) // only MH is defined by CAPI
+				throw ApplicationError("unsupported coding in page header","SffDocument::SffDocument()");
+			Page p;
+			p.vres=d[pos+2];
+			p.hres=d[pos+3];
+			if (length>=6)
+				p.width=d[pos+6] | (d[pos+7] << 8);
+			pages.push_back(p);
+			pos+=2+length;
+		} else if (pages.empty()) {
+			throw ApplicationError("page data found before first page header","SffDocument::SffDocument()");
+		} else if (type==0) { // line longer than 216 bytes, length follows as word
+			if (pos+3>size)
+				throw ApplicationError("unexpected end of file","SffDocument::SffDocument()");
+			string::size_type length=d[pos+1] | (d[pos+2] << 8);
+			if (pos+3+length>size)
+				throw ApplicationError("unexpected end of file","SffDocument::SffDocument()");
+			pages.back().lines.push_back(data.substr(pos+3,length));
+			pos+=3+length;
+		} else if (type<=216) { // normal line, type gives the length
+			if (pos+1+type>size)
+				throw ApplicationError("unexpected end of file","SffDocument::SffDocument()");
+			pages.back().lines.push_back(data.substr(pos+1,type));
+			pos+=1+type;
+		} else if (type<=253) { // white lines
+			pages.back().lines.insert(pages.back().lines.end(),type-216,string());
+			pos++;
+		} else { // 255: illegal line coding (followed by 0) or user information (followed by its length)
+			if (pos+1>=size)
+				break;
+			if (!d[pos+1]) { // repeat the last line to hide the error
+				vector<string> &lines=pages.back().lines;
+				lines.push_back(lines.empty() ? string() : lines.back());
+				pos+=2;
+			} else
+				pos+=2+d[pos+1];
+		}
+	}
+}
+
+unsigned
+SffDocument::pageCount() const
+{
+	return pages.size();
+}
+
+const SffDocument::Page&
+SffDocument::page(unsigned i) const
+{
+	return pages[i];
+}
@@ -0,0 +1,94 @@
+/** @file sffdocument.h
+    @brief Contains SffDocument - parser for Structured Fax Files
+
+    @author agent <agent@local>
+*/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef SFFDOCUMENT_H
+#define SFFDOCUMENT_H
+
+#include <string>
+#include <vector>
+#include "applicationexception.h"
+
+using namespace std;
+
+/** @brief Parser for Structured Fax Files
+
+    CAPI saves received faxes in the Structured Fax File format (SFF, see CAPI 2.0
+    spec, annex B). An SFF file consists of a document header, and for each page
+    a page header followed by the lines of the page. Each line is coded with
+    Modified Huffman (MH, i.e. ITU T.4 1D) w/o EOL codes and starts at a byte
+    boundary. Runs of white lines are coded as a simple counter.
+
+    This class splits an SFF file into its pages and lines. The lines are not decoded,
+    so they can be copied to other formats using the same coding (e.g. TIFF Class F
+    or PDF with CCITTFaxDecode) w/o touching the image data.
+
+    @author agent
+*/
+class SffDocument
+{
+	public:
+		/** @brief One page of the document
+		*/
+		class Page
+		{
+			public:
+				/** @brief Constructor. Create an empty page.
+				*/
+				Page():vres(0),hres(0),width(1728)
+				{}
+
+				/** @brief return the horizontal resolution
+
+				    @return resolution in dpi
+				*/
+				int dpiX() const;
+
+				/** @brief return the vertical resolution
+
+				    @return resolution in lines per inch
+				*/
+				int dpiY() const;
+
+				unsigned char vres; ///< vertical resolution code from the page header (0=98 lpi, 1=196 lpi, 2=391 lpi)
+				unsigned char hres; ///< horizontal resolution code from the page header (0=203 dpi)
+				unsigned short width; ///< line length in pixels
+				vector<string> lines; ///< MH coded lines w/o EOL, LSB first; an empty string stands for a white line
+		};
+
+		/** @brief Constructor. Parse the given SFF data.
+
+		    @param data contents of an SFF file
+		    @throw ApplicationError Thrown if the data isn't a valid SFF file or uses an unsupported coding
+		*/
+		SffDocument(const string &data) throw (ApplicationError);
+
+		/** @brief return the number of pages
+
+		    @return number of pages found in the file
+		*/
+		unsigned pageCount() const;
+
+		/** @brief return one page
+
+		    @param i number of the page (starting with 0)
+		    @return reference to the page
+		*/
+		const Page& page(unsigned i) const;
+
+	private:
+		vector<Page> pages; ///< all pages of the document
+};
+
+#endif
@@ -0,0 +1,212 @@
+/*  @file audiocodec.cpp
+    @brief Contains AudioCodec - A-Law and IMA ADPCM coding of audio data
+
+    @author agent <agent@local>
+*/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include <string.h>
+#include "audiocodec.h"
+
+#define ADPCM_MAGIC "CSADPCM1"
+#define ADPCM_MAGIC_LEN 8
+
+static const int index_table[16] = {
+	-1, -1, -1, -1, 2, 4, 6, 8,
+	-1, -1, -1, -1, 2, 4, 6, 8
+};
+
+static const int step_table[89] = {
+	7, 8, 9, 10, 11, 12, 13, 14, 16, 17,
+	19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+	50, 55, 60, 66, 73, 80, 88, 97, 107, 118,
+	130, 143, 157, 173, 190, 209, 230, 253, 279, 307,
+	337, 371, 408, 449, 494, 544, 598, 658, 724, 796,
+	876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066,
+	2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358,
+	5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899,
+	15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+};
+
+short AudioCodec::la_table[256];
+unsigned char AudioCodec::reverse_table[256];
+bool AudioCodec::initialized=AudioCodec::init(); // filled at startup, so we need no locking later
+
+AudioCodec::AudioCodec()
+:predictor(0),index(0),half(false),pending(0)
+{}
+
+string
+AudioCodec::encode(const unsigned char *la, unsigned long length)
+{
+	string data;
+	data.reserve(length/2+1);
+	for (unsigned long i=0;i<length;i++) {
+		unsigned char nibble=encodeSample(la_table[la[i]]);
+		if (half) {
+			data+=static_cast<char>(pending | (nibble << 4));
+			half=false;
+		} else {
+			pending=nibble;
+			half=true;
+		}
+	}
+	return data;
+}
+
+string
+AudioCodec::flush()
+{
+	if (!half)
+		return "";
+	half=false;
+	return string(1,static_cast<char>(pending));
+}
+
+string
+AudioCodec::decode(const char *data, unsigned long length)
+{
+	string la(length*2,'\0');
+	for (unsigned long i=0;i<length;i++) {
+		unsigned char byte=static_cast<unsigned char>(data[i]);
+		la[2*i]=static_cast<char>(linear2la(decodeSample(byte & 0x0f)));
+		la[2*i+1]=static_cast<char>(linear2la(decodeSample(byte >> 4)));
+	}
+	return la;
+}
+
+string
+AudioCodec::decodeFile(const string &data)
+{
+	AudioCodec codec;
+	if (data.size()<=ADPCM_MAGIC_LEN)
+		return "";
+	return codec.decode(data.data()+ADPCM_MAGIC_LEN,data.size()-ADPCM_MAGIC_LEN);
+}
+
+bool
+AudioCodec::isAdpcm(const char *data, unsigned long length)
+{
+	return (length>=ADPCM_MAGIC_LEN && !memcmp(data,ADPCM_MAGIC,ADPCM_MAGIC_LEN));
+}
+
+string
+AudioCodec::header()
+{
+	return ADPCM_MAGIC;
+}
+
+unsigned char
+AudioCodec::linear2la(short linear)
+{
+	int sign=(linear>=0) ? 0x80 : 0;
+	int magnitude=(linear>=0) ? linear : -linear-1;
+	if (magnitude>32767)
+		magnitude=32767;
+
+	unsigned char a;
+	if (magnitude<256)
+		a=magnitude >> 4;
+	else {
+		int seg=1;
+		while (seg<7 && magnitude >= (512 << (seg-1)))
+			seg++;
+		a=(seg << 4) | ((magnitude >> (seg+3)) & 0x0f);
+	}
+	return reverse_table[(a | sign) ^ 0x55];
+}
+
+unsigned char
+AudioCodec::encodeSample(int sample)
+{
+	int step=step_table[index];
+	int diff=sample-predictor;
+	unsigned char nibble=0;
+	if (diff<0) {
+		nibble=8;
+		diff=-diff;
+	}
+	int delta=step >> 3;
+	if (diff>=step) {
+		nibble|=4;
+		diff-=step;
+		delta+=step;
+	}
+	step>>=1;
+	if (diff>=step) {
+		nibble|=2;
+		diff-=step;
+		delta+=step;
+	}
+	step>>=1;
+	if (diff>=step) {
+		nibble|=1;
+		delta+=step;
+	}
+	predictor+=(nibble & 8) ? -delta : delta;
+	if (predictor>32767)
+		predictor=32767;
+	else if (predictor<-32768)
+		predictor=-32768;
+	index+=index_table[nibble];
+	if (index<0)
+		index=0;
+	else if (index>88)
+		index=88;
+	return nibble;
+}
+
+int
+AudioCodec::decodeSample(unsigned char nibble)
+{
+	int step=step_table[index];
+	int delta=step >> 3;
+	if (nibble & 4)
+		delta+=step;
+	if (nibble & 2)
+		delta+=step >> 1;
+	if (nibble & 1)
+		delta+=step >> 2;
+	predictor+=(nibble & 8) ? -delta : delta;
+	if (predictor>32767)
+		predictor=32767;
+	else if (predictor<-32768)
+		predictor=-32768;
+	index+=index_table[nibble];
+	if (index<0)
+		index=0;
+	else if (index>88)
+		index=88;
+	return predictor;
+}
+
+bool
+AudioCodec::init()
+{
+	for (int i=0;i<256;i++) {
+		unsigned char reversed=0; // CAPI delivers the bits in reversed order
+		for (int bit=0;bit<8;bit++)
+			if (i & (1 << bit))
+				reversed|=0x80 >> bit;
+		reverse_table[i]=reversed;
+	}
+	for (int i=0;i<256;i++) {
+		unsigned char a=reverse_table[i] ^ 0x55; // inversion of odd bits
+		int t=(a & 0x0f) << 4;
+		int seg=(a & 0x70) >> 4;
+		if (seg==0)
+			t+=8;
+		else
+			t=(t+0x108) << (seg-1);
+		la_table[i]=(a & 0x80) ? t : -t;
+	}
+	return true;
+}
@@ -0,0 +1,139 @@
+/** @file audiocodec.h
+    @brief Contains AudioCodec - A-Law and IMA ADPCM coding of audio data
+
+    @author agent <agent@local>
+*/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef AUDIOCODEC_H
+#define AUDIOCODEC_H
+
+#include <string>
+
+using namespace std;
+
+/** @brief A-Law and IMA ADPCM coding of audio data
+
+    CAPI transfers speech as bit-reversed A-Law, 8 kHz, mono, i.e. 8 bit per sample.
+    To save space, received audio can be saved in a compressed format instead, which
+    uses IMA ADPCM with 4 bit per sample. Such files start with a short header
+    (see isAdpcm()) followed by the ADPCM nibbles (first sample in the low nibble).
+    Predictor and step index start at 0.
+
+    The static methods convert single samples between bit-reversed A-Law and linear
+    16 bit values using lookup tables. An AudioCodec object holds the state of the
+    ADPCM coder, so data can be encoded or decoded in several pieces.
+
+    @author agent
+*/
+class AudioCodec
+{
+	public:
+		/** @brief Constructor. Create a coder with initial state
+		*/
+		AudioCodec();
+
+		/** @brief Encode bit-reversed A-Law data to ADPCM
+
+		    The header isn't included, see header().
+
+		    @param la the A-Law data
+		    @param length number of samples
+		    @return ADPCM data, contains length/2 bytes (a remaining sample is kept until the next call or flush())
+		*/
+		string encode(const unsigned char *la, unsigned long length);
+
+		/** @brief return the last incomplete byte of the encoded data
+
+		    @return the byte holding the last sample, empty if there's none
+		*/
+		string flush();
+
+		/** @brief Decode ADPCM data to bit-reversed A-Law
+
+		    The header must be stripped before.
+
+		    @param data the ADPCM data
+		    @param length length of the data in bytes
+		    @return A-Law data, contains 2*length samples
+		*/
+		string decode(const char *data, unsigned long length);
+
+		/** @brief Decode a whole ADPCM file
+
+		    @param data contents of the file including the header
+		    @return A-Law data
+		*/
+		static string decodeFile(const string &data);
+
+		/** @brief Tell if the given data is a compressed audio file
+
+		    @param data contents of the file (at least the beginning)
+		    @param length length of the data in bytes
+		    @return true if the data starts with the header of an ADPCM file
+		*/
+		static bool isAdpcm(const char *data, unsigned long length);
+
+		/** @brief Return the header for compressed files
+
+		    @return header which must be written at the beginning of each ADPCM file
+		*/
+		static string header();
+
+		/** @brief Convert a bit-reversed A-Law sample to a linear value
+
+		    @param la the A-Law sample
+		    @return signed 16 bit value
+		*/
+		static short la2linear(unsigned char la)
+		{
+			return la_table[la];
+		}
+
+		/** @brief Convert a linear value to a bit-reversed A-Law sample
+
+		    @param linear signed 16 bit value
+		    @return the A-Law sample
+		*/
+		static unsigned char linear2la(short linear);
+
+	private:
+		/** @brief encode one sample and update the coder state
+
+		    @param sample linear sample
+		    @return ADPCM nibble
+		*/
+		unsigned char encodeSample(int sample);
+
+		/** @brief decode one nibble and update the coder state
+
+		    @param nibble ADPCM nibble
+		    @return linear sample
+		*/
+		int decodeSample(unsigned char nibble);
+
+		/** @brief fill the lookup tables, called only once
+
+		    @return always true
+		*/
+		static bool init();
+
+		int predictor; ///< last predicted sample
+		int index; ///< current index into step_table
+		bool half; ///< true if pending holds an encoded sample in the low nibble
+		unsigned char pending; ///< incomplete byte of encoded data
+
+		static short la_table[256]; ///< linear value of each bit-reversed A-Law byte
+		static unsigned char reverse_table[256]; ///< byte with reversed bit order for each byte
+		static bool initialized; ///< true if the tables were filled
+};
+
+#endif
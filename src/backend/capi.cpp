@@ -39,10 +39,11 @@ void* capi_exec_handler(void* arg)
 	return NULL;
 }
 
-Capi::Capi (ostream& debug, unsigned short debug_level, ostream &error, unsigned short DDILength, unsigned short DDIBaseLength, vector<string> DDIStopNumbers, unsigned maxLogicalConnection, unsigned maxBDataBlocks,unsigned maxBDataLen) throw (CapiError, CapiMsgError)
+Capi::Capi (ostream& debug, unsigned short debug_level, ostream &error, unsigned short DDILength, unsigned short DDIBaseLength, const vector<string> &DDIStopNumbers, unsigned maxLogicalConnection, unsigned maxBDataBlocks,unsigned maxBDataLen) throw (CapiError, CapiMsgError)
 :debug(debug),debug_level(debug_level),error(error),messageNumber(0),usedInfoMask(0x10),usedCIPMask(0),
-DDILength(DDILength),DDIBaseLength(DDIBaseLength),DDIStopNumbers(DDIStopNumbers)
+ddi_plan(DDILength,DDIBaseLength,DDIStopNumbers)
 {
+	pthread_mutex_init(&active_connections_mutex,NULL);
 	if (debug_level >= 2)
 		debug << prefix() << "Capi object created" << endl;
 	Capi::readProfile(); // can throw CapiMsgError. Just propagate...
@@ -62,7 +63,7 @@ DDILength(DDILength),DDIBaseLength(DDIBaseLength),DDIStopNumbers(DDIStopNumbers)
 	if (applId == 0 || info!=0)
         	throw (CapiMsgError(info,"Error while registering application: "+describeParamInfo(info),"Capi::Capi()"));
 
-	if (DDILength)
+	if (ddi_plan.length())
 		usedInfoMask|=0x80; // enable Called Party Number Info Element for PtP configuration
 
 	for (int i=1;i<=Capi::numControllers;i++)
@@ -86,6 +87,8 @@ Capi::~Capi ()
 	if (info != 0)
 		throw (CapiMsgError(info,"Error while unregistering application: "+describeParamInfo(info),"Capi::~Capi()"));
 
+	pthread_mutex_destroy(&active_connections_mutex);
+
 	if (debug_level >= 2)
 		debug << prefix() << "Capi object deleted. Let's go to bed..." << endl;
 }
@@ -105,6 +108,96 @@ Capi::unregisterConnection(_cdword plci)
 	connections.erase(plci);
 }
 
+void
+Capi::connectionCreated(_cdword controller)
+{
+	pthread_mutex_lock(&active_connections_mutex);
+	active_connections[controller]++;
+	pthread_mutex_unlock(&active_connections_mutex);
+}
+
+void
+Capi::connectionDeleted(_cdword controller)
+{
+	pthread_mutex_lock(&active_connections_mutex);
+	if (active_connections[controller])
+		active_connections[controller]--;
+	pthread_mutex_unlock(&active_connections_mutex);
+}
+
+unsigned
+Capi::getActiveConnections(_cdword controller)
+{
+	pthread_mutex_lock(&active_connections_mutex);
+	unsigned count=active_connections[controller];
+	pthread_mutex_unlock(&active_connections_mutex);
+	return count;
+}
+
+unsigned
+Capi::getBChannels(_cdword controller)
+{
+	if (controller<1 || controller>static_cast<_cdword>(numControllers))
+		return 0;
+	return profiles[controller-1].bChannels;
+}
+
+_cdword
+Capi::selectController(int service, const vector<_cdword> &allowed, const map<_cdword,unsigned> &pending)
+{
+	vector<_cdword> candidates(allowed);
+	if (candidates.empty())
+		for (int i=1;i<=Capi::numControllers;i++)
+			candidates.push_back(i);
+
+	time_t now=time(NULL);
+	_cdword best=0;
+	unsigned best_used=0,best_channels=1;
+	pthread_mutex_lock(&active_connections_mutex);
+	for (vector<_cdword>::iterator it=candidates.begin();it!=candidates.end();it++) {
+		unsigned channels=getBChannels(*it);
+		if (!channels)
+			continue;
+		const CardProfileT &profile=profiles[*it-1];
+		if ((service==Connection::VOICE && !profile.transp) || (service==Connection::FAXG3 && !profile.fax && !profile.faxExt))
+			continue;
+		if (controller_status[*it].blocked_until>now)
+			continue;
+		unsigned used=active_connections[*it];
+		map<_cdword,unsigned>::const_iterator p=pending.find(*it);
+		if (p!=pending.end()) // calls which haven't created their connection yet
+			used+=p->second;
+		if (used>=channels)
+			continue;
+		if (!best || used*best_channels<best_used*channels) { // compare used/channels w/o rounding
+			best=*it;
+			best_used=used;
+			best_channels=channels;
+		}
+	}
+	pthread_mutex_unlock(&active_connections_mutex);
+	return best;
+}
+
+void
+Capi::callPlaced(_cdword controller, bool failed)
+{
+	pthread_mutex_lock(&active_connections_mutex);
+	ControllerStatusT &status=controller_status[controller];
+	bool blocked=false;
+	if (!failed)
+		status.failures=0;
+	else if (++status.failures>=max_failures) {
+		status.blocked_until=time(NULL)+failure_delay;
+		blocked=true;
+	}
+	unsigned failures=status.failures;
+	pthread_mutex_unlock(&active_connections_mutex);
+
+	if (blocked && debug_level >= 1)
+		debug << prefix() << "controller " << controller << " failed " << failures << " calls in a row, skipping it for " << failure_delay << " seconds" << endl;
+}
+
 void
 Capi::listen_req(_cdword Controller, _cdword InfoMask, _cdword CIPMask) throw (CapiMsgError)
 {
@@ -598,9 +691,9 @@ Capi::readMessage (void) throw (CapiMsgError, CapiError, CapiWrongState, CapiExt
 							if (connections.count(plci)>0)
 								throw(CapiError("PLCI used twice from CAPI in CONNECT_IND","Capi::readMessage()"));
 							else {
-								Connection *c=new Connection(nachricht,this,DDILength,DDIBaseLength,DDIStopNumbers);
+								Connection *c=new Connection(nachricht,this,&ddi_plan);
 								connections[plci]=c;
-								if (!DDILength) // if we have PtP then wait until DDI is complete
+								if (!ddi_plan.length()) // if we have PtP then wait until DDI is complete
 									application->callWaiting(c);
 							}
 						} break;
@@ -708,7 +801,7 @@ Capi::readMessage (void) throw (CapiMsgError, CapiError, CapiWrongState, CapiExt
 										throw(CapiError("PLCI unknown in INFO_IND","Capi::readMessage()"));
 									else {
 										nrComplete=connections[plci]->info_ind_called_party_nr(nachricht);
-										if (nrComplete && DDILength)
+										if (nrComplete && ddi_plan.length())
 											application->callWaiting(connections[plci]);
 									}
 								} break;
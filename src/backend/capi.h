@@ -18,10 +18,13 @@
 #define CAPI_H
 
 #include <capi20.h>
+#include <pthread.h>
+#include <time.h>
 #include <string>
 #include <map>  
 #include <vector>
 #include "capiexception.h"
+#include "ddiplan.h"
 
 class Connection;
 class ApplicationInterface;
@@ -86,7 +89,7 @@ class Capi {
 		*/
 		Capi (ostream &debug, unsigned short debug_level, ostream &error, 
 		  unsigned short DDILength=0, unsigned short DDIBaseLength=0, 
-		  vector<string> DDIStopNumbers=vector<string>(), 
+		  const vector<string> &DDIStopNumbers=vector<string>(), 
 		  unsigned maxLogicalConnection=0, unsigned maxBDataBlocks=7,
 		  unsigned maxBDataLen=2048) throw (CapiError, CapiMsgError);
 
@@ -153,7 +156,60 @@ class Capi {
 		*/
 	  	string getInfo(bool verbose=false);
 
+		/** @brief Return the number of B channels of a controller
+
+		    @param controller number of the controller (starting with 1)
+		    @return number of B channels as reported by the controller profile, 0 for invalid controllers
+		*/
+		unsigned getBChannels(_cdword controller);
+
+		/** @brief Return the number of connections currently using a controller
+
+		    Each Connection object is counted from its creation until it's deleted, so
+		    this gives an upper bound for the number of B channels in use.
+
+		    @param controller number of the controller (starting with 1)
+		    @return number of existing Connection objects for this controller
+		*/
+		unsigned getActiveConnections(_cdword controller);
+
+		/** @brief Choose the controller for an outgoing call
+
+		    Out of the allowed controllers supporting the service, the one with the lowest
+		    share of busy B channels is taken. Controllers which couldn't place max_failures
+		    calls in a row (see callPlaced()) are skipped for failure_delay seconds.
+
+		    @param service service of the call as described in Connection::service_t
+		    @param allowed controllers to choose from, all installed controllers if empty
+		    @param pending number of calls started on each controller which haven't created their Connection yet
+		    @return number of the controller (starting with 1), 0 if none of them has a free B channel
+		*/
+		_cdword selectController(int service, const vector<_cdword> &allowed, const map<_cdword,unsigned> &pending=map<_cdword,unsigned>());
+
+		/** @brief Report the result of an outgoing call to selectController()
+
+		    @param controller number of the controller the call was placed on
+		    @param failed true if the call didn't reach the network, false otherwise
+		*/
+		void callPlaced(_cdword controller, bool failed);
+
 	private:
+		/** @brief count a new Connection object for a controller
+
+		    This method is used by the constructors of Connection.
+
+		    @param controller number of the controller used by the connection
+		*/
+		void connectionCreated(_cdword controller);
+
+		/** @brief stop counting a Connection object for a controller
+
+		    This method is used by Connection::~Connection()
+
+		    @param controller number of the controller used by the connection
+		*/
+		void connectionDeleted(_cdword controller);
+
 
 		/** @brief erase Connection object in connections map
 
@@ -427,19 +483,38 @@ class Capi {
 			bool suppServ; ///< does this controller support Supplementary Services?
 		};
 
+		/** @brief type for storing the recent failures of a controller
+		*/
+		class ControllerStatusT
+		{
+			public:
+			/** @brief default constructor
+			*/
+			ControllerStatusT()
+			:failures(0),blocked_until(0)
+			{}
+
+			unsigned failures; ///< number of outgoing calls which failed in a row
+			time_t blocked_until; ///< selectController() doesn't choose the controller before this time
+		};
+
+		static const unsigned max_failures=3; ///< number of failed calls in a row after which a controller is skipped
+		static const unsigned failure_delay=300; ///< seconds a failing controller is skipped before it's tried again
+
 		static short numControllers;  ///< number of installed controllers, set by readProfile() method
                 static string capiManufacturer, ///< manufacturer of the general CAPI driver
 		       capiVersion; ///< version of the general CAPI driver
 
-		unsigned short DDILength; ///< length of extension number (DDI) when ISDN PtP mode is used (0=PtMP)
-		unsigned short DDIBaseLength; ///< base number length for the ISDN interface if PtP mode is used
-		vector<string> DDIStopNumbers; ///< list of DDIs shorten than DDILength we'll accept
+		DDIPlan ddi_plan; ///< numbering plan for the DDI when ISDN PtP mode is used, shared by all incoming connections
 		
 		static vector <CardProfileT> profiles; ///< vector containing profiles for all found cards (ATTENTION: starts with index 0,
 						///< while CAPI numbers controllers starting by 1 (sigh)
 
 		map <_cdword,Connection*> connections; ///< containing pointers to the currently active Connection
 							///< objects, referenced by PLCI (or 0xFACE & messageNum when Connection is in plci_state Connection::P01
+		map <_cdword,unsigned> active_connections; ///< number of existing Connection objects, referenced by controller
+		pthread_mutex_t active_connections_mutex; ///< to realize critical sections when accessing active_connections and controller_status
+		map <_cdword,ControllerStatusT> controller_status; ///< recent failures of outgoing calls, referenced by controller
 
 		_cword messageNumber;  ///< sequencial message number, must be increased for every sent message
 		_cdword usedInfoMask;  ///< InfoMask currently used (in last listen_req)
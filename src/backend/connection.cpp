@@ -27,22 +27,30 @@
 #include "connection.h"
 
 #define conf_send_buffers 4
+#define conf_abortable_send_buffers 2 // window for blocks smaller than 2048 bytes, see start_file_transmission()
+#define conf_stream_buffer (conf_send_buffers*2048)
+#define conf_bridge_jitter 320 // 40 msec
+#define conf_bridge_buffer 2048
 
 using namespace std;
 
-Connection::Connection (_cmsg& message, Capi *capi, unsigned short DDILength, unsigned short DDIBaseLength, std::vector<std::string> DDIStopNumbers):
+pthread_mutex_t Connection::bridge_mutex=PTHREAD_MUTEX_INITIALIZER;
+
+Connection::Connection (_cmsg& message, Capi *capi, const DDIPlan *plan):
 	call_if(NULL),capi(capi),plci_state(P2),ncci_state(N0), buffer_start(0), buffers_used(0),
-	file_for_reception(NULL), file_to_send(NULL), received_dtmf(""), keepPhysicalConnection(false),
+	file_for_reception(NULL), reception_codec(NULL), fax_index(NULL), file_to_send(NULL), prompt_to_send(NULL), prompt_pos(0), send_block_size(2048), send_window(conf_send_buffers),
+	stream_to_send(false), stream_closed(false), stream_for_reception(false),
+	bridge_peer(NULL), stream_bridged(false), bridge_prebuffering(false), received_dtmf(""), keepPhysicalConnection(false),
 	disconnect_cause(0),debug(capi->debug), debug_level(capi->debug_level), error(capi->error),
-	our_call(false), disconnect_cause_b3(0), fax_info(NULL), DDILength(DDILength), 
-	DDIBaseLength(DDIBaseLength), DDIStopNumbers(DDIStopNumbers) 
+	our_call(false), disconnect_cause_b3(0), fax_info(NULL),
+	ddi_plan(plan && plan->length() ? plan : NULL), ddi_state(plan ? plan->start() : 0)
 {
 	pthread_mutex_init(&send_mutex, NULL);
 	pthread_mutex_init(&receive_mutex, NULL);
 
 	plci=CONNECT_IND_PLCI(&message); // Physical Link Connection Identifier
 	call_from = getNumber(CONNECT_IND_CALLINGPARTYNUMBER(&message),true);
-	if (DDILength)
+	if (ddi_plan)
 		call_to=""; // we enable the CalledParty InfoElement when using DDI and will get the number later again
 	else
 		call_to=getNumber(CONNECT_IND_CALLEDPARTYNUMBER(&message),false);
@@ -65,14 +73,18 @@ Connection::Connection (_cmsg& message, Capi *capi, unsigned short DDILength, un
 		break;
 	}
 	connect_ind_msg_nr=message.Messagenumber; // this is needed as connect_resp is given later
+
+	controller=plci & 0x7f; // the lowest 7 bits of the PLCI contain the controller number
+	capi->connectionCreated(controller);
 }
 
 Connection::Connection (Capi* capi, _cdword controller, string call_from, bool clir, string call_to, service_t service, string faxStationID, string faxHeadline)  throw (CapiExternalError, CapiMsgError)
-	:call_if(NULL),capi(capi),plci_state(P01),ncci_state(N0),plci(0),service(service),  
-	buffer_start(0), buffers_used(0), file_for_reception(NULL), file_to_send(NULL), 
-	call_from(call_from), call_to(call_to), connect_ind_msg_nr(0), disconnect_cause(0), 
+	:call_if(NULL),capi(capi),plci_state(P01),ncci_state(N0),plci(0),controller(controller),service(service),  
+	buffer_start(0), buffers_used(0), file_for_reception(NULL), reception_codec(NULL), fax_index(NULL), file_to_send(NULL), prompt_to_send(NULL), prompt_pos(0),
+	send_block_size(2048), send_window(conf_send_buffers), stream_to_send(false), stream_closed(false), stream_for_reception(false),
+	bridge_peer(NULL), stream_bridged(false), bridge_prebuffering(false), call_from(call_from), call_to(call_to), connect_ind_msg_nr(0), disconnect_cause(0), 
 	debug(capi->debug), debug_level(capi->debug_level), error(capi->error), keepPhysicalConnection(false),
-	our_call(true), disconnect_cause_b3(0), fax_info(NULL), DDILength(0), DDIBaseLength(0) 
+	our_call(true), disconnect_cause_b3(0), fax_info(NULL), ddi_plan(NULL), ddi_state(0)
 {
 	pthread_mutex_init(&send_mutex, NULL);
 	pthread_mutex_init(&receive_mutex, NULL);
@@ -147,12 +159,16 @@ Connection::Connection (Capi* capi, _cdword controller, string call_from, bool c
 		delete[] calledPartyNumber;
 	if (callingPartyNumber)
 		delete[] callingPartyNumber;
+
+	capi->connectionCreated(controller);
 }
 
 Connection::~Connection()
 {
+	unbridge();
 	stop_file_transmission();
 	stop_file_reception();
+	stop_stream_reception();
 
 	if (getState()!=DOWN) {
 		error << prefix() << "WARNING: please disconnect yourself before deleting connection object!!" << endl;
@@ -173,6 +189,11 @@ Connection::~Connection()
 	if (fax_info)
 		delete fax_info;
 
+	if (fax_index)
+		delete fax_index;
+
+	capi->connectionDeleted(controller);
+
 	if (debug_level >= 1) {
 		debug << prefix() << "Connection object deleted" <<  endl;
 	}
@@ -336,6 +357,12 @@ Connection::getFaxInfo()
 	return fax_info;
 }
 
+SffIndex*
+Connection::getFaxIndex()
+{
+	return fax_index;
+}
+
 Connection::connection_state_t
 Connection::getState()
 {
@@ -474,8 +501,18 @@ Connection::disconnect_b3_ind(_cmsg& message) throw (CapiError,CapiWrongState)
 		buffers_used=0; // we'll get no DATA_B3_CONF's after DISCONNECT_B3_IND, see Capi 2.0 spec, 5.18, note for DATA_B3_CONF
 		pthread_mutex_unlock(&send_mutex);
 
+		pthread_mutex_lock(&receive_mutex);
+		stream_pending_resps.clear(); // no DATA_B3_RESP allowed after DISCONNECT_B3_IND
+		pthread_mutex_unlock(&receive_mutex);
+
+		pthread_mutex_lock(&bridge_mutex);
+		bridge_pending_resps.clear();
+		pthread_mutex_unlock(&bridge_mutex);
+		unbridge();
+
 		stop_file_transmission();
 		stop_file_reception();
+		stop_stream_reception();
 
 		bool our_disconnect_req= (ncci_state==N4) ? true : false;
 
@@ -535,17 +572,38 @@ Connection::data_b3_ind(_cmsg& message) throw (CapiError,CapiWrongState,CapiMsgE
 	if (ncci!=CONNECT_B3_IND_NCCI(&message))
 		throw CapiError("DATA_B3_IND received with wrong NCCI","Connection::data_b3_ind()");
 
+	bool hold_resp=false;
 	pthread_mutex_lock(&receive_mutex);
-	if (file_for_reception)	{
+	if (file_for_reception && reception_codec) {
+		string compressed=reception_codec->encode(DATA_B3_IND_DATA(&message),DATA_B3_IND_DATALENGTH(&message));
+		file_for_reception->write(compressed.data(),compressed.size());
+	} else if (file_for_reception)	{
 		for (int i=0;i<DATA_B3_IND_DATALENGTH(&message);i++)
 			(*file_for_reception) << DATA_B3_IND_DATA(&message)[i];
+		if (fax_index)
+			fax_index->feed(DATA_B3_IND_DATA(&message),DATA_B3_IND_DATALENGTH(&message));
+	}
+	if (stream_for_reception) {
+		stream_received_data.append(reinterpret_cast<char*>(DATA_B3_IND_DATA(&message)),DATA_B3_IND_DATALENGTH(&message));
+		if (stream_received_data.size()>conf_stream_buffer) { // consumer is too slow, confirm when it has read the data
+			stream_pending_resps.push_back(pair<_cword,_cword>(message.Messagenumber,DATA_B3_IND_DATAHANDLE(&message)));
+			hold_resp=true;
+		}
 	}
 	pthread_mutex_unlock(&receive_mutex);
 
+	pthread_mutex_lock(&bridge_mutex);
+	if (bridge_peer && bridge_peer->bridge_data(DATA_B3_IND_DATA(&message),DATA_B3_IND_DATALENGTH(&message)) && !hold_resp) {
+		bridge_pending_resps.push_back(pair<_cword,_cword>(message.Messagenumber,DATA_B3_IND_DATAHANDLE(&message)));
+		hold_resp=true;
+	}
+	pthread_mutex_unlock(&bridge_mutex);
+
 	if (call_if)
 		call_if->dataIn(DATA_B3_IND_DATA(&message),DATA_B3_IND_DATALENGTH(&message));
 
-	capi->data_b3_resp(message.Messagenumber,ncci,DATA_B3_IND_DATAHANDLE(&message));
+	if (!hold_resp)
+		capi->data_b3_resp(message.Messagenumber,ncci,DATA_B3_IND_DATAHANDLE(&message));
 }
 
 void
@@ -612,24 +670,28 @@ Connection::info_ind_called_party_nr(_cmsg &message) throw (CapiError,CapiWrongS
 		  e << endl;
 	}
 
-	call_to+=getNumber(INFO_IND_INFOELEMENT(&message),false);
-
-	string currDDI;
-	try {
-		currDDI=call_to.substr(DDIBaseLength);
+	if (!ddi_plan) { // PtMP, the number was already complete in CONNECT_IND
+		call_to+=getNumber(INFO_IND_INFOELEMENT(&message),false);
+		return true;
 	}
-	catch (std::out_of_range e) {
+
+	// follow the new digits of the DDI in the numbering plan
+	string digits=getNumber(INFO_IND_INFOELEMENT(&message),false);
+	for (unsigned i=0;i<digits.length();i++)
+		if (call_to.length()+i>=ddi_plan->baseLength())
+			ddi_state=ddi_plan->next(ddi_state,digits[i]);
+	call_to+=digits;
+
+	if (call_to.length()<ddi_plan->baseLength())
 		throw CapiError("DDIBaseLength too big - configuration error?",
 		  "Connection::info_ind_called_party_nr()");
+	if (ddi_plan->isStop(ddi_state)) {
+		if (debug_level >= 1)
+			debug << prefix() << "got DDI, nr is now " << call_to << " (complete,stop_nr)" << endl;
+		return true;
 	}
-	for (int i=0;i<DDIStopNumbers.size();i++)
-	    if (DDIStopNumbers[i]==currDDI) {
-			if (debug_level >= 1)
-	    			debug << prefix() << "got DDI, nr is now " << call_to << " (complete,stop_nr)" << endl;
-			return true;
-	    }
 
-	if (call_to.length()>=DDIBaseLength+DDILength) {
+	if (call_to.length()>=ddi_plan->baseLength()+ddi_plan->length()) {
 		if (debug_level >=1)
                 	debug << prefix() << "got DDI, nr is now " << call_to << " (complete)" << endl;
 		return true;
@@ -725,20 +787,29 @@ Connection::data_b3_conf(_cmsg& message) throw (CapiError,CapiWrongState,CapiMsg
 
 	pthread_mutex_lock(&send_mutex);
 
+	bool bridge_drained;
 	try {
 		if ( (!buffers_used) || (DATA_B3_CONF_DATAHANDLE(&message)!=buffer_start) )
 			throw CapiError("DATA_B3_CONF received with invalid data handle","Connection::data_b3_conf()");
 		// free one buffer
 		buffers_used--;
 		buffer_start=(buffer_start+1)%7;
-		while (file_to_send && (buffers_used < conf_send_buffers) )
+		while (data_to_send() && (buffers_used < send_window) )
 			send_block();
+		bridge_drained=(stream_bridged && stream_send_data.size()<=conf_bridge_buffer);
 	}
 	catch (...) {
 		pthread_mutex_unlock(&send_mutex);
 		throw;
 	}
 	pthread_mutex_unlock(&send_mutex);
+
+	if (bridge_drained) { // the peer may continue to receive now
+		pthread_mutex_lock(&bridge_mutex);
+		if (bridge_peer)
+			bridge_peer->release_bridge_resps();
+		pthread_mutex_unlock(&bridge_mutex);
+	}
 }
 
 void
@@ -808,7 +879,7 @@ Connection::send_block() throw (CapiError,CapiWrongState,CapiExternalError,CapiM
 	if (ncci_state!=NACT)
 		throw CapiWrongState("unable to send file because connection is not established","Connection::send_block()");
 
-	if (!file_to_send)
+	if (!file_to_send && !prompt_to_send && !stream_to_send)
 		throw CapiError("unable to play file because no input file is open","Connection::send_block()");
 
 	if (buffers_used>=7)
@@ -819,11 +890,39 @@ Connection::send_block() throw (CapiError,CapiWrongState,CapiExternalError,CapiM
 	unsigned short buff_num=(buffer_start+buffers_used)%7; // buffer to store the next item
 
 	int i=0;
-	while (i<2048 && !file_completed) {
-		if (!file_to_send->get(send_buffer[buff_num][i]))
-			file_completed=true;
-		else
-	   		i++;
+	if (prompt_to_send) { // cached file(s), just copy the next snippet
+		while (i<send_block_size && prompt_to_send) {
+			unsigned long len=prompt_to_send->size-prompt_pos;
+			if (len>send_block_size-i)
+				len=send_block_size-i;
+			memcpy(send_buffer[buff_num]+i,prompt_to_send->data+prompt_pos,len);
+			i+=len;
+			prompt_pos+=len;
+			if (prompt_pos>=prompt_to_send->size) { // continue with the next file w/o gap
+				PromptCache::release(prompt_to_send);
+				prompt_to_send=NULL;
+				prompt_pos=0;
+				if (!prompts_queued.empty()) {
+					prompt_to_send=prompts_queued.front();
+					prompts_queued.pop_front();
+				}
+			}
+		}
+		file_completed=!prompt_to_send;
+	} else if (stream_to_send) {
+		i=stream_send_data.size();
+		if (i>send_block_size)
+			i=send_block_size;
+		memcpy(send_buffer[buff_num],stream_send_data.data(),i);
+		stream_send_data.erase(0,i);
+		file_completed=(stream_closed && stream_send_data.empty());
+	} else {
+		while (i<2048 && !file_completed) {
+			if (!file_to_send->get(send_buffer[buff_num][i]))
+				file_completed=true;
+			else
+		   		i++;
+		}
 	}
 
 	try {
@@ -834,17 +933,10 @@ Connection::send_block() throw (CapiError,CapiWrongState,CapiExternalError,CapiM
 	}
 	catch (CapiMsgError e) {
 		error << prefix() << "WARNING: Can't send data_b3_req. Message was: " << e << endl;
-		if (file_completed) {
-			file_to_send->close();
-			delete file_to_send;
-			file_to_send=NULL;
-		}
 	}
 
   	if (file_completed) {
-    		file_to_send->close();
-		delete file_to_send;
-	 	file_to_send=NULL;
+		close_send_source();
 	 	if (call_if)
 	 		call_if->transmissionComplete();
 		else
@@ -852,6 +944,45 @@ Connection::send_block() throw (CapiError,CapiWrongState,CapiExternalError,CapiM
   	}
 }
 
+bool
+Connection::data_to_send()
+{
+	if (stream_bridged) { // jitter buffer: collect some data before (re)starting to send
+		if (!buffers_used && stream_send_data.empty())
+			bridge_prebuffering=true;
+		else if (bridge_prebuffering && stream_send_data.size()>=conf_bridge_jitter)
+			bridge_prebuffering=false;
+		return (!bridge_prebuffering && !stream_send_data.empty());
+	}
+	if (stream_to_send) // don't send small snippets of a stream as long as other blocks are on their way
+		return (stream_closed || stream_send_data.size()>=send_block_size || (!buffers_used && !stream_send_data.empty()));
+	return (file_to_send || prompt_to_send);
+}
+
+void
+Connection::close_send_source()
+{
+	if (file_to_send) {
+		file_to_send->close();
+		delete file_to_send;
+		file_to_send=NULL;
+	}
+	if (prompt_to_send) {
+		PromptCache::release(prompt_to_send);
+		prompt_to_send=NULL;
+	}
+	while (!prompts_queued.empty()) {
+		PromptCache::release(prompts_queued.front());
+		prompts_queued.pop_front();
+	}
+	send_block_size=2048;
+	send_window=conf_send_buffers;
+	stream_to_send=false;
+	stream_bridged=false;
+	stream_closed=false;
+	stream_send_data.erase();
+}
+
 void
 Connection::start_file_transmission(string filename) throw (CapiError,CapiWrongState,CapiExternalError,CapiMsgError)
 {
@@ -861,27 +992,88 @@ Connection::start_file_transmission(string filename) throw (CapiError,CapiWrongS
 	if (ncci_state!=NACT)
 		throw CapiWrongState("unable to send file because connection is not established","Connection::start_file_transmission()");
 
-	if (file_to_send)
+	if (file_to_send || prompt_to_send || stream_to_send)
 		throw CapiExternalError("unable to send file because transmission is already in progress","Connection::start_file_transmission()");
 
+	if (service==VOICE) {
+		start_file_transmission(vector<string>(1,filename));
+		return;
+	}
+
 	file_to_send=new ifstream(filename.c_str());
 
 	if (! (*file_to_send)) { // we can't open the file
 		delete file_to_send;
 		file_to_send=NULL;
 		throw CapiExternalError("unable to open file to send ("+filename+")","Connection::start_file_transmission()");
-	} else {
-		pthread_mutex_lock(&send_mutex);
-		try {
-			while (file_to_send && buffers_used<conf_send_buffers)
-				send_block();
-		}
-		catch (...) {
-			pthread_mutex_unlock(&send_mutex);
-			throw;
+	}
+
+	pthread_mutex_lock(&send_mutex);
+	try {
+		while ((file_to_send || prompt_to_send) && buffers_used<send_window)
+			send_block();
+	}
+	catch (...) {
+		pthread_mutex_unlock(&send_mutex);
+		throw;
+	}
+	pthread_mutex_unlock(&send_mutex);
+}
+
+void
+Connection::start_file_transmission(vector<string> filenames, unsigned short block_size, bool cache) throw (CapiError,CapiWrongState,CapiExternalError,CapiMsgError)
+{
+	if (debug_level >= 2) {
+		debug << prefix() << "start_file_transmission of " << filenames.size() << " file(s)" << endl;
+	}
+	if (ncci_state!=NACT)
+		throw CapiWrongState("unable to send file because connection is not established","Connection::start_file_transmission()");
+
+	if (file_to_send || prompt_to_send || stream_to_send)
+		throw CapiExternalError("unable to send file because transmission is already in progress","Connection::start_file_transmission()");
+
+	if (service!=VOICE)
+		throw CapiExternalError("sending several files is only supported in speech mode","Connection::start_file_transmission()");
+
+	if (!block_size || block_size>2048)
+		throw CapiExternalError("invalid block size given","Connection::start_file_transmission()");
+
+	if (filenames.empty()) {
+		if (call_if)
+			call_if->transmissionComplete();
+		return;
+	}
+
+	// get all files before we start, so we won't stop in the middle because of a missing one
+	list<PromptCache::Prompt*> prompts;
+	try {
+		for (int i=0;i<filenames.size();i++)
+			prompts.push_back(PromptCache::acquire(filenames[i],cache));
+	}
+	catch (CapiExternalError) {
+		while (!prompts.empty()) {
+			PromptCache::release(prompts.front());
+			prompts.pop_front();
 		}
+		throw;
+	}
+
+	pthread_mutex_lock(&send_mutex);
+	prompt_pos=0;
+	send_block_size=block_size;
+	send_window=(block_size<2048 ? conf_abortable_send_buffers : conf_send_buffers);
+	prompt_to_send=prompts.front();
+	prompts.pop_front();
+	prompts_queued=prompts;
+	try {
+		while (prompt_to_send && buffers_used<send_window)
+			send_block();
+	}
+	catch (...) {
 		pthread_mutex_unlock(&send_mutex);
+		throw;
 	}
+	pthread_mutex_unlock(&send_mutex);
 }
 
 void
@@ -891,11 +1083,7 @@ Connection::stop_file_transmission()
 		debug << prefix() << "stop_file_transmission initiated" << endl;
 	}
 	pthread_mutex_lock(&send_mutex);
-	if (file_to_send) {
-		file_to_send->close();
-		delete file_to_send;
-		file_to_send=NULL;
-	}
+	close_send_source();
 	pthread_mutex_unlock(&send_mutex);
 
 	timespec delay_time;
@@ -908,7 +1096,18 @@ Connection::stop_file_transmission()
 }
 
 void
-Connection::start_file_reception(string filename) throw (CapiWrongState, CapiExternalError)
+Connection::abort_file_transmission()
+{
+	if (debug_level >= 2) {
+		debug << prefix() << "abort_file_transmission" << endl;
+	}
+	pthread_mutex_lock(&send_mutex);
+	close_send_source();
+	pthread_mutex_unlock(&send_mutex);
+}
+
+void
+Connection::start_file_reception(string filename, bool compress) throw (CapiWrongState, CapiExternalError)
 {
 	if (debug_level >= 2) {
 		debug << prefix() << "start_file_reception " << filename << endl;
@@ -919,12 +1118,27 @@ Connection::start_file_reception(string filename) throw (CapiWrongState, CapiExt
 	if (file_for_reception)
 		throw CapiExternalError("file reception is already active","Connection::start_file_reception()");
 
+	if (compress && service!=VOICE)
+		throw CapiExternalError("compression is only supported in speech mode","Connection::start_file_reception()");
+
+	pthread_mutex_lock(&receive_mutex);
   	file_for_reception=new ofstream(filename.c_str());
   	if (! (*file_for_reception)) { // we can't open the file
   		delete file_for_reception;
 		file_for_reception=NULL;
+		pthread_mutex_unlock(&receive_mutex);
 		throw CapiExternalError("unable to open file for reception ("+filename+")","Connection::start_file_reception()");
   	}
+	if (compress) {
+		reception_codec=new AudioCodec();
+		(*file_for_reception) << AudioCodec::header();
+	}
+	if (service==FAXG3) { // index the pages while they're received
+		if (fax_index)
+			delete fax_index;
+		fax_index=new SffIndex();
+	}
+	pthread_mutex_unlock(&receive_mutex);
 }
 
 void
@@ -933,6 +1147,11 @@ Connection::stop_file_reception()
 	pthread_mutex_lock(&receive_mutex);
 
 	if (file_for_reception) {
+		if (reception_codec) {
+			(*file_for_reception) << reception_codec->flush();
+			delete reception_codec;
+			reception_codec=NULL;
+		}
   		file_for_reception->close();
 		delete file_for_reception;
 		file_for_reception=NULL;
@@ -944,6 +1163,252 @@ Connection::stop_file_reception()
 	}
 }
 
+void
+Connection::start_stream_transmission() throw (CapiWrongState, CapiExternalError)
+{
+	if (debug_level >= 2) {
+		debug << prefix() << "start_stream_transmission" << endl;
+	}
+	if (ncci_state!=NACT)
+		throw CapiWrongState("unable to send stream because connection is not established","Connection::start_stream_transmission()");
+
+	pthread_mutex_lock(&send_mutex);
+	if (file_to_send || prompt_to_send || stream_to_send) {
+		pthread_mutex_unlock(&send_mutex);
+		throw CapiExternalError("unable to send stream because transmission is already in progress","Connection::start_stream_transmission()");
+	}
+	stream_to_send=true;
+	stream_closed=false;
+	stream_send_data.erase();
+	pthread_mutex_unlock(&send_mutex);
+}
+
+unsigned long
+Connection::stream_write(const char* data, unsigned long length) throw (CapiError,CapiWrongState,CapiExternalError,CapiMsgError)
+{
+	if (ncci_state!=NACT)
+		throw CapiWrongState("unable to send stream because connection is not established","Connection::stream_write()");
+
+	pthread_mutex_lock(&send_mutex);
+	unsigned long accepted=0;
+	try {
+		if (!stream_to_send || stream_closed || stream_bridged)
+			throw CapiExternalError("no stream transmission active","Connection::stream_write()");
+
+		if (stream_send_data.size()<conf_stream_buffer) {
+			accepted=conf_stream_buffer-stream_send_data.size();
+			if (accepted>length)
+				accepted=length;
+			stream_send_data.append(data,accepted);
+		}
+		while (data_to_send() && buffers_used<send_window)
+			send_block();
+	}
+	catch (...) {
+		pthread_mutex_unlock(&send_mutex);
+		throw;
+	}
+	pthread_mutex_unlock(&send_mutex);
+	return accepted;
+}
+
+void
+Connection::stream_close() throw (CapiError,CapiWrongState,CapiExternalError,CapiMsgError)
+{
+	if (debug_level >= 2) {
+		debug << prefix() << "stream_close" << endl;
+	}
+	pthread_mutex_lock(&send_mutex);
+	try {
+		if (!stream_to_send || stream_bridged)
+			throw CapiExternalError("no stream transmission active","Connection::stream_close()");
+
+		stream_closed=true;
+		if (ncci_state==NACT)
+			while (data_to_send() && buffers_used<send_window)
+				send_block();
+	}
+	catch (...) {
+		pthread_mutex_unlock(&send_mutex);
+		throw;
+	}
+	pthread_mutex_unlock(&send_mutex);
+}
+
+void
+Connection::start_stream_reception() throw (CapiWrongState, CapiExternalError)
+{
+	if (debug_level >= 2) {
+		debug << prefix() << "start_stream_reception" << endl;
+	}
+	if (ncci_state!=NACT)
+		throw CapiWrongState("unable to receive stream because connection is not established","Connection::start_stream_reception()");
+
+	pthread_mutex_lock(&receive_mutex);
+	if (stream_for_reception) {
+		pthread_mutex_unlock(&receive_mutex);
+		throw CapiExternalError("stream reception is already active","Connection::start_stream_reception()");
+	}
+	stream_for_reception=true;
+	stream_received_data.erase();
+	pthread_mutex_unlock(&receive_mutex);
+}
+
+unsigned long
+Connection::stream_read(char* data, unsigned long maxlength) throw (CapiExternalError)
+{
+	list<pair<_cword,_cword> > resps;
+
+	pthread_mutex_lock(&receive_mutex);
+	if (!stream_for_reception) {
+		pthread_mutex_unlock(&receive_mutex);
+		throw CapiExternalError("no stream reception active","Connection::stream_read()");
+	}
+	unsigned long length=stream_received_data.size();
+	if (length>maxlength)
+		length=maxlength;
+	memcpy(data,stream_received_data.data(),length);
+	stream_received_data.erase(0,length);
+	if (stream_received_data.size()<=conf_stream_buffer)
+		resps.swap(stream_pending_resps);
+	pthread_mutex_unlock(&receive_mutex);
+
+	send_pending_resps(resps);
+	return length;
+}
+
+void
+Connection::stop_stream_reception()
+{
+	list<pair<_cword,_cword> > resps;
+
+	pthread_mutex_lock(&receive_mutex);
+	stream_for_reception=false;
+	stream_received_data.erase();
+	resps.swap(stream_pending_resps);
+	pthread_mutex_unlock(&receive_mutex);
+
+	send_pending_resps(resps);
+}
+
+void
+Connection::send_pending_resps(list<pair<_cword,_cword> > resps)
+{
+	for (list<pair<_cword,_cword> >::iterator i=resps.begin();i!=resps.end();i++) {
+		try {
+			capi->data_b3_resp(i->first,ncci,i->second);
+		}
+		catch (CapiMsgError e) {
+			error << prefix() << "WARNING: Can't send data_b3_resp. Message was: " << e << endl;
+		}
+	}
+}
+
+void
+Connection::bridge(Connection *peer) throw (CapiWrongState, CapiExternalError)
+{
+	if (debug_level >= 2) {
+		debug << prefix() << "bridge with " << peer->prefix() << endl;
+	}
+	if (peer==this)
+		throw CapiExternalError("can't bridge a connection with itself","Connection::bridge()");
+
+	if (ncci_state!=NACT || peer->ncci_state!=NACT)
+		throw CapiWrongState("unable to bridge because connection is not established","Connection::bridge()");
+
+	if (service!=VOICE || peer->service!=VOICE)
+		throw CapiExternalError("bridging is only supported in speech mode","Connection::bridge()");
+
+	pthread_mutex_lock(&bridge_mutex);
+	if (bridge_peer || peer->bridge_peer) {
+		pthread_mutex_unlock(&bridge_mutex);
+		throw CapiExternalError("connection is already bridged","Connection::bridge()");
+	}
+
+	pthread_mutex_lock(&send_mutex);
+	pthread_mutex_lock(&peer->send_mutex);
+	if (file_to_send || prompt_to_send || stream_to_send || peer->file_to_send || peer->prompt_to_send || peer->stream_to_send) {
+		pthread_mutex_unlock(&peer->send_mutex);
+		pthread_mutex_unlock(&send_mutex);
+		pthread_mutex_unlock(&bridge_mutex);
+		throw CapiExternalError("unable to bridge because transmission is already in progress","Connection::bridge()");
+	}
+	stream_to_send=stream_bridged=bridge_prebuffering=true;
+	peer->stream_to_send=peer->stream_bridged=peer->bridge_prebuffering=true;
+	stream_send_data.erase();
+	peer->stream_send_data.erase();
+	pthread_mutex_unlock(&peer->send_mutex);
+	pthread_mutex_unlock(&send_mutex);
+
+	bridge_peer=peer;
+	peer->bridge_peer=this;
+	pthread_mutex_unlock(&bridge_mutex);
+}
+
+void
+Connection::unbridge()
+{
+	pthread_mutex_lock(&bridge_mutex);
+	Connection *peer=bridge_peer;
+	if (peer) {
+		if (debug_level >= 2) {
+			debug << prefix() << "unbridge from " << peer->prefix() << endl;
+		}
+		bridge_peer=NULL;
+		peer->bridge_peer=NULL;
+
+		pthread_mutex_lock(&send_mutex);
+		if (stream_bridged)
+			close_send_source();
+		pthread_mutex_unlock(&send_mutex);
+		pthread_mutex_lock(&peer->send_mutex);
+		if (peer->stream_bridged)
+			peer->close_send_source();
+		pthread_mutex_unlock(&peer->send_mutex);
+
+		release_bridge_resps();
+		peer->release_bridge_resps();
+	}
+	pthread_mutex_unlock(&bridge_mutex);
+}
+
+Connection*
+Connection::getBridgePeer()
+{
+	pthread_mutex_lock(&bridge_mutex);
+	Connection *peer=bridge_peer;
+	pthread_mutex_unlock(&bridge_mutex);
+	return peer;
+}
+
+bool
+Connection::bridge_data(unsigned char* data, unsigned short length)
+{
+	bool full=false;
+	pthread_mutex_lock(&send_mutex);
+	try {
+		if (stream_bridged && ncci_state==NACT) {
+			stream_send_data.append(reinterpret_cast<char*>(data),length);
+			while (data_to_send() && buffers_used<send_window)
+				send_block();
+			full=(stream_send_data.size()>conf_bridge_buffer);
+		}
+	}
+	catch (CapiError e) {
+		error << prefix() << "WARNING: Can't forward bridged data. Message was: " << e << endl;
+	}
+	pthread_mutex_unlock(&send_mutex);
+	return full;
+}
+
+void
+Connection::release_bridge_resps()
+{
+	list<pair<_cword,_cword> > resps;
+	resps.swap(bridge_pending_resps);
+	send_pending_resps(resps);
+}
+
 void
 Connection::enableDTMF() throw (CapiWrongState, CapiMsgError)
 {
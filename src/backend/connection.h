@@ -19,9 +19,14 @@
 
 #include <capi20.h>
 #include <vector>
+#include <list>
 #include <string>
 #include <fstream>
 #include "capiexception.h"
+#include "promptcache.h"
+#include "audiocodec.h"
+#include "sffindex.h"
+#include "ddiplan.h"
 
 class CallInterface;
 class Capi;
@@ -132,6 +137,9 @@ class Connection
 
 		    The file has to be in the correct format expected by CAPI, i.e. bit-reversed A-Law, 8 khz, mono (".la" for sox) for speech, SFF for faxG3
 
+		    Files for speech connections are taken from the PromptCache, so often used announcements are held in memory
+		    and needn't be read again for each call. Fax files are read directly from disk.
+
  		    @param filename the name of the file which should be sent
 		    @throw CapiWrongState Thrown if Connection isn't up completely (physical & logical)
 		    @throw CapiExternalError Thrown if file transmission is already in progress or the file couldn't be opened
@@ -140,12 +148,50 @@ class Connection
 		*/
 		void start_file_transmission(string filename) throw (CapiError,CapiWrongState,CapiExternalError,CapiMsgError);
 
+		/** @brief called to start sending of several files in a row
+
+		    The files are sent one after another as if they were one file. The send window is filled across the file boundaries,
+		    so there are no gaps between the files. CallInterface::transmissionComplete() is called after the last file.
+
+		    This is only supported for speech connections. All files are taken from the PromptCache, so each of them
+		    must be in bit-reversed A-Law, 8 khz, mono (".la" for sox).
+
+		    Files which are played only once (e.g. recorded messages) should be sent with cache=false,
+		    so they don't replace the announcements in the PromptCache.
+
+		    Normally, the data is sent in blocks of 2048 bytes. If the transmission may be aborted by the
+		    caller (see abort_file_transmission()), smaller blocks can be used so that less already sent audio
+		    is still played after the abort. Blocks passed to CAPI can't be recalled, so only two of the
+		    smaller blocks are passed at once then.
+
+ 		    @param filenames the names of the files which should be sent
+		    @param block_size size of the blocks to send (1..2048 bytes)
+		    @param cache false: don't add the files to the PromptCache
+		    @throw CapiWrongState Thrown if Connection isn't up completely (physical & logical)
+		    @throw CapiExternalError Thrown if transmission is already in progress, the connection isn't in speech mode, the block size is invalid or one of the files couldn't be read
+		    @throw CapiMsgError Thrown by send_block(). See there.
+		    @throw CapiError Thrown by send_block(). See there.
+		*/
+		void start_file_transmission(vector<string> filenames, unsigned short block_size=2048, bool cache=true) throw (CapiError,CapiWrongState,CapiExternalError,CapiMsgError);
+
 		/** @brief called to stop sending of the current file, will block until file is really finished
 
 		    If you stop the file transmission manually, CallInterface::transferCompleted won't be called.
 		*/
 		void stop_file_transmission();
 
+		/** @brief called to stop sending of the current file w/o waiting for the sent blocks to be confirmed
+
+		    In contrast to stop_file_transmission(), this method returns immediately. So it can be called
+		    from the CallInterface methods (e.g. CallInterface::dataIn()), which are called by the thread
+		    handling the CAPI messages. stop_file_transmission() must be called later nevertheless before a new
+		    transmission is started. The blocks already passed to CAPI are still played (see
+		    start_file_transmission(vector<string>,unsigned short)), all others are dropped.
+
+		    CallInterface::transferCompleted won't be called.
+		*/
+		void abort_file_transmission();
+
 		/** @brief called to activate receive mode
 
 		    This method doen't do anything active, it will only set the receive mode for this connection
@@ -153,11 +199,15 @@ class Connection
 		    is written to this file w/o changes. So it's in the native format given by CAPI (i.e. inserved A-Law
 		    for speech, SFF for FaxG3).
 
+		    In speech mode, the data can be compressed to IMA ADPCM while it's received (see AudioCodec). This
+		    halves the file size. Such files are decoded automatically when they're sent with start_file_transmission().
+
  		    @param filename name of the file to which to save the incoming data
+		    @param compress true: save speech compressed with IMA ADPCM
 		    @throw CapiWrongState Thrown if Connection isn't up completely (physical & logical)
-		    @throw CapiExternalError Thrown if file reception is already in progress or the file couldn't be opened
+		    @throw CapiExternalError Thrown if file reception is already in progress, the file couldn't be opened or compression is requested for a non-speech connection
 		*/
-		void start_file_reception(string filename) throw (CapiWrongState, CapiExternalError);
+		void start_file_reception(string filename, bool compress=false) throw (CapiWrongState, CapiExternalError);
 
 		/** @brief called to stop receive mode
 
@@ -165,6 +215,110 @@ class Connection
 		*/
 		void stop_file_reception();
 
+		/** @brief called to start sending of data which is given in memory instead of a file
+
+		    After calling this, the data to send must be given with stream_write(). It is sent as soon as the
+		    send window permits. Call stream_close() after the last data was written. CallInterface::transmissionComplete()
+		    is called when all data was sent then.
+
+		    The data has to be in the correct format expected by CAPI, i.e. bit-reversed A-Law, 8 khz, mono for speech.
+
+		    stop_file_transmission() also stops a stream transmission.
+
+		    @throw CapiWrongState Thrown if Connection isn't up completely (physical & logical)
+		    @throw CapiExternalError Thrown if a transmission is already in progress
+		*/
+		void start_stream_transmission() throw (CapiWrongState, CapiExternalError);
+
+		/** @brief give data to send in a stream transmission
+
+		    The data is only accepted as long as it fits into the stream buffer, which holds as much data as the
+		    send window. So the caller has to retry with the rest of the data after some time if not everything
+		    was accepted. This way the producer is slowed down to the speed of the B channel.
+
+		    @param data the data to send
+		    @param length length of the data in bytes
+		    @return number of bytes which were accepted, 0 if the buffer is full at the moment
+		    @throw CapiWrongState Thrown if Connection isn't up completely (physical & logical)
+		    @throw CapiExternalError Thrown if no stream transmission was started or it was already closed
+		    @throw CapiMsgError Thrown by send_block(). See there.
+		    @throw CapiError Thrown by send_block(). See there.
+		*/
+		unsigned long stream_write(const char* data, unsigned long length) throw (CapiError,CapiWrongState,CapiExternalError,CapiMsgError);
+
+		/** @brief tell that no more data will be written to the current stream transmission
+
+		    The data which is still in the buffer will be sent, CallInterface::transmissionComplete() is called afterwards.
+
+		    @throw CapiExternalError Thrown if no stream transmission was started
+		    @throw CapiMsgError Thrown by send_block(). See there.
+		    @throw CapiError Thrown by send_block(). See there.
+		*/
+		void stream_close() throw (CapiError,CapiWrongState,CapiExternalError,CapiMsgError);
+
+		/** @brief called to start receiving data to memory instead of a file
+
+		    The received data is collected in a buffer and can be fetched with stream_read(). If the buffer
+		    holds more data than the CAPI window, DATA_B3_RESP messages are held back until the data is read,
+		    so a slow consumer slows down the CAPI instead of filling up our memory.
+
+		    This can be used in parallel to start_file_reception().
+
+		    @throw CapiWrongState Thrown if Connection isn't up completely (physical & logical)
+		    @throw CapiExternalError Thrown if stream reception is already active
+		*/
+		void start_stream_reception() throw (CapiWrongState, CapiExternalError);
+
+		/** @brief fetch data received in a stream reception
+
+		    @param data buffer where the data will be stored
+		    @param maxlength size of the buffer in bytes
+		    @return number of bytes stored to data, 0 if no data is available at the moment
+		    @throw CapiExternalError Thrown if stream reception isn't active
+		*/
+		unsigned long stream_read(char* data, unsigned long maxlength) throw (CapiExternalError);
+
+		/** @brief called to stop stream reception
+
+		    Discards all data which wasn't read yet.
+		*/
+		void stop_stream_reception();
+
+		/** @brief connect the B channel of this connection with the one of another connection
+
+		    From now on, all data received on one connection is sent on the other one and vice versa
+		    w/o any interaction of the application. This allows to connect two calls through, e.g. to forward
+		    a call.
+
+		    The data is copied directly from the DATA_B3_IND of one connection to a DATA_B3_REQ of the other.
+		    A small jitter buffer is used: sending is started when some data has been collected and after
+		    each underrun. If the other side can't send the data fast enough, the DATA_B3_RESP messages are held
+		    back, so the CAPI flow control slows down the receiving side.
+
+		    File or stream reception on both connections can be used in parallel (e.g. to record the call).
+		    No file or stream transmission is possible while the connections are bridged.
+
+		    Both connections must be in speech mode. The bridge is removed automatically if one of the
+		    connections is cleared.
+
+		    @param peer the connection to connect with
+		    @throw CapiWrongState Thrown if one of the connections isn't up completely (physical & logical)
+		    @throw CapiExternalError Thrown if one of the connections is already bridged, isn't in speech mode or a transmission is in progress
+		*/
+		void bridge(Connection *peer) throw (CapiWrongState, CapiExternalError);
+
+		/** @brief remove the connection established with bridge()
+
+		    Nothing happens if this connection isn't bridged.
+		*/
+		void unbridge();
+
+		/** @brief tell if this connection is bridged with another one
+
+		    @return pointer to the other connection, NULL if not bridged
+		*/
+		Connection* getBridgePeer();
+
 		/** @brief Tells disconnectCall() method how to disconnect.
 		*/
 		enum disconnect_mode_t {
@@ -329,6 +483,16 @@ class Connection
 		*/
 		fax_info_t* getFaxInfo();
 
+		/** @brief Return the page index of the fax currently or last received
+
+		    The index is built while the data is received (see SffIndex), so it can be used to
+		    watch the progress of a fax reception. It's valid until the next reception is started
+		    or the Connection object is deleted.
+
+		    @return pointer to the index, NULL if no fax was received
+		*/
+		SffIndex* getFaxIndex();
+
 		/** @brief Output error message
 
 		    This is intended for external use if some other part of the application wants to make a error-log entry.
@@ -361,11 +525,9 @@ class Connection
 
 		    @param message the received CONNECT_IND message
 		    @param capi pointer to the Capi Object
-		    @param DDILength set the length of DDI extension numbers (0=default means disable DDI)
-		    @param DDIBaseLength the length of the base number of the PtP interface
-		    @param DDIStopNumbers a vector of strings listing complete DDI extension numbers which are shorter than DDILength 
+		    @param plan numbering plan used to decide when the DDI is complete (owned by Capi), NULL means DDI is disabled
 		*/
-		Connection (_cmsg& message, Capi *capi, unsigned short DDILength=0, unsigned short DDIBaseLength=0, std::vector<std::string> DDIStopNumbers=std::vector<std::string>());
+		Connection (_cmsg& message, Capi *capi, const DDIPlan *plan=NULL);
 
 		/********************************************************************************/
     		/*	    methods handling CAPI messages - called by the Capi class		*/
@@ -569,10 +731,13 @@ class Connection
 
 		    The transmission will be controlled automatically by Connection, so you don't
 		    need to call this method directly. send_block() will automatically send as much
-		    packets as the configured window size (conf_send_buffers) permits.
+		    packets as the window size (send_window) permits.
 
 		    Will call CallInterface::transmissionComplete() if the file was transferred completely.
 
+		    The data is read from prompt_to_send if set (speech), otherwise from file_to_send. If prompt_to_send is
+		    finished, the block is filled up with the next entry of prompts_queued.
+
 		    @throw CapiWrongState Thrown when the the connection is not up completely (physical & logical)
  		    @throw CapiExternalError Thrown when no CallInterface is registered
  		    @throw CapiError Thrown on some internal errors
@@ -580,6 +745,43 @@ class Connection
 		*/
 		void send_block() throw (CapiError,CapiWrongState,CapiExternalError,CapiMsgError);
 
+		/** @brief tell if there's something to send at the moment
+
+		    This is the case while a file is sent or while enough data for one block was written to
+		    a stream. The caller must hold send_mutex.
+
+		    @return true if send_block() should be called
+		*/
+		bool data_to_send();
+
+		/** @brief send the DATA_B3_RESP messages held back by stream reception
+
+		    @param resps list of message numbers and data handles to confirm
+		*/
+		void send_pending_resps(list<pair<_cword,_cword> > resps);
+
+		/** @brief send data received on the bridged connection
+
+		    Called by data_b3_ind() of the bridge peer with bridge_mutex held.
+
+		    @param data the received data
+		    @param length length of the data in bytes
+		    @return true if the buffer is full, i.e. the peer should hold back its DATA_B3_RESP
+		*/
+		bool bridge_data(unsigned char* data, unsigned short length);
+
+		/** @brief send the DATA_B3_RESP messages held back because the bridge peer was too slow
+
+		    The caller must hold bridge_mutex.
+		*/
+		void release_bridge_resps();
+
+		/** @brief close the file or give back the cached prompts which are currently sent
+
+		    The caller must hold send_mutex.
+		*/
+		void close_send_source();
+
 		/** @brief called to build the B Configuration info elements out of given service
 
 		    This is a convenience function to do the quite annoying enconding stuff for the
@@ -650,6 +852,7 @@ class Connection
 		} ncci_state;
 
 		_cdword plci;    ///< CAPI id for call
+		_cdword controller; ///< number of the controller used for this call
 		_cdword ncci;    ///< id for logical connection
 
 		service_t service; ///< as described in Connection::service_t, set to the last known service (either got from ISDN or set explicitly)
@@ -674,7 +877,28 @@ class Connection
 				receive_mutex; ///< to realize critical sections in reception code
 
 		ofstream *file_for_reception; ///< NULL if no file is received, pointer to the file otherwise
+		AudioCodec *reception_codec; ///< NULL if the received data is saved unchanged, pointer to the coder used to compress it otherwise
+		SffIndex *fax_index; ///< page index of the fax currently or last received, NULL if no fax was received
 		ifstream *file_to_send;  ///< NULL if no file is sent, pointer to the file otherwise
+		PromptCache::Prompt *prompt_to_send; ///< NULL if no cached file is sent, pointer to the cache entry otherwise
+		unsigned long prompt_pos; ///< position of the next byte to send from prompt_to_send
+		unsigned short send_block_size; ///< maximum size of the blocks sent by send_block()
+		unsigned short send_window; ///< maximum number of blocks passed to CAPI and not confirmed yet
+		list<PromptCache::Prompt*> prompts_queued; ///< cache entries to send after prompt_to_send (see start_file_transmission(vector<string>))
+
+		bool stream_to_send, ///< true if a stream transmission is active, see start_stream_transmission()
+			stream_closed; ///< true if no more data will be written to the stream
+		string stream_send_data; ///< data written to the stream which wasn't sent yet
+
+		bool stream_for_reception; ///< true if stream reception is active, see start_stream_reception()
+		string stream_received_data; ///< received data which wasn't read yet
+		list<pair<_cword,_cword> > stream_pending_resps; ///< message numbers and data handles of DATA_B3_INDs not confirmed yet
+
+		Connection *bridge_peer; ///< connection we're bridged with (see bridge()), NULL otherwise
+		bool stream_bridged, ///< true if the stream transmission is fed by the bridge peer
+			bridge_prebuffering; ///< true while the jitter buffer is filled before sending is (re)started
+		list<pair<_cword,_cword> > bridge_pending_resps; ///< DATA_B3_INDs not confirmed because the bridge peer was too slow
+		static pthread_mutex_t bridge_mutex; ///< protects bridge_peer and bridge_pending_resps of all connections
                                      
 		ostream &debug, ///< debug stream
 		        &error; ///< stream for error messages 
@@ -695,9 +919,8 @@ class Connection
 
 		fax_info_t* fax_info; ///< holds some data about fax connections
 
-		unsigned short DDILength; ///< the length of DDI extension numbers. 0 means DDI disabled
-		unsigned short DDIBaseLength; ///< the length of the base number for a PtP interface
-		vector<string> DDIStopNumbers; ///< list of complete DDI extensions shorter than DDILength
+		const DDIPlan *ddi_plan; ///< numbering plan for the DDI (owned by Capi), NULL if DDI is disabled
+		int ddi_state; ///< current state of the received DDI in ddi_plan
 };
 
 #endif
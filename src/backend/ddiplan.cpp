@@ -0,0 +1,66 @@
+/*  @file ddiplan.cpp
+    @brief Contains DDIPlan - compiled numbering plan for DDI completion in PtP mode
+
+    @author agent <agent@local>
+*/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "ddiplan.h"
+
+DDIPlan::DDIPlan(unsigned short length, unsigned short baseLength, const vector<string> &stopNumbers)
+:nodes(1),ddi_length(length),base_length(baseLength)
+{
+	Node empty;
+	for (int i=0;i<12;i++)
+		empty.next[i]=-1;
+	empty.stop=false;
+	nodes[0]=empty;
+
+	for (unsigned i=0;i<stopNumbers.size();i++) {
+		int state=0;
+		for (unsigned j=0;j<stopNumbers[i].size() && state>=0;j++) {
+			int e=edge(stopNumbers[i][j]);
+			if (e<0)
+				state=-1; // can't be signalled, so it will never match
+			else {
+				if (nodes[state].next[e]<0) {
+					nodes[state].next[e]=nodes.size();
+					nodes.push_back(empty);
+				}
+				state=nodes[state].next[e];
+			}
+		}
+		if (state>=0)
+			nodes[state].stop=true;
+	}
+}
+
+int
+DDIPlan::next(int state, char digit) const
+{
+	int e=edge(digit);
+	if (state<0 || e<0)
+		return -1;
+	return nodes[state].next[e];
+}
+
+int
+DDIPlan::edge(char digit)
+{
+	if (digit>='0' && digit<='9')
+		return digit-'0';
+	else if (digit=='*')
+		return 10;
+	else if (digit=='#')
+		return 11;
+	else
+		return -1;
+}
@@ -0,0 +1,93 @@
+/** @file ddiplan.h
+    @brief Contains DDIPlan - compiled numbering plan for DDI completion in PtP mode
+
+    @author agent <agent@local>
+*/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef DDIPLAN_H
+#define DDIPLAN_H
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/** @brief Compiled numbering plan for DDI completion in PtP mode
+
+    In PtP mode, the called number of an incoming call is signalled digit by digit
+    in INFO_IND messages after the CONNECT_IND. The number is complete when the
+    extension (DDI) following the base number has DDILength digits or matches one
+    of the shorter stop numbers.
+
+    To avoid comparing the DDI with all stop numbers for each INFO_IND, the stop
+    numbers are compiled into a prefix tree once when Capi is created. Each
+    Connection only keeps its current node in the tree and follows one edge for
+    each received digit, so checking for completion takes constant time. The plan
+    isn't changed after its creation, so all connections can share the one owned
+    by Capi.
+
+    @author agent
+*/
+class DDIPlan
+{
+	public:
+		/** @brief Constructor. Compile the numbering plan.
+
+		    @param length length of the DDI, 0 means DDI is disabled (PtMP)
+		    @param baseLength length of the base number w/o extension
+		    @param stopNumbers list of complete DDIs shorter than length
+		*/
+		DDIPlan(unsigned short length=0, unsigned short baseLength=0, const vector<string> &stopNumbers=vector<string>());
+
+		/** @brief Return the state before the first digit of the DDI
+		*/
+		int start() const { return 0; }
+
+		/** @brief Follow one digit of the DDI
+
+		    @param state the current state
+		    @param digit the next digit of the DDI
+		    @return the new state
+		*/
+		int next(int state, char digit) const;
+
+		/** @brief Check if the DDI received up to the given state is a stop number
+		*/
+		bool isStop(int state) const { return state>=0 && nodes[state].stop; }
+
+		/** @brief Return the length of the DDI, 0 if DDI is disabled
+		*/
+		unsigned short length() const { return ddi_length; }
+
+		/** @brief Return the length of the base number
+		*/
+		unsigned short baseLength() const { return base_length; }
+
+	private:
+		/** @brief Return the edge index for a digit, -1 if no stop number can contain it
+		*/
+		static int edge(char digit);
+
+		/** @brief One node of the prefix tree
+		*/
+		struct Node
+		{
+			int next[12]; ///< following nodes for the digits 0-9, * and #, -1 if there's no stop number with this prefix
+			bool stop; ///< true if the digits leading to this node are a stop number
+		};
+
+		vector<Node> nodes; ///< the prefix tree of the stop numbers, nodes[0] is the root
+		unsigned short ddi_length; ///< length of the DDI (0=PtMP)
+		unsigned short base_length; ///< length of the base number
+};
+
+#endif
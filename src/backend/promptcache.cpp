@@ -0,0 +1,129 @@
+/*  @file promptcache.cpp
+    @brief Contains PromptCache - process-wide memory cache for audio files sent to the B channel
+
+    @author agent <agent@local>
+*/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include <fstream>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "audiocodec.h"
+#include "promptcache.h"
+
+map<string,PromptCache::Prompt*> PromptCache::prompts;
+list<PromptCache::Prompt*> PromptCache::lru;
+unsigned long PromptCache::used=0;
+unsigned long PromptCache::limit=0;
+pthread_mutex_t PromptCache::mutex=PTHREAD_MUTEX_INITIALIZER;
+
+PromptCache::Prompt*
+PromptCache::acquire(string filename, bool cache) throw (CapiExternalError)
+{
+	struct stat filestat;
+	if (stat(filename.c_str(),&filestat) || !S_ISREG(filestat.st_mode))
+		throw CapiExternalError("unable to open file to send ("+filename+")","PromptCache::acquire()");
+
+	pthread_mutex_lock(&mutex);
+	map<string,Prompt*>::iterator it=prompts.find(filename);
+	if (it!=prompts.end()) {
+		Prompt *p=it->second;
+		if (p->mtime==filestat.st_mtime && p->file_size==static_cast<unsigned long>(filestat.st_size)) {
+			p->refcount++;
+			lru.splice(lru.begin(),lru,p->lru_pos);
+			pthread_mutex_unlock(&mutex);
+			return p;
+		}
+		remove(p); // file was changed, so forget the old contents
+	}
+	pthread_mutex_unlock(&mutex);
+
+	// read the file w/o holding the lock - other transmissions shouldn't wait for our disk
+	Prompt *p=new Prompt(filename,filestat.st_mtime,filestat.st_size);
+	ifstream file(filename.c_str());
+	if (!file || !file.read(p->data,p->size)) {
+		delete p;
+		throw CapiExternalError("unable to read file to send ("+filename+")","PromptCache::acquire()");
+	}
+	if (AudioCodec::isAdpcm(p->data,p->size)) { // compressed recording, keep the decoded data
+		string decoded=AudioCodec::decodeFile(string(p->data,p->size));
+		delete[] p->data;
+		p->data=NULL;
+		p->size=decoded.size();
+		if (p->size) {
+			p->data=new char[p->size];
+			memcpy(p->data,decoded.data(),p->size);
+		}
+	}
+	p->refcount=1;
+
+	pthread_mutex_lock(&mutex);
+	if (cache && p->size<=limit && !prompts.count(filename)) { // if another thread was quicker, just don't cache ours
+		p->cached=true;
+		prompts[filename]=p;
+		p->lru_pos=lru.insert(lru.begin(),p);
+		used+=p->size;
+		evict();
+	}
+	pthread_mutex_unlock(&mutex);
+	return p;
+}
+
+void
+PromptCache::release(Prompt* prompt)
+{
+	if (!prompt)
+		return;
+	pthread_mutex_lock(&mutex);
+	if (prompt->refcount)
+		prompt->refcount--;
+	if (!prompt->cached && !prompt->refcount)
+		delete prompt;
+	else if (used>limit)
+		evict();
+	pthread_mutex_unlock(&mutex);
+}
+
+void
+PromptCache::setLimit(unsigned long bytes)
+{
+	pthread_mutex_lock(&mutex);
+	limit=bytes;
+	evict();
+	pthread_mutex_unlock(&mutex);
+}
+
+void
+PromptCache::evict()
+{
+	list<Prompt*>::iterator it=lru.end();
+	while (used>limit && it!=lru.begin()) {
+		it--;
+		if (!(*it)->refcount) {
+			Prompt *p=*it;
+			it++; // remove() will invalidate the current position
+			remove(p);
+		}
+	}
+}
+
+void
+PromptCache::remove(Prompt* prompt)
+{
+	prompts.erase(prompt->filename);
+	lru.erase(prompt->lru_pos);
+	used-=prompt->size;
+	prompt->cached=false;
+	if (!prompt->refcount)
+		delete prompt;
+}
@@ -0,0 +1,147 @@
+/** @file promptcache.h
+    @brief Contains PromptCache - process-wide memory cache for audio files sent to the B channel
+
+    @author agent <agent@local>
+*/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef PROMPTCACHE_H
+#define PROMPTCACHE_H
+
+#include <pthread.h>
+#include <time.h>
+#include <string>
+#include <map>
+#include <list>
+#include "capiexception.h"
+
+using namespace std;
+
+/** @brief Process-wide memory cache for audio files sent to the B channel
+
+    Announcements like "beep.la", the digit snippets or the greetings of the
+    answering machine are played very often. Instead of opening and reading them
+    for each transmission again, Connection gets them from this cache.
+
+    The files are kept in memory as a whole and are identified by their path.
+    Each entry remembers the modification time and size of the file, so a changed
+    file (e.g. a new greeting recorded by the user) is read again automatically.
+    Files recorded with compression (see AudioCodec) are decoded to A-Law when
+    they're read, so the data of each entry can be sent w/o further conversion.
+
+    Entries are reference counted: a transmission acquires a Prompt with acquire()
+    and gives it back with release(). The total size of all cached files is limited
+    (see setLimit()). If the limit is exceeded, the least recently used entries which
+    are currently not in use are dropped. Files bigger than the limit are read, but
+    not cached - they'll be freed when the transmission releases them.
+
+    All methods are static and protected by a mutex, so they can be used from all
+    Connection objects in parallel.
+
+    @author agent
+*/
+class PromptCache
+{
+	public:
+		/** @brief One file held in memory
+		*/
+		class Prompt
+		{
+			public:
+				/** @brief Constructor. Create an empty entry for the given file.
+
+				    @param filename path of the file
+				    @param mtime modification time of the file when it was read
+				    @param size size of the file in bytes
+				*/
+				Prompt(string filename, time_t mtime, unsigned long size)
+				:filename(filename),mtime(mtime),file_size(size),size(size),data(NULL),refcount(0),cached(false)
+				{
+					if (size)
+						data=new char[size];
+				}
+
+				/** @brief Destructor. Free the data.
+				*/
+				~Prompt()
+				{
+					if (data)
+						delete[] data;
+				}
+
+				string filename; ///< path of the file
+				time_t mtime; ///< modification time of the file when it was read
+				unsigned long file_size; ///< size of the file when it was read
+				unsigned long size; ///< size of the data buffer in bytes (differs from file_size for compressed files)
+				char *data; ///< the file contents
+				unsigned refcount; ///< number of transmissions currently using this entry
+				bool cached; ///< true if this entry is (still) part of the cache index
+				list<Prompt*>::iterator lru_pos; ///< position in PromptCache::lru, only valid while cached
+		};
+
+		/** @brief Get a file from the cache, read it if necessary
+
+		    If the file is already cached and wasn't changed since it was read, the cached
+		    entry is returned. Otherwise the file is read to memory and added to the cache.
+
+		    Files which are played only once (e.g. recorded messages) shouldn't replace the
+		    announcements in the cache, so they can be read w/o adding them.
+
+		    Each successful call must be followed by a call to release() when the data isn't used any more.
+
+		    @param filename path of the file to get
+		    @param cache false: don't add the file to the cache if it must be read
+		    @return pointer to the Prompt holding the file contents
+		    @throw CapiExternalError Thrown if the file can't be read
+		*/
+		static Prompt* acquire(string filename, bool cache=true) throw (CapiExternalError);
+
+		/** @brief Give back an entry got from acquire()
+
+		    Entries which were dropped from the cache in the meantime will be deleted when
+		    they're not used any more.
+
+		    @param prompt the entry to give back
+		*/
+		static void release(Prompt* prompt);
+
+		/** @brief Set the maximum amount of memory used for cached files
+
+		    If the cache is currently bigger, unused entries are dropped immediately.
+		    It's called once at startup, so changes of the configured size need a restart.
+
+		    @param bytes maximum size in bytes, 0 disables the cache
+		*/
+		static void setLimit(unsigned long bytes);
+
+	private:
+		/** @brief drop least recently used entries until the limit is reached
+
+		    Entries currently in use are skipped. The caller must hold the mutex.
+		*/
+		static void evict();
+
+		/** @brief remove an entry from the cache index, delete it if it's unused
+
+		    The caller must hold the mutex.
+
+		    @param prompt the entry to remove
+		*/
+		static void remove(Prompt* prompt);
+
+		static map<string,Prompt*> prompts; ///< cached entries, referenced by file name
+		static list<Prompt*> lru; ///< cached entries, most recently used first
+		static unsigned long used; ///< total size of all cached entries in bytes
+		static unsigned long limit; ///< maximum value for used
+		static pthread_mutex_t mutex; ///< to realize critical sections in all methods
+};
+
+#endif
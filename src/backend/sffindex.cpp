@@ -0,0 +1,160 @@
+/*  @file sffindex.cpp
+    @brief Contains SffIndex - streaming parser building a page index of Structured Fax Files
+
+    @author agent <agent@local>
+*/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "sffindex.h"
+
+SffIndex::SffIndex()
+:position(0),skip(0),needed(12),in_document_header(true),end_of_document(false),error(false)
+{
+	pthread_mutex_init(&mutex,NULL);
+}
+
+SffIndex::~SffIndex()
+{
+	pthread_mutex_destroy(&mutex);
+}
+
+void
+SffIndex::feed(const unsigned char *data, unsigned length)
+{
+	pthread_mutex_lock(&mutex);
+	unsigned i=0;
+	while (i<length && !error && !end_of_document) {
+		if (skip) {
+			unsigned long n=(skip<length-i) ? skip : length-i;
+			skip-=n;
+			i+=n;
+			position+=n;
+			continue;
+		}
+		header+=static_cast<char>(data[i++]);
+		position++;
+		if (header.size()>=needed) {
+			needed=parseRecord();
+			if (!needed) {
+				header.erase();
+				needed=1;
+			}
+		}
+	}
+	position+=length-i; // data after the end of document or after an error isn't parsed
+	pthread_mutex_unlock(&mutex);
+}
+
+unsigned
+SffIndex::parseRecord()
+{
+	const unsigned char *h=reinterpret_cast<const unsigned char*>(header.data());
+
+	if (in_document_header) {
+		unsigned long first_page=h[10] | (h[11] << 8);
+		if (header.compare(0,4,"Sfff") || first_page<12)
+			error=true;
+		in_document_header=false;
+		skip=first_page-12;
+		return 0;
+	}
+
+	if (h[0]==254) { // page header
+		if (header.size()<2)
+			return 2;
+		if (!h[1]) { // length 0 marks the end of the document
+			end_of_document=true;
+			return 0;
+		}
+		if (header.size()<2U+h[1])
+			return 2+h[1];
+		Page p;
+		p.offset=position-header.size();
+		p.vres=h[2];
+		p.hres=h[1]>=2 ? h[3] : 0;
+		p.width=h[1]>=6 ? (h[6] | (h[7] << 8)) : 1728;
+		p.lines=0;
+		index.push_back(p);
+		return 0;
+	}
+
+	if (index.empty()) { // line data w/o page header
+		error=true;
+		return 0;
+	}
+
+	if (!h[0]) { // line longer than 216 bytes, length follows as word
+		if (header.size()<3)
+			return 3;
+		skip=h[1] | (h[2] << 8);
+		index.back().lines++;
+	} else if (h[0]<=216) { // normal line, type gives the length
+		skip=h[0];
+		index.back().lines++;
+	} else if (h[0]<=253) { // white lines
+		index.back().lines+=h[0]-216;
+	} else { // 255: illegal line coding (followed by 0) or user information (followed by its length)
+		if (header.size()<2)
+			return 2;
+		if (!h[1])
+			index.back().lines++;
+		else
+			skip=h[1];
+	}
+	return 0;
+}
+
+unsigned
+SffIndex::completePages()
+{
+	pthread_mutex_lock(&mutex);
+	unsigned complete=index.size();
+	if (complete && !end_of_document) // the last page is still being received
+		complete--;
+	pthread_mutex_unlock(&mutex);
+	return complete;
+}
+
+unsigned long
+SffIndex::bytes()
+{
+	pthread_mutex_lock(&mutex);
+	unsigned long b=position;
+	pthread_mutex_unlock(&mutex);
+	return b;
+}
+
+bool
+SffIndex::finished()
+{
+	pthread_mutex_lock(&mutex);
+	bool f=end_of_document;
+	pthread_mutex_unlock(&mutex);
+	return f;
+}
+
+bool
+SffIndex::valid()
+{
+	pthread_mutex_lock(&mutex);
+	bool v=!error;
+	pthread_mutex_unlock(&mutex);
+	return v;
+}
+
+vector<SffIndex::Page>
+SffIndex::pages()
+{
+	pthread_mutex_lock(&mutex);
+	vector<Page> p(index);
+	pthread_mutex_unlock(&mutex);
+	return p;
+}
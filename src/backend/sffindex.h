@@ -0,0 +1,125 @@
+/** @file sffindex.h
+    @brief Contains SffIndex - streaming parser building a page index of Structured Fax Files
+
+    @author agent <agent@local>
+*/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef SFFINDEX_H
+#define SFFINDEX_H
+
+#include <pthread.h>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/** @brief Streaming parser building a page index of Structured Fax Files
+
+    During a fax reception, Connection feeds all received data to this class. It
+    follows the record structure of the SFF data (see CAPI 2.0 spec, annex B)
+    byte by byte, so records may be split over several data blocks. The line data
+    itself isn't stored, only an index of the pages found so far.
+
+    A page is complete as soon as the header of the next page or the end of the
+    document is seen, so the number of complete pages can be used to report the
+    progress of a reception while the call is still active.
+
+    If the data doesn't start with the SFF magic (e.g. for a color fax), the
+    parser stops and the index stays empty.
+
+    feed() is called from the Capi thread while the other methods may be called
+    from the application at the same time, so all methods are protected by a mutex.
+
+    @author agent
+*/
+class SffIndex
+{
+	public:
+		/** @brief Index entry of one page
+		*/
+		struct Page
+		{
+			unsigned long offset; ///< position of the page header in the file
+			unsigned char vres; ///< vertical resolution code from the page header (0=98 lpi, 1=196 lpi)
+			unsigned char hres; ///< horizontal resolution code from the page header
+			unsigned short width; ///< line length in pixels
+			unsigned lines; ///< number of lines received so far
+		};
+
+		/** @brief Constructor. Create an empty index.
+		*/
+		SffIndex();
+
+		/** @brief Destructor. Free the mutex.
+		*/
+		~SffIndex();
+
+		/** @brief Parse the next block of data
+
+		    @param data the received data
+		    @param length length of the data in bytes
+		*/
+		void feed(const unsigned char *data, unsigned length);
+
+		/** @brief return the number of pages which were received completely
+
+		    @return number of complete pages
+		*/
+		unsigned completePages();
+
+		/** @brief return the number of data bytes fed to the parser
+
+		    @return number of bytes
+		*/
+		unsigned long bytes();
+
+		/** @brief return whether the end of document was seen
+
+		    @return true if the document is complete
+		*/
+		bool finished();
+
+		/** @brief return whether the data is valid SFF so far
+
+		    @return false if the data isn't SFF or is damaged
+		*/
+		bool valid();
+
+		/** @brief return the index entries of all pages seen so far
+
+		    The last page may be incomplete if finished() is false.
+
+		    @return copy of the page index
+		*/
+		vector<Page> pages();
+
+	private:
+		/** @brief parse the record collected in header, called when it's complete
+
+		    The caller must hold the mutex.
+
+		    @return number of bytes still needed to complete the record header, 0 if it was handled
+		*/
+		unsigned parseRecord();
+
+		vector<Page> index; ///< the pages found so far
+		string header; ///< collects the header of the current record until it's complete
+		unsigned long position; ///< number of bytes fed so far
+		unsigned long skip; ///< number of bytes which can be skipped (line data, user data)
+		unsigned long needed; ///< number of bytes needed to complete header
+		bool in_document_header; ///< true while the document header wasn't parsed yet
+		bool end_of_document; ///< true if the end of document was seen
+		bool error; ///< true if the data isn't valid SFF
+		pthread_mutex_t mutex; ///< to realize critical sections in all methods
+};
+
+#endif
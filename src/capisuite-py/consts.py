@@ -16,7 +16,13 @@ the Free Software Foundation; either version 2 of the License, or
 """
 
 SEND_Q = 'sendq'
+DONE_Q = 'done'
+FAILED_Q = 'failed'
 RECEIVED_Q = 'received'
+CACHE_Q = 'cache'
+
+# subdirectory of the sendq holding the jobs claimed by each node
+CLAIMED_DIR = 'claimed'
 
 __known_sections__ = ('GLOBAL',
                       'MailFaxSent',
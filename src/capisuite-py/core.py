@@ -21,6 +21,11 @@ try:
    import _capisuite 
    # now add symbols directly used by the scripts to our namespace
    from _capisuite import log,error,SERVICE_VOICE,SERVICE_FAXG3,CallGoneError
+   from _capisuite import la2wav,la2pcm,sff2tiff,sff2pdf,cff2pdf,sff_slice
+   from _capisuite import schedule_job,unschedule_job,job_scheduled,due_jobs
+   from _capisuite import watch_queue,job_running,unique_number
+   from _capisuite import sff_pages
+   from _capisuite import process_lock,process_unlock
 except ImportError:
     pass
 
@@ -58,14 +63,15 @@ class Capi:
         called party.
         
         Parameters:
-        controller: ISDN controller ID to use
+        controller: ISDN controller ID to use or a list of them, 0 for
+                    all; the least loaded one supporting voice is taken
         call_from: own number to use (string)
         call_to: the number to call (string)
         timeout: timeout in seconds to wait for connection establishment
         clir: disable sending of own number (default=0, send number)
 
         On success returns a call object; on failure returns an
-        error_code.
+        error_code (0x34A2 if none of the controllers is free).
         """
         call, result = _capisuite.call_voice(self._handle, controller,
                                        call_from, call_to,
@@ -90,7 +96,8 @@ class Capi:
         called party.
         
         Parameters:
-        controller: ISDN controller ID to use
+        controller: ISDN controller ID to use or a list of them, 0 for
+                    all; the least loaded one supporting fax is taken
         call_from: own number to use (string)
         call_to: the number to call (string)
         timeout: timeout in seconds to wait for connection establishment
@@ -99,7 +106,7 @@ class Capi:
         clir: disable sending of own number (default=0, send number)
 
         On success returns a call object; on failure returns an
-        error_code.
+        error_code (0x34A2 if none of the controllers is free).
         """
         call, result = _capisuite.call_faxG3(self._handle, controller,
                                              call_from, call_to,
@@ -108,6 +115,27 @@ class Capi:
             return None, result
         return Call(call, SERVICE_FAXG3, call_from, call_to), None
 
+    def send_job(self, controller, user, controlfile):
+        """
+        Send a job of the send queue in an own thread.
+
+        The job is handed over to the function sendJob() of the idle
+        script which is called in an own thread, so several jobs can
+        be sent in parallel - one for each free B channel. The least
+        loaded of the controllers is chosen for the job and given to
+        sendJob().
+
+        Parameters:
+        controller: ISDN controller ID to use or a list of them, 0 for all
+        user: owner of the job
+        controlfile: control file of the job
+
+        Returns 1 if the job was started, 0 if all B channels of the
+        controllers are busy and -1 if the job is already being sent.
+        """
+        return _capisuite.send_job(self._handle, controller, user,
+                                   controlfile)
+
 
 class Call:
     def __init__(self, handle, service, call_from, call_to):
@@ -265,7 +293,7 @@ class Call:
 
 
     def audio_receive(self, filename, timeout, silence_timeout=0,
-                      exit_DTMF=0):
+                      exit_DTMF=0, compress=0):
         """
         Receive an audio file in a speech mode connection.
 
@@ -287,20 +315,24 @@ class Call:
         otherwise an exception will be caused.
 
         The created file will be saved in bit-reversed A-Law format, 8
-        kHz mono. Use sox to convert it to a normal wav file.
+        kHz mono. Use la2wav() to convert it to a normal wav file.
+        If compress is set, the file is saved with IMA ADPCM instead,
+        which halves its size. audio_send() and la2wav() decode such
+        files automatically.
         
         filename: where to save the received message.
         timeout: receive length in seconds (-1 = infinite).
         silence_timeout: abort after x seconds of silence (default: no timeout)
         exit_DTMF: abort sending when a DTMF signal is received (default: 0)
+        compress: save the file compressed (default: 0)
 
         Returns duration of receiving in seconds.
         """
         return _capisuite.audio_receive(self._handle, filename, timeout,
-                                        silence_timeout, exit_DTMF)
+                                        silence_timeout, exit_DTMF, compress)
 
 
-    def audio_send(self, filename, exit_DTMF=0):
+    def audio_send(self, filename, exit_DTMF=0, cache=1):
         """
         Send an audio file in a speech mode connection.
 
@@ -318,12 +350,159 @@ class Call:
         The connction must be in audio mode (use connect_voice()),
         otherwise an exception will be caused.
 
+        Sent files are kept in memory for the next calls. Files which
+        are played only once (e.g. recorded messages) should be sent
+        with cache=0, so they don't replace the announcements there.
+
         filename: file to send
         exit_DTMF: abort sending when a DTMF signal is received (default: 0)
+        cache: keep the file in memory (default: 1)
+
+        Returns duration of send in seconds.
+        """
+        return _capisuite.audio_send(self._handle, filename, exit_DTMF,
+                                     cache)
+
+
+    def audio_send_sequence(self, filenames, exit_DTMF=0):
+        """
+        Send several audio files in a row in a speech mode connection.
+
+        The files are sent as one transmission, so there are no gaps
+        between them. Use this for announcements put together from
+        several snippets (e.g. numbers). All files must be in
+        bit-inversed A-Law format.
+
+        DTMF abort works like in audio_send() and aborts the whole
+        sequence.
+
+        filenames: list of files to send
+        exit_DTMF: abort sending when a DTMF signal is received (default: 0)
 
         Returns duration of send in seconds.
         """
-        return _capisuite.audio_send(self._handle, filename, exit_DTMF)
+        return _capisuite.audio_send_sequence(self._handle, list(filenames),
+                                              exit_DTMF)
+
+
+    def audio_send_receive(self, filenames, record_filename, timeout,
+                           silence_timeout=0, exit_DTMF=0):
+        """
+        Play audio files and record at the same time.
+
+        The files are played like in audio_send_sequence() while the
+        received audio is saved like in audio_receive(). If the caller
+        starts speaking or sends a DTMF signal during the playback, it is
+        stopped immediately ("barge-in"). The recording continues until
+        one of the timeouts is reached.
+
+        filenames: list of files to play
+        record_filename: where to save the received audio
+        timeout: maximum length of the recording in seconds (-1 = infinite)
+        silence_timeout: finish after x seconds of silence after the
+                         playback (default: 0 = off)
+        exit_DTMF: also finish the recording when a DTMF signal is
+                   received (default: 0)
+
+        Returns a tuple (barge_in, duration): barge_in is the position in
+        milliseconds at which the caller interrupted the playback (-1 if
+        it was played completely), duration is the length of the
+        recording in seconds.
+        """
+        return _capisuite.audio_send_receive(self._handle, list(filenames),
+                                             record_filename, timeout,
+                                             silence_timeout, exit_DTMF)
+
+
+    def bridge(self, other, timeout=-1, exit_DTMF=0):
+        """
+        Connect this call with another one.
+
+        Everything received on one call is sent on the other one. The
+        audio data is forwarded by the backend, so Python isn't involved.
+        Returns when one of the calls is finished, the timeout is reached
+        or a DTMF signal is received on this call (if exit_DTMF is set).
+
+        other: the call to connect with (must be a voice call, too)
+        timeout: maximum duration in seconds (default: -1 = infinite)
+        exit_DTMF: finish when a DTMF signal is received (default: 0)
+        """
+        _capisuite.bridge(self._handle, other._handle, timeout, exit_DTMF)
+
+
+    def audio_stream_start(self):
+        """
+        Start sending audio data from memory in a speech mode connection.
+
+        Use this to play generated audio (e.g. from a TTS engine) without
+        writing it to a file first. Give the data with
+        audio_stream_write() and call audio_stream_finish() at the end.
+        """
+        _capisuite.audio_stream_start(self._handle)
+
+
+    def audio_stream_write(self, data, exit_DTMF=0):
+        """
+        Give audio data to a stream started with audio_stream_start().
+
+        If the stream buffer is full, this waits until enough data was
+        sent, so the caller produces data at the speed it's played. The
+        data must be in bit-inversed A-Law format.
+
+        data: the audio data to send
+        exit_DTMF: stop waiting when a DTMF signal is received (default: 0)
+
+        Returns the number of bytes accepted. This may be less than
+        len(data) if exit_DTMF is set and DTMF was received. If the
+        call is finished before all data was accepted, CallGoneError
+        is raised.
+        """
+        return _capisuite.audio_stream_write(self._handle, data, exit_DTMF)
+
+
+    def audio_stream_finish(self, exit_DTMF=0):
+        """
+        Wait until all data of the stream was sent and stop it.
+
+        exit_DTMF: stop the stream immediately when a DTMF signal is
+                   received (default: 0)
+        """
+        _capisuite.audio_stream_finish(self._handle, exit_DTMF)
+
+
+    def audio_stream_receive_start(self):
+        """
+        Start receiving audio data to memory in a speech mode connection.
+
+        The data can be read with audio_stream_read(). If it isn't read
+        fast enough, the reception is slowed down. Call
+        audio_stream_receive_stop() at the end.
+        """
+        _capisuite.audio_stream_receive_start(self._handle)
+
+
+    def audio_stream_read(self, maxlength, timeout, exit_DTMF=0):
+        """
+        Read audio data received since the last call.
+
+        maxlength: maximum number of bytes to return (at most 8192 are
+                   returned per call)
+        timeout: seconds to wait if no data is available
+                 (-1 = infinite, 0 = don't wait)
+        exit_DTMF: stop waiting when a DTMF signal is received (default: 0)
+
+        Returns the data in bit-inversed A-Law format or an empty string
+        if no data is available.
+        """
+        return _capisuite.audio_stream_read(self._handle, maxlength, timeout,
+                                            exit_DTMF)
+
+
+    def audio_stream_receive_stop(self):
+        """
+        Stop receiving audio data to memory. Unread data is discarded.
+        """
+        _capisuite.audio_stream_receive_stop(self._handle)
 
 
     def switch_to_faxG3(self, faxStationID, faxHeadline):
@@ -403,7 +582,7 @@ class Call:
         return FaxInfo(*faxInfo)
 
 
-    def fax_receive(self, filename):
+    def fax_receive(self, filename, progress=None):
         """
         Receive a fax in a fax mode connection.
 
@@ -418,13 +597,30 @@ class Call:
         (SFF) format.
 
         filename: where to save the received fax.
+        progress: function called each time a page was received
+                  completely. It gets the number of complete pages and
+                  the number of bytes received so far.
         """
-        faxInfo = _capisuite.fax_receive(self._handle, filename)
+        faxInfo = _capisuite.fax_receive(self._handle, filename, progress)
         log('faxinfo: %s' % repr(faxInfo), 3)
         if not faxInfo:
             return FaxInfo()
         return FaxInfo(*faxInfo)
 
+    def fax_pages(self):
+        """
+        Get the page index of the fax currently or last received.
+
+        The index is built while the fax is received, so it can be
+        used e.g. in the progress function given to fax_receive().
+
+        Returns a list of tuples (offset, hiRes, width, lines), one
+        for each page: the position of the page in the SFF file, the
+        resolution (0=low, 1=high), the width in pixels and the number
+        of lines received so far.
+        """
+        return _capisuite.fax_pages(self._handle)
+
 
 class FaxInfo:
     def __init__(self, stationID='', rate=0, hiRes=0, format=0, numPages=0):
@@ -450,3 +646,31 @@ class FaxInfo:
 #    pass
 #def log(...):
 #    pass
+#def la2wav(infile, outfile=None):
+#    """convert A-Law file to WAV, return data if outfile isn't given"""
+#def la2pcm(data):
+#    """convert A-Law data to signed 16 bit little endian PCM"""
+#def sff2tiff(infile, outfile):
+#    """convert SFF file to TIFF Class F w/o decoding the fax lines"""
+#def sff2pdf(infile, outfile=None):
+#    """convert SFF file to PDF, return data if outfile isn't given"""
+#def cff2pdf(infile, outfile=None):
+#    """convert CFF file to PDF, return data if outfile isn't given"""
+#def sff_slice(infile, outfile, first_page):
+#    """copy SFF file starting with the given page (0 = first page)"""
+#def sff_pages(infile):
+#    """return the number of pages of SFF file"""
+#def schedule_job(job, user, time):
+#    """add job to the send schedule or change its send time"""
+#def unschedule_job(job):
+#    """remove job from the send schedule"""
+#def job_scheduled(job):
+#    """check if job is part of the send schedule"""
+#def due_jobs(time=None):
+#    """return and remove the due (job, user, time) tuples from the schedule"""
+#def watch_queue(dir):
+#    """start the idle script as soon as a new job is written to dir"""
+#def job_running(job):
+#    """check if job is currently sent by this capisuite process"""
+#def unique_number(dir, basename):
+#    """return the next number from the counter file of dir"""
@@ -18,17 +18,41 @@ the Free Software Foundation; either version 2 of the License, or
 (at your option) any later version.
 """
 
-import os, os.path, time, re, errno
+import os, os.path, stat, pwd, time, re, errno, threading, commands
 from types import ListType, TupleType
 
 # capisuite stuff
-import fileutils
+import fileutils, storage
 from capisuite.config import JobDescription, createDescriptionFor
 from capisuite.exceptions import InvalidJob, JobLockedError
 from capisuite.consts import *
 
+try:
+    from hashlib import sha1
+except ImportError:
+    from sha import new as sha1
+
 _job_pattern = re.compile("fax-([0-9]+)\.txt")
 
+# converted files not used by any job for this time are removed from the cache
+_cache_max_age = 24*60*60
+
+# times when the caches were cleaned last by updateSchedule(), referenced
+# by cache directory
+_cache_cleaned = {}
+
+# ghostscript arguments converting PostScript/PDF documents to SFF (see
+# ghostscriptCommand())
+_gs_args = ['-dSAFER', '-dNOPAUSE', '-dQUIET', '-dBATCH',
+            '-sPAPERSIZE=a4', '-sDEVICE=cfax']
+
+# cache_key of converters running ghostscriptCommand(), see _convertCached()
+ghostscript_cache_key = ' '.join(['gs'] + _gs_args)
+
+# claims of jobs not renewed for this time are taken back by the other
+# nodes (if option claim_timeout isn't given)
+_claim_timeout = 600
+
 ###---- Utility functions ---###
 
 def _userQ(config, user, Q):
@@ -38,6 +62,17 @@ def _userQ(config, user, Q):
     #    raise NoOptionError('', 'fax_user_dir')
     return os.path.abspath(os.path.join(userdir, user, Q))
 
+
+def ghostscriptCommand(infiles, faxname):
+    """
+    Return the shell command converting the PostScript/PDF files
+    'infiles' to the SFF file 'faxname'. Converters using it should set
+    their cache_key to ghostscript_cache_key.
+    """
+    return ' '.join(['gs'] + _gs_args +
+                    ['-sOutputFile=%s' % commands.mkarg(faxname).strip()] +
+                    [commands.mkarg(f).strip() for f in infiles])
+
     
 ###---- Job handling ---###
 
@@ -101,11 +136,96 @@ def enqueueJob(config, user, infiles, converter, **controlinfo):
     
     sendQ = _userQ(config, user, SEND_Q)
     jobnum, faxname = fileutils.uniqueName(sendQ, "fax", "sff")
-    converter(infiles, faxname)
+    _convertCached(config, user, infiles, converter, faxname)
     _createSendJob(user, faxname, **controlinfo)
+    controlinfo['filename'] = faxname
+    storage.getStorage(config, user).addItem(SEND_Q, jobnum, controlinfo)
     return jobnum
 
 
+def _convertCached(config, user, infiles, converter, faxname):
+    """
+    Call 'converter(infiles, faxname)' unless the same files were
+    converted before.
+
+    Converters having an attribute 'cache_key' (a string describing
+    the conversion parameters, e.g. ghostscript_cache_key) are cached:
+    the result is saved in the user's cache dir under a hash of the
+    cache_key and the contents of the infiles. If the same files are
+    enqueued again, the cached fax file is hardlinked to 'faxname'
+    instead of converting it again. Only regular files owned by the
+    user are taken from the cache.
+
+    Cached files which aren't linked to a job any more are removed
+    after _cache_max_age seconds by the idle script (see
+    updateSchedule()).
+    """
+    key = getattr(converter, 'cache_key', None)
+    if key is None:
+        converter(infiles, faxname)
+        return
+    try:
+        digest = sha1(key)
+        for infile in infiles:
+            digest.update('\0%i\0' % os.path.getsize(infile))
+            f = open(infile, 'rb')
+            try:
+                data = f.read(65536)
+                while data:
+                    digest.update(data)
+                    data = f.read(65536)
+            finally:
+                f.close()
+        uid = pwd.getpwnam(user).pw_uid
+        cacheQ = fileutils._mkuserdir(user, _userQ(config, user, ''),
+                                      CACHE_Q)
+    except (IOError, OSError, KeyError):
+        # no cache available, just convert
+        converter(infiles, faxname)
+        return
+    cachefile = os.path.join(cacheQ, "%s.sff" % digest.hexdigest())
+    try:
+        st = os.lstat(cachefile)
+        if not stat.S_ISREG(st.st_mode) or st.st_uid != uid:
+            raise OSError(errno.EPERM, "invalid cache entry", cachefile)
+        os.link(cachefile, faxname)
+        if os.lstat(faxname).st_ino != st.st_ino:
+            # replaced since checked
+            os.unlink(faxname)
+            raise OSError(errno.EPERM, "invalid cache entry", cachefile)
+        os.utime(cachefile, None) # remember when it was used last
+    except OSError:
+        converter(infiles, faxname)
+        if os.path.isfile(faxname) and os.path.getsize(faxname):
+            # publish atomically, so others never see a partial file
+            tmpfile = "%s.%i" % (cachefile, os.getpid())
+            try:
+                os.link(faxname, tmpfile)
+                os.rename(tmpfile, cachefile)
+            except OSError:
+                pass
+
+
+def _cleanCache(cacheQ):
+    """
+    Remove files from the cache which aren't used by any job and
+    weren't used for _cache_max_age seconds.
+    """
+    oldest = time.time() - _cache_max_age
+    try:
+        names = os.listdir(cacheQ)
+    except OSError:
+        return # no cache created yet
+    for filename in names:
+        filename = os.path.join(cacheQ, filename)
+        try:
+            st = os.lstat(filename)
+            if st.st_nlink == 1 and st.st_mtime < oldest:
+                os.unlink(filename)
+        except OSError:
+            pass
+
+
 def moveJob(controlfile, newdir, user=None):
     # todo: important: update 'filenmae' in job description!
     control = JobDescription(controlfile)
@@ -169,7 +289,177 @@ def abortUserJob(config, user, jobnum):
     sendQ = _userQ(config, user, SEND_Q)
     controlfile = fileutils.controlname(os.path.join(sendQ,
                                                      "fax-%03i" % jobnum))
+    if findClaim(config, user, jobnum):
+        # it's just being sent by one of the nodes
+        raise JobLockedError(None, controlfile)
     abortJob(controlfile)
+    storage.getStorage(config, user).removeItem(jobnum)
+
+
+###---- Job claims ---###
+
+def nodeName(config):
+    """
+    Return the name of this node (option node_name, defaults to the
+    host name).
+    """
+    name = ''
+    if config.has_option('GLOBAL', "node_name"):
+        name = config.get('GLOBAL', "node_name")
+    if not name:
+        name = os.uname()[1]
+    return name.replace('/', '_')
+
+
+def _claimQ(config, user, node):
+    return fileutils._mkuserdir(user, _userQ(config, user, SEND_Q),
+                                CLAIMED_DIR, node)
+
+
+def claimJob(config, user, controlfile):
+    """
+    Claim the job 'controlfile' of the send queue for this node.
+
+    Several nodes may share one spool dir (e.g. via NFS), where the
+    locks of one host don't keep the others off. So the controlfile is
+    renamed to the node's directory below sendq/claimed, which is
+    atomic even there: only one node can succeed. The claim is a lease
+    which is renewed by the sender (see ClaimRenewal) and taken back by
+    the other nodes if it isn't renewed for claim_timeout seconds.
+
+    Returns the path of the claimed controlfile or None if the job was
+    claimed by another node or removed.
+    """
+    claimfile = os.path.join(_claimQ(config, user, nodeName(config)),
+                             os.path.basename(controlfile))
+    try:
+        # the mtime is the start of the lease and kept by rename
+        os.utime(controlfile, None)
+        os.rename(controlfile, claimfile)
+    except OSError, err:
+        if err.errno == errno.ENOENT:
+            return None
+        raise
+    os.utime(claimfile, None)
+    return claimfile
+
+
+def _claimTimeout(config):
+    if config.has_option('GLOBAL', "claim_timeout"):
+        return config.getint('GLOBAL', "claim_timeout")
+    return _claim_timeout
+
+
+class ClaimRenewal:
+    """
+    Renew a claim taken by claimJob() while the job is sent.
+
+    A transmission can take longer than claim_timeout, so the claim is
+    renewed by a thread every third of the timeout until stop() is
+    called. stop() must be called before the script ends.
+    """
+
+    def __init__(self, config, claimfile):
+        self.claimfile = claimfile
+        self.interval = max(1, _claimTimeout(config) / 3)
+        self._stopped = threading.Event()
+        self._thread = threading.Thread(target=self._run)
+        self._thread.setDaemon(1)
+        self._thread.start()
+
+    def _run(self):
+        while 1:
+            self._stopped.wait(self.interval)
+            if self._stopped.isSet():
+                break
+            try:
+                os.utime(self.claimfile, None)
+            except OSError:
+                break # released or finished
+
+    def stop(self):
+        self._stopped.set()
+        self._thread.join()
+
+
+def releaseJob(claimfile, controlfile):
+    """
+    Put a job claimed by claimJob() back to the send queue.
+
+    Nothing is done if the job isn't claimed any more (e.g. because it
+    was moved to the done or failed queue).
+    """
+    try:
+        os.rename(claimfile, controlfile)
+    except OSError, err:
+        if err.errno != errno.ENOENT:
+            raise
+
+
+def findClaim(config, user, jobnum):
+    """
+    Return a tuple (node, claimfile) if job 'jobnum' is claimed by
+    one of the nodes, None otherwise.
+    """
+    claimQ = os.path.join(_userQ(config, user, SEND_Q), CLAIMED_DIR)
+    try:
+        nodes = os.listdir(claimQ)
+    except OSError:
+        return None
+    for node in nodes:
+        claimfile = os.path.join(claimQ, node, "fax-%03i.txt" % jobnum)
+        if os.path.exists(claimfile):
+            return node, claimfile
+    return None
+
+
+def renewClaims(config, user):
+    """
+    Renew the claims of this node on the jobs of the user which are
+    being sent (their senders renew them, too, see ClaimRenewal) and
+    take back all other claims which have expired.
+
+    Claims of this node whose jobs aren't sent any more are left over
+    from a crash and are released at once. The age of the claims is
+    measured with the clock of the file server, so the clocks of the
+    nodes needn't be synchronized.
+
+    This can only be used within capisuite.
+    """
+    import capisuite.core as core
+
+    timeout = _claimTimeout(config)
+    sendQ = _userQ(config, user, SEND_Q)
+    node = nodeName(config)
+    ownQ = _claimQ(config, user, node)
+    os.utime(ownQ, None)
+    now = os.stat(ownQ).st_mtime
+    claimQ = os.path.dirname(ownQ)
+    for claimer in os.listdir(claimQ):
+        try:
+            names = os.listdir(os.path.join(claimQ, claimer))
+        except OSError:
+            continue
+        for name in names:
+            if not _job_pattern.match(name):
+                continue
+            claimfile = os.path.join(claimQ, claimer, name)
+            controlfile = os.path.join(sendQ, name)
+            try:
+                if claimer == node:
+                    if core.job_running(controlfile):
+                        os.utime(claimfile, None)
+                        continue
+                    core.log("releasing stale claim of job %s" %
+                             controlfile, 1)
+                elif now - os.stat(claimfile).st_mtime > timeout:
+                    core.log("claim of node %s on job %s expired" %
+                             (claimer, controlfile), 1)
+                else:
+                    continue
+                releaseJob(claimfile, controlfile)
+            except OSError:
+                pass # released or finished meanwhile
 
 
 
@@ -180,14 +470,61 @@ def getQueueFiles(config, user):
     Generate a list of all fax jobs in the send queue.
 
     Result is a list of (job-number, controlfile) tuples, where
-    'controlfile' is an absolut paht.
+    'controlfile' is an absolut paht. The jobs are ordered by their
+    start time. They're taken from the job index (see
+    capisuite.storage), so the queue directory isn't read.
     """
-    sendQ = _userQ(config, user, SEND_Q)
-    for filename in os.listdir(sendQ):
-        m = _job_pattern.match(filename)
-        if m:
-            yield (int(m.group(1)), # job number
-                   os.path.join(sendQ, filename))
+    jobs = storage.getStorage(config, user)
+    for jobnum in jobs.listItems(SEND_Q):
+        yield (jobnum, jobs.getControlfile(jobnum))
+
+def getStartTime(control):
+    """
+    Return the time (seconds since the epoch) at which the job
+    described by 'control' is due.
+    """
+    # set DST value to -1 (unknown), as strptime sets it wrong
+    # for some reason
+    starttime = time.strptime(control.get("starttime"))[:-1]+(-1, )
+    return time.mktime(starttime)
+
+
+def updateSchedule(config, user):
+    """
+    Add the new jobs of the user's send queue to the send schedule.
+
+    Only the jobs added to the job index since the last call are looked
+    at (see capisuite.storage.FileStorage.newItems()), so the first call
+    puts all jobs to the schedule and later calls are cheap. The start
+    times are taken from the index, so no control files are read. The
+    queue is also watched for new jobs, so the idle script is started as soon as
+    one is written. The job index of the user is maintained, too (see
+    capisuite.storage.FileStorage.maintain()), and the cache of
+    converted documents is cleaned once an hour (see _convertCached()).
+
+    This can only be used within capisuite.
+    """
+    import capisuite.core as core
+
+    core.watch_queue(_userQ(config, user, SEND_Q))
+    jobs = storage.getStorage(config, user)
+    jobs.maintain()
+    cacheQ = _userQ(config, user, CACHE_Q)
+    now = time.time()
+    if now - _cache_cleaned.get(cacheQ, 0) > _cache_max_age / 24:
+        _cleanCache(cacheQ)
+        _cache_cleaned[cacheQ] = now
+    for jobnum in jobs.newItems():
+        controlfile = jobs.getControlfile(jobnum)
+        jobDesc = jobs.getDescription(jobnum)
+        if controlfile is None or core.job_scheduled(controlfile):
+            continue
+        try:
+            starttime = getStartTime(jobDesc)
+        except (TypeError, ValueError):
+            continue # the description is broken, the job can't be sent
+        core.schedule_job(controlfile, user, starttime)
+
 
 def getQueue(config, user):
     """
@@ -195,11 +532,14 @@ def getQueue(config, user):
 
     Result is a list of (job-number, description) tuples, where
     'description' is the content of the job's controlfile as a
-    dictionary.
+    dictionary. It's taken from the job index, so the controlfiles
+    aren't read.
     """
-    for num, controlfile in getQueueFiles(config, user):
-        jobDesc = JobDescription(controlfile).items()
-        yield (num, jobDesc)
+    jobs = storage.getStorage(config, user)
+    for num in jobs.listItems(SEND_Q):
+        jobDesc = jobs.getDescription(num)
+        if jobDesc is not None:
+            yield (num, jobDesc)
 
 
 def getQueueDetails(config, user):
@@ -227,16 +567,33 @@ def getQueueDetails(config, user):
 
 ###--- Send/Receive Fax ---###
 
+def sendControllers(config):
+    """
+    Return the list of controllers to send faxes with (global option
+    send_controller, a comma separated list). An empty list or 0
+    stands for all controllers.
+    """
+    if not config.has_option('GLOBAL', "send_controller"):
+        return [1]
+    return [int(c) for c in config.getList('GLOBAL', "send_controller")
+            if c and int(c)]
+
+
 def sendfax(config, user, capi, faxfile,
-            outgoing_num, dialstring, stationID=None, headline=None):
+            outgoing_num, dialstring, stationID=None, headline=None,
+            controller=None):
     """
     Send a fax out via the capi.
 
+    If no controller is given, the least loaded controller of the
+    global option send_controller is used.
+
     Returns a tuple ((result, resultB3), faxinfo)
     """
     import capisuite.core as core
 
-    controller = config.getint('GLOBAL', "send_controller")
+    if not controller:
+        controller = sendControllers(config)
     timeout = int(config.getUser(user, "outgoing_timeout"))
 
     # get defaults for stationID and headline from config
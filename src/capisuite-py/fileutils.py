@@ -15,7 +15,7 @@ the Free Software Foundation; either version 2 of the License, or
 (at your option) any later version.
 """
 
-import fcntl, os, re, errno
+import fcntl, os, re, errno, struct
 from types import IntType
 
 import capisuite.core as core
@@ -121,17 +121,68 @@ def writeCounter(count, *fileparts):
 
 ###--- ... ---###
 
-def __makeCountedFilePattern(basename, suffix):
-    # todo: group should be digits only
-    return re.compile("%s-([0-9]+)\.%s" % (re.escape(basename),
-                                           re.escape(suffix)))
+# layout of the counter files (magic, next number), see JobCounter
+_counter_format = "=II"
+_counter_magic = 0x43534e31
+
+def __makeCountedFilePattern(basename):
+    return re.compile("%s-([0-9]+)\." % re.escape(basename))
+
+def _firstFree(directory, basename):
+    numbers = [readCounter(1, "%s-nextnr" % os.path.join(directory, basename))]
+    pattern = __makeCountedFilePattern(basename)
+    for f in os.listdir(directory):
+        m = pattern.match(f)
+        if m:
+            numbers.append(int(m.group(1))+1)
+    return max(numbers)
+
+def _nextNumber(directory, basename):
+    """
+    Take the next number from the counter file without the help of
+    capisuite.
+
+    This is used by tools running outside of capisuite (like
+    capisuitefax). The counter is read and rewritten under a lockf()
+    lock on the counter file and synced to disk before the number is
+    returned, exactly like JobCounter does it.
+    """
+    name = "%s-counter" % os.path.join(directory, basename)
+    nextnr = "%s-nextnr" % os.path.join(directory, basename)
+    size = struct.calcsize(_counter_format)
+    fd = os.open(name, os.O_RDWR|os.O_CREAT, 0600)
+    try:
+        fcntl.lockf(fd, fcntl.LOCK_EX)
+        data = os.read(fd, size)
+        if len(data) < size:
+            magic, nextnum = _counter_magic, _firstFree(directory, basename)
+        else:
+            magic, nextnum = struct.unpack(_counter_format, data)
+            if magic != _counter_magic:
+                raise IOError("counter file %s is corrupt" % name)
+        os.lseek(fd, 0, 0)
+        os.write(fd, struct.pack(_counter_format, magic, nextnum+1))
+        # the number must be on disk before its file is created,
+        # otherwise it's handed out again after a crash
+        if len(data) < size:
+            os.fsync(fd)
+            if os.path.exists(nextnr):
+                os.unlink(nextnr) # not used any more
+        else:
+            os.fdatasync(fd)
+    finally:
+        os.close(fd) # releases the lock, too
+    return nextnum
 
 # @brief thread-safe creation of a unique filename in a directory
 #
-# This function reads the nextnumber from then "nextnr"-file in the given
-# directory and updates it. It holds the next free file number.
+# This function takes the next free file number from the counter file
+# "basename-counter" in the given directory. Within capisuite, this is
+# done by core.unique_number(), outside by _nextNumber(). Both lock the
+# counter file, so they can be used at the same time.
 #
-# If nextnr doesn't exist, it's created.
+# If the counter file doesn't exist, it's created and initialized with
+# the number following the highest one found in the directory.
 #
 # The filenames created will have the format
 #
@@ -143,26 +194,10 @@ def __makeCountedFilePattern(basename, suffix):
 #
 # @return job number, new file name
 def uniqueName(directory, basename, suffix):
-    nextfile = "%s-nextnr" % os.path.join(directory, basename)
-    lock = _getLock(os.path.join(directory,"cs_lock"), blocking=1)
-    try:
-        nextnum = readCounter(-10, nextfile)
-        if nextnum < 0:
-            # search for next free sequence number
-            pattern = __makeCountedFilePattern(basename, suffix)
-            numbers = [0]
-            for f in os.listdir(directory):
-                m = pattern.match(f)
-                if m:
-                    numbers.append(int(m.group(1)))
-            # take number of last file and increase it by one
-            nextnum = max(numbers)+1 
-        writeCounter(nextnum+1, nextfile)
-    except:
-        _releaseLock(lock)
-        raise
+    if hasattr(core, 'unique_number'):
+        nextnum = core.unique_number(directory, basename)
     else:
-        _releaseLock(lock)
+        nextnum = _nextNumber(directory, basename)
     newname = "%s-%03i.%s" % (os.path.join(directory,basename),
                               nextnum, suffix)
     return nextnum, newname
@@ -0,0 +1,364 @@
+"""capisuite.jobsocket
+
+Job submission and control over the local socket of the capisuite daemon.
+
+The daemon listens on a unix domain socket (option job_socket in
+capisuite.conf) and calls jobRequest() of the idle script for each
+connection, which uses serve() to handle the requests. New jobs are put
+to the send schedule at once, so they don't have to wait for the idle
+script to find them in the spool.
+
+Each request is one line consisting of a command and its arguments,
+separated by spaces. All arguments are quoted with urllib.quote().
+Each reply starts with a line 'OK [<result>]' or 'ERROR <message>'.
+Replies containing data are followed by lines of quoted fields
+separated by tabs.
+
+  USER <user>
+        handle the following requests for another user (root only)
+  ENQUEUE <size> <dialstring> [<option>=<value> ...]
+        followed by <size> bytes of PostScript or PDF data, replies
+        'OK <jobnum>'; options are addressee, subject, starttime
+        (seconds since the epoch) and noprefix=1
+  CANCEL <jobnum>
+        abort the job
+  LIST
+        replies 'OK <count>' followed by a line with the fields job
+        number, addressee or dialstring, tries, starttime and subject
+        for each job
+  QUERY <jobnum>
+        replies 'OK <count>' followed by a line with option and value
+        for each entry of the job description, its state and the node
+        sending it
+  QUIT
+        close the connection
+
+Use JobClient to talk to the daemon.
+
+The daemon runs as root, but the documents are converted and the job
+files are created by capisuitefax running with the rights of the job's
+owner, so nobody gets more access to the system by submitting a
+document than by calling capisuitefax.
+"""
+
+__author__    = "agent <agent@local>"
+__copyright__ = "Copyright (c) 2026 by agent"
+__credits__   = "This file is part of www.capisuite.de"
+__license__ = """
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+"""
+
+import os, pwd, grp, time, string, signal, socket, urllib
+
+# capisuite stuff
+import fax, capisuite.config
+from capisuite.config import JobDescription
+from capisuite.exceptions import Error
+from capisuite.consts import *
+
+# documents bigger than this are refused
+_max_size = 64*1024*1024
+
+
+class RequestError(Exception):
+    pass
+
+
+def _controlfile(config, user, jobnum):
+    return os.path.join(fax._userQ(config, user, SEND_Q), "fax-%03i.txt" % jobnum)
+
+
+def _checkUser(config, user):
+    if not config.has_section(user):
+        raise RequestError("%s is no valid user for CapiSuite" % user)
+    if not config.has_option(user, "outgoing_MSN") and \
+       not config.has_option(user, "fax_numbers"):
+        raise RequestError("%s is not allowed to use fax services" % user)
+
+
+def _userIds(user):
+    """
+    Return uid, gid and the supplementary groups of 'user'.
+    """
+    pw = pwd.getpwnam(user)
+    groups = [g.gr_gid for g in grp.getgrall() if user in g.gr_mem]
+    if pw.pw_gid not in groups:
+        groups.insert(0, pw.pw_gid)
+    return pw.pw_uid, pw.pw_gid, groups
+
+
+def _spawnFax(user, args):
+    """
+    Execute capisuitefax with the arguments 'args' and the rights of
+    'user'. Returns its pid, a descriptor to write to its stdin and one
+    to read its output (stdout and stderr) from.
+
+    The daemon has several threads whose locks (e.g. of libc or of the
+    core of capisuite) may be held by another thread when forking. So
+    the child only takes the rights of the user and executes
+    capisuitefax at once. The user database is read before forking.
+    """
+    if os.geteuid() == 0:
+        ids = _userIds(user)
+    elif pwd.getpwuid(os.geteuid()).pw_name == user:
+        ids = None
+    else:
+        raise RequestError("capisuite can't create jobs for %s" % user)
+    program = os.path.join(capisuite.config.pkgbindir, 'capisuitefax')
+    argv = [program] + args
+    inread, inwrite = os.pipe()
+    outread, outwrite = os.pipe()
+    pid = os.fork()
+    if not pid:
+        try:
+            os.dup2(inread, 0)
+            os.dup2(outwrite, 1)
+            os.dup2(outwrite, 2)
+            for fd in (inread, inwrite, outread, outwrite):
+                if fd > 2:
+                    os.close(fd)
+            if ids:
+                os.setgroups(ids[2])
+                os.setgid(ids[1])
+                os.setuid(ids[0])
+            os.execv(program, argv)
+        finally:
+            os._exit(127)
+    os.close(inread)
+    os.close(outwrite)
+    return pid, inwrite, outread
+
+
+def _enqueue(config, user, rfile, size, dialstring, **options):
+    import capisuite.core as core
+
+    _checkUser(config, user)
+    dialstring = dialstring.translate(string.maketrans("", ""), "-/ ()")
+    for i in dialstring:
+        if not i in '+0123456789*#':
+            raise RequestError("invalid character %r in dialstring" % i)
+    if not options.has_key('noprefix'):
+        dialstring = config.getUser(user, "dial_prefix", '') + dialstring
+    starttime = time.time()
+    if options.has_key('starttime'):
+        starttime = float(options['starttime'])
+
+    data = rfile.read(min(size, 65536))
+    if not data.startswith('%!') and not data.startswith('%PDF-'):
+        raise RequestError("document is no PostScript/PDF file")
+    pid, docfd, resultfd = _spawnFax(user, [
+        '--stdin', '--noprefix', '--dialstring=' + dialstring,
+        '--addressee=' + options.get('addressee', ''),
+        '--subject=' + options.get('subject', ''),
+        '--starttime=%f' % starttime])
+    try:
+        try:
+            while 1:
+                size -= len(data)
+                while data:
+                    data = data[os.write(docfd, data):]
+                if size <= 0:
+                    break
+                data = rfile.read(min(size, 65536))
+                if not data:
+                    # don't let capisuitefax enqueue the partial document
+                    os.kill(pid, signal.SIGKILL)
+                    raise RequestError("connection closed while reading document")
+        except OSError:
+            pass # capisuitefax failed, its output tells why
+    finally:
+        os.close(docfd)
+        output = ''
+        data = os.read(resultfd, 4096)
+        while data:
+            output += data
+            data = os.read(resultfd, 4096)
+        os.close(resultfd)
+        os.waitpid(pid, 0)
+    lines = output.strip().splitlines()
+    if not lines or not lines[-1].startswith('OK '):
+        raise RequestError(' '.join(lines) or "creating the job failed")
+    jobnum = int(lines[-1][3:])
+    core.schedule_job(_controlfile(config, user, jobnum), user, starttime)
+    return jobnum
+
+
+def _cancel(config, user, jobnum):
+    import capisuite.core as core
+
+    controlfile = _controlfile(config, user, jobnum)
+    if core.job_running(controlfile):
+        raise RequestError("job %i is currently in transmission" % jobnum)
+    try:
+        fax.abortUserJob(config, user, jobnum)
+    except fax.InvalidJob:
+        raise RequestError("job %i is not valid" % jobnum)
+    except fax.JobLockedError:
+        raise RequestError("job %i is currently in transmission" % jobnum)
+    core.unschedule_job(controlfile)
+
+
+def _query(config, user, jobnum):
+    import capisuite.core as core
+
+    controlfile = _controlfile(config, user, jobnum)
+    claim = None
+    if not os.access(controlfile, os.R_OK):
+        claim = fax.findClaim(config, user, jobnum)
+        if not claim:
+            raise RequestError("job %i is not valid" % jobnum)
+        controlfile = claim[1]
+    items = dict(JobDescription(controlfile).items()).items()
+    if claim:
+        # being sent by this or another node sharing the spool
+        items.append(('state', 'sending'))
+        items.append(('node', claim[0]))
+    elif core.job_running(controlfile):
+        items.append(('state', 'sending'))
+    elif core.job_scheduled(controlfile):
+        items.append(('state', 'scheduled'))
+    else:
+        items.append(('state', 'waiting'))
+    return items
+
+
+def serve(config, sock, user):
+    """
+    Handle all requests on the connected socket 'sock' until the
+    connection is closed.
+
+    'user' is the user who opened the connection. The daemon determines
+    it from the credentials of the connected process.
+    """
+    import capisuite.core as core
+
+    rfile = sock.makefile('rb')
+    wfile = sock.makefile('wb', 0)
+    peer = user
+    while 1:
+        line = rfile.readline()
+        if not line:
+            break
+        words = map(urllib.unquote, line.split())
+        if not words:
+            continue
+        command, args = words[0].upper(), words[1:]
+        reply, result = '', []
+        try:
+            if command == 'QUIT':
+                break
+            elif command == 'USER' and len(args) == 1:
+                if peer != 'root':
+                    raise RequestError("only root may act for other users")
+                _checkUser(config, args[0])
+                user = args[0]
+            elif command == 'ENQUEUE' and len(args) >= 2:
+                size = int(args[0])
+                if size < 0 or size > _max_size:
+                    raise RequestError("invalid document size %i" % size)
+                options = {}
+                for opt in args[2:]:
+                    key, value = opt.split('=', 1)
+                    options[key] = value
+                jobnum = _enqueue(config, user, rfile, size, args[1],
+                                  **options)
+                core.log("job %i of %s enqueued via job socket" %
+                         (jobnum, user), 2)
+                reply = str(jobnum)
+            elif command == 'CANCEL' and len(args) == 1:
+                _cancel(config, user, int(args[0]))
+            elif command == 'LIST' and not args:
+                result = fax.getQueueDetails(config, user)
+                reply = str(len(result))
+            elif command == 'QUERY' and len(args) == 1:
+                result = _query(config, user, int(args[0]))
+                reply = str(len(result))
+            else:
+                raise RequestError("invalid request %s" % command)
+        except (RequestError, Error, EnvironmentError, ValueError,
+                KeyError), err:
+            wfile.write("ERROR %s\n" % urllib.quote(str(err)))
+            if command == 'ENQUEUE':
+                # the rest of the document can't be told apart from
+                # the next request
+                break
+            continue
+        wfile.write(("OK %s" % reply).strip() + "\n")
+        for fields in result:
+            wfile.write('\t'.join([urllib.quote(str(f)) for f in fields])
+                        + "\n")
+
+
+class JobClient:
+    """
+    Client for the job socket of a running capisuite daemon.
+
+    All methods raise RequestError if the daemon refuses the request.
+    """
+    def __init__(self, socketname):
+        self._sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        self._sock.connect(socketname)
+        self._rfile = self._sock.makefile('rb')
+        self._wfile = self._sock.makefile('wb', 0)
+
+    def _request(self, command, args=(), data=None):
+        request = ' '.join([command] + [urllib.quote(str(a)) for a in args])
+        self._wfile.write(request + "\n")
+        if data:
+            self._wfile.write(data)
+        line = self._rfile.readline()
+        if not line:
+            raise RequestError("connection closed by capisuite")
+        status, reply = (line.rstrip('\n').split(' ', 1) + [''])[:2]
+        if status != 'OK':
+            raise RequestError(urllib.unquote(reply))
+        return reply
+
+    def _readLines(self, count):
+        return [map(urllib.unquote, self._rfile.readline().rstrip('\n').split('\t'))
+                for i in range(int(count))]
+
+    def close(self):
+        try:
+            self._request('QUIT')
+        except (RequestError, socket.error):
+            pass
+        self._sock.close()
+
+    def setUser(self, user):
+        """act for another user (only allowed for root)"""
+        self._request('USER', (user,))
+
+    def enqueue(self, dialstring, data, **options):
+        """
+        Send the PostScript/PDF document 'data' to 'dialstring'.
+
+        options may be addressee, subject, starttime (seconds since the
+        epoch) and noprefix.
+
+        Returns the job number.
+        """
+        args = [len(data), dialstring]
+        args.extend(["%s=%s" % item for item in options.items()])
+        return int(self._request('ENQUEUE', args, data))
+
+    def cancel(self, jobnum):
+        self._request('CANCEL', (jobnum,))
+
+    def list(self):
+        """
+        Returns a list of (job-num, addressee/dialstring, tries,
+        starttime, subject) tuples.
+        """
+        return [tuple(job) for job in self._readLines(self._request('LIST'))]
+
+    def query(self, jobnum):
+        """
+        Returns the job description and its state ('sending',
+        'scheduled' or 'waiting') as dictionary.
+        """
+        return dict([tuple(item) for item in
+                     self._readLines(self._request('QUERY', (jobnum,)))])
@@ -1,6 +1,25 @@
 """capisuite.storage
 
 This module implements routines for file storage and queue management.
+
+FileStorage keeps an index of the fax jobs of one user, so the queues
+can be listed w/o reading the directories and all control files. The
+index is kept in memory and persisted in an append-only journal in the
+user's directory. All processes using the storage (capisuite and
+capisuitefax) append their changes to the journal and read the changes
+of the others from it. The journal is only read when the index is
+needed, so scripts which just record changes (like sending a job) don't
+have to read it.
+
+Several nodes may share the user's directory via NFS (see
+fax.claimJob()). Appending with O_APPEND isn't atomic between NFS
+clients, so records are only appended while holding the lock of the
+journal. On NFS, Linux emulates flock() with a fcntl() lock of the
+whole file at the NFS server, which also makes the client revalidate
+the size of the journal before writing. Such a lock belongs to the
+process, so the threads of capisuite are excluded from each other by
+core.process_lock() in addition. The NFS lock manager must run on all
+nodes.
 """
 
 __author__    = "Gernot Hillier <gernot@hillier.de>"
@@ -14,6 +33,27 @@ the Free Software Foundation; either version 2 of the License, or
 (at your option) any later version.
 """
 
+import os, re, time, bisect, urllib, cgi, tempfile, fcntl, threading
+
+# capisuite stuff
+import fileutils
+import capisuite.core as core
+from capisuite.consts import *
+
+# name of the journal and its lock file in the user's directory
+_journal_name = "fax-jobs.journal"
+_lock_name = "fax-jobs.lock"
+
+_job_pattern = re.compile("fax-([0-9]+)\.txt")
+
+# the journal is rewritten when it has more records than this factor
+# times the number of items
+_compact_factor = 4
+
+# excludes the threads from each other outside of capisuite, which has
+# core.process_lock() instead (see FileStorage._lock())
+_thread_lock = threading.Lock()
+
 
 class ItemStorage:
     """
@@ -83,5 +123,446 @@ class FileStorage(ItemStorage):
     """
     Default implementation of an ItemStorage which stores all
     messages as files on the local filesystem.
+
+    One instance handles the fax jobs of one user. The job files stay
+    where they always were (the user's sendq and the global done and
+    failed dirs). Each job is identified by its job number.
+
+    The index holds the queue and the description of each job. For each
+    queue, the jobs are also kept sorted by their start time, so the due
+    jobs are found w/o looking at all jobs.
+
+    Each change is appended to the journal as one line ending with a
+    dot, so lines torn by a crash can be detected and are skipped. The
+    journal is read when the index is used for the first time. If the
+    journal is missing, it's rebuilt from the directories. The idle
+    script calls maintain() regularly, which compares the sendq with the
+    index once (only its directory listing is read) to take over changes
+    made w/o the storage, and compacts the journal.
+    """
+
+    def __init__(self, config, user):
+        ItemStorage.__init__(self, config)
+        self.user = user
+        userdir = os.path.join(config.get('GLOBAL', "fax_user_dir"), user)
+        spool = config.get('GLOBAL', "spool_dir")
+        self._dirs = {SEND_Q: os.path.abspath(os.path.join(userdir, SEND_Q)),
+                      DONE_Q: os.path.abspath(os.path.join(spool, DONE_Q)),
+                      FAILED_Q: os.path.abspath(os.path.join(spool, FAILED_Q))}
+        self._journal = os.path.join(userdir, _journal_name)
+        self._lockfile = os.path.join(userdir, _lock_name)
+        self._checked = 0
+        self._reset()
+        if not os.path.exists(self._journal):
+            self.recover()
+
+    ###--- journal handling ---###
+
+    def _reset(self):
+        self._items = {}   # id -> [queue, description]
+        self._sorted = {}  # queue -> sorted list of (starttime, id)
+        self._offset = 0
+        self._inode = None
+        self._records = 0
+        self._added = {}   # ids added to the sendq, see newItems()
+
+    def _sync(self):
+        """
+        Read the changes appended to the journal since the last call.
+        """
+        try:
+            st = os.stat(self._journal)
+        except OSError:
+            return
+        if st.st_ino != self._inode or st.st_size < self._offset:
+            # the journal was rewritten
+            self._reset()
+            self._inode = st.st_ino
+        if st.st_size == self._offset:
+            return
+        journal = open(self._journal)
+        journal.seek(self._offset)
+        data = journal.read()
+        journal.close()
+        end = data.rfind('\n') + 1
+        for line in data[:end].splitlines():
+            self._replay(line)
+        self._offset += end
+
+    def _replay(self, line):
+        try:
+            op, id, queue, desc, end = line.split('\t')
+            if end != '.':
+                raise ValueError
+            id = int(id)
+            desc = dict(cgi.parse_qsl(desc, keep_blank_values=1))
+        except ValueError:
+            return # ignore corrupt records
+        self._records += 1
+        if op == 'add':
+            self._remove(id)
+            self._insert(id, queue, desc)
+            if queue == SEND_Q:
+                self._added[id] = 1
+            elif self._added.has_key(id):
+                del self._added[id]
+        elif op == 'update' and self._items.has_key(id):
+            queue, old = self._items[id]
+            self._remove(id)
+            old.update(desc)
+            self._insert(id, queue, old)
+        elif op == 'remove':
+            self._remove(id)
+            if self._added.has_key(id):
+                del self._added[id]
+
+    def _lock(self):
+        """
+        Take the lock of the journal, returns the descriptor to pass to
+        _unlock().
+
+        The lock file is locked with flock(). Locally, its locks belong
+        to the opened file, but on NFS Linux emulates them with fcntl()
+        locks, which belong to the process and need a file opened for
+        writing. So the threads are excluded from each other by a lock
+        of the process first: core.process_lock() within capisuite, as
+        each script has its own interpreter, otherwise _thread_lock.
+        The lock file isn't removed.
+        """
+        if hasattr(core, 'process_lock'):
+            core.process_lock(self._lockfile)
+        else:
+            _thread_lock.acquire()
+        try:
+            new = not os.path.exists(self._lockfile)
+            fd = os.open(self._lockfile, os.O_RDWR|os.O_CREAT, 0600)
+            try:
+                if new:
+                    fileutils._setProtection(self.user, 0600, self._lockfile)
+                fcntl.flock(fd, fcntl.LOCK_EX)
+            except:
+                os.close(fd)
+                raise
+        except:
+            self._unlockProcess()
+            raise
+        return fd
+
+    def _unlock(self, fd):
+        os.close(fd) # releases the lock, too
+        self._unlockProcess()
+
+    def _unlockProcess(self):
+        if hasattr(core, 'process_unlock'):
+            core.process_unlock(self._lockfile)
+        else:
+            _thread_lock.release()
+
+    def _write(self, data):
+        """
+        Append complete records to the journal. Returns the inode of
+        the journal written to.
+        """
+        new = not os.path.exists(self._journal)
+        fd = os.open(self._journal, os.O_RDWR|os.O_APPEND|os.O_CREAT, 0600)
+        try:
+            size = os.fstat(fd).st_size
+            if size:
+                os.lseek(fd, size-1, 0)
+                if os.read(fd, 1) != '\n':
+                    # the last record was torn by a crash, terminate it
+                    # so it's skipped
+                    data = "\n" + data
+            os.write(fd, data)
+            inode = os.fstat(fd).st_ino
+        finally:
+            os.close(fd)
+        if new:
+            fileutils._setProtection(self.user, 0600, self._journal)
+        return inode
+
+    def _append(self, op, id, queue='', desc={}):
+        """
+        Append a record to the journal.
+
+        The lock keeps others from compacting the journal meanwhile. If
+        the journal was replaced nevertheless (e.g. because the lock
+        doesn't work on the filesystem), the record is written again.
+        Replaying a record twice doesn't harm.
+        """
+        items = desc.items()
+        items.sort()
+        line = "%s\t%i\t%s\t%s\t.\n" % (op, id, queue, urllib.urlencode(items))
+        lock = self._lock()
+        try:
+            while 1:
+                inode = self._write(line)
+                try:
+                    if os.stat(self._journal).st_ino == inode:
+                        break
+                except OSError:
+                    pass
+        finally:
+            self._unlock(lock)
+        if self._inode is not None:
+            self._sync()
+
+    def _compact(self):
+        """
+        Rewrite the journal with one record for each item.
+        """
+        lock = self._lock()
+        try:
+            self._sync()
+            fd, tmpname = tempfile.mkstemp('.new', _journal_name + '.',
+                                           os.path.dirname(self._journal))
+            journal = os.fdopen(fd, 'w')
+            ids = self._items.keys()
+            ids.sort()
+            for id in ids:
+                queue, desc = self._items[id]
+                items = desc.items()
+                items.sort()
+                journal.write("add\t%i\t%s\t%s\t.\n" %
+                              (id, queue, urllib.urlencode(items)))
+            journal.close()
+            fileutils._setProtection(self.user, 0600, tmpname)
+            os.rename(tmpname, self._journal)
+        finally:
+            self._unlock(lock)
+        self._reset()
+        self._sync()
+
+    ###--- index handling ---###
+
+    def _key(self, queue, id, desc):
+        if queue == SEND_Q:
+            try:
+                # set DST value to -1 (unknown), as strptime sets it
+                # wrong for some reason
+                starttime = time.strptime(desc['starttime'])[:-1]+(-1, )
+                return (time.mktime(starttime), id)
+            except (KeyError, ValueError):
+                pass
+        return (0, id)
+
+    def _insert(self, id, queue, desc):
+        self._items[id] = [queue, desc]
+        bisect.insort(self._sorted.setdefault(queue, []),
+                      self._key(queue, id, desc))
+
+    def _remove(self, id):
+        if not self._items.has_key(id):
+            return
+        queue, desc = self._items.pop(id)
+        entries = self._sorted[queue]
+        i = bisect.bisect_left(entries, self._key(queue, id, desc))
+        if i < len(entries) and entries[i][1] == id:
+            del entries[i]
+
+    def _controlfile(self, queue, id):
+        name = "fax-%03i.txt" % id
+        if queue != SEND_Q:
+            name = "%s-%s" % (self.user, name)
+        return os.path.join(self._dirs[queue], name)
+
+    def _readItem(self, controlfile):
+        from capisuite.config import JobDescription
+        return dict(JobDescription(controlfile).items())
+
+    def _scan(self, queue):
+        """
+        Return a dictionary id -> controlfile of the jobs in the
+        directory of 'queue'. The jobs of the sendq claimed by one of
+        the nodes (see fax.claimJob()) are included.
+        """
+        prefix = ''
+        dirs = [self._dirs[queue]]
+        if queue != SEND_Q:
+            prefix = self.user + '-'
+        else:
+            claimQ = os.path.join(self._dirs[queue], CLAIMED_DIR)
+            if os.path.isdir(claimQ):
+                dirs.extend([os.path.join(claimQ, node)
+                             for node in os.listdir(claimQ)])
+        result = {}
+        for dir in dirs:
+            try:
+                names = os.listdir(dir)
+            except OSError:
+                continue
+            for name in names:
+                if not name.startswith(prefix):
+                    continue
+                m = _job_pattern.match(name[len(prefix):])
+                if m:
+                    result[int(m.group(1))] = os.path.join(dir, name)
+        return result
+
+    def _check(self):
+        """
+        Take over changes of the sendq made w/o the storage (e.g. by
+        older versions or jobs lost by a crash).
+        """
+        jobs = self._scan(SEND_Q)
+        for id, controlfile in jobs.items():
+            if not self._items.has_key(id) or \
+               self._items[id][0] != SEND_Q:
+                try:
+                    self._append('add', id, SEND_Q,
+                                 self._readItem(controlfile))
+                except EnvironmentError:
+                    pass # just being created or removed
+        for id in self.listItems(SEND_Q):
+            if not jobs.has_key(id):
+                for queue in (DONE_Q, FAILED_Q):
+                    controlfile = self._controlfile(queue, id)
+                    if os.path.exists(controlfile):
+                        self._append('add', id, queue,
+                                     self._readItem(controlfile))
+                        break
+                else:
+                    self._append('remove', id)
+
+    def maintain(self):
+        """
+        Take over the changes of the sendq made w/o the storage (only the
+        first time) and compact the journal if it got too long.
+
+        This is done by the idle script, so the other scripts needn't
+        look at the directories when they open a storage.
+        """
+        self._sync()
+        if not self._checked:
+            self._check()
+            self._checked = 1
+        if self._records > _compact_factor*len(self._items) + 100:
+            self._compact()
+
+    def recover(self):
+        """
+        Rebuild the index and the journal from the directories.
+        """
+        self._reset()
+        try:
+            # only the records appended from now on are kept
+            st = os.stat(self._journal)
+            self._inode, self._offset = st.st_ino, st.st_size
+        except OSError:
+            pass
+        for queue in (DONE_Q, FAILED_Q, SEND_Q):
+            for id, controlfile in self._scan(queue).items():
+                try:
+                    self._insert(id, queue, self._readItem(controlfile))
+                except EnvironmentError:
+                    pass
+        self._compact()
+
+    ###--- API ---###
+
+    def setDone(self, id, controlfile=None):
+        return self._move(id, DONE_Q, controlfile)
+
+    def setFailed(self, id, controlfile=None):
+        return self._move(id, FAILED_Q, controlfile)
+
+    def _move(self, id, queue, controlfile=None):
+        """
+        Move the job 'id' from the sendq to 'queue'. Returns the
+        JobDescription of the moved job.
+
+        'controlfile' is the current control file of the job (e.g. the
+        claimed one, see fax.claimJob()). If it's not given, the job is
+        looked for in the sendq and the claim dirs.
+        """
+        import fax
+        if not controlfile:
+            controlfile = self._controlfile(SEND_Q, id)
+            if not os.path.exists(controlfile):
+                # claimed by the node sending it
+                controlfile = self._scan(SEND_Q).get(id, controlfile)
+        control = fax.moveJob(controlfile, self._dirs[queue], self.user)
+        self._append('add', id, queue, dict(control.items()))
+        return control
+
+    def getItem(self, queue, id):
+        self._sync()
+        if self._items.get(id, [None])[0] != queue:
+            return None
+        return self._items[id][1].get('filename')
+
+    def addItem(self, queue, id, description):
+        """
+        Add the job 'id' to 'queue'. The job files must have been
+        written before.
+        """
+        self._append('add', id, queue, description)
+
+    def updateItem(self, id, **changes):
+        """
+        Record changes of the description of job 'id' (e.g. after
+        changing its control file).
+        """
+        self._append('update', id, '', changes)
+
+    def removeItem(self, id):
+        """
+        Remove the job 'id' from the index. The job files must have
+        been removed before.
+        """
+        self._append('remove', id)
+
+    def getDescription(self, id):
+        """
+        Return the description of job 'id' as dictionary or None if
+        it's unknown.
+        """
+        self._sync()
+        if not self._items.has_key(id):
+            return None
+        return self._items[id][1].copy()
+
+    def getControlfile(self, id):
+        self._sync()
+        if not self._items.has_key(id):
+            return None
+        return self._controlfile(self._items[id][0], id)
+
+    def listItems(self, queue, before=None):
+        """
+        Return the ids of all jobs in 'queue'. The jobs of the sendq are
+        ordered by their start time. If 'before' is given, only the jobs
+        starting before this time are returned.
+        """
+        self._sync()
+        entries = self._sorted.get(queue, [])
+        if before is not None:
+            entries = entries[:bisect.bisect_left(entries, (before, ))]
+        return [id for key, id in entries]
+
+    def newItems(self):
+        """
+        Return the ids of the jobs added to the sendq since the last
+        call, so they needn't be looked for in the whole queue. The
+        first call returns all jobs of the sendq, as do the calls after
+        the journal was rewritten.
+        """
+        self._sync()
+        added = self._added.keys()
+        self._added = {}
+        return added
+
+
+# storages already opened by this process, referenced by journal
+_storages = {}
+
+def getStorage(config, user):
+    """
+    Return the FileStorage of 'user'. Each storage is opened only once
+    per interpreter. Its journal is only read when the index is used.
     """
-    pass
+    userdir = os.path.join(config.get('GLOBAL', "fax_user_dir"), user)
+    key = os.path.abspath(userdir)
+    if not _storages.has_key(key):
+        _storages[key] = FileStorage(config, user)
+    return _storages[key]
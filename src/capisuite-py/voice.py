@@ -96,12 +96,12 @@ def getNumberFiles(number, gender="-"):
 # @param config the ConfigParser instance holding the configuration info
 # @param gender if the number is used in connection with a singular noun ("f" --> "eine Nachricht")
 def sayNumber(config, user, call, number, gender="-"):
-    for f in getNumberFiles(number, gender=gender):
-        say(config, user, call, "%s.la" % f)
+    say(config, user, call,
+        *["%s.la" % f for f in getNumberFiles(number, gender=gender)])
 
 def say(config, user, call, *files):
-    for f in files:
-        call.audio_send(getAudio(config, user, f),1)
+    # send all snippets as one transmission, so there are no gaps
+    call.audio_send_sequence([getAudio(config, user, f) for f in files], 1)
 
 
 ###---- Queue handling ---###
@@ -50,8 +50,8 @@ unsigned char cswap[256] = {
 };
 
 
-AudioReceive::AudioReceive(Connection *conn, string file, int timeout, int silence_timeout, bool DTMF_exit) throw (CapiExternalError,CapiWrongState)
-	:CallModule(conn, timeout, DTMF_exit),silence_count(0),file(file),start_time(0),end_time(0),
+AudioReceive::AudioReceive(Connection *conn, string file, int timeout, int silence_timeout, bool DTMF_exit, bool compress) throw (CapiExternalError,CapiWrongState)
+	:CallModule(conn, timeout, DTMF_exit),silence_count(0),file(file),compress(compress),start_time(0),end_time(0),
 	silence_timeout(silence_timeout*8000) // ISDN audio sample rate = 8000Hz
 {
 	if (conn->getService()!=Connection::VOICE)
@@ -63,7 +63,7 @@ AudioReceive::mainLoop() throw (CapiWrongState,CapiExternalError)
 {
 	start_time=getTime();
 	if (!(DTMF_exit && (!conn->getDTMF().empty()) ) ) {
-		conn->start_file_reception(file);
+		conn->start_file_reception(file,compress);
 		CallModule::mainLoop();
 		conn->stop_file_reception();
 		// truncate the silence away if it's more than one second
@@ -71,7 +71,10 @@ AudioReceive::mainLoop() throw (CapiWrongState,CapiExternalError)
 			struct stat filestat;
 			if (stat(file.c_str(),&filestat)==-1)
 				throw CapiExternalError("can't stat output file","AudioReceive::mainLoop");
-			if (truncate(file.c_str(),filestat.st_size-silence_timeout+8000)==-1) 
+			off_t silence_size=silence_timeout-8000;
+			if (compress)
+				silence_size/=2; // 4 bit per sample
+			if (truncate(file.c_str(),filestat.st_size-silence_size)==-1) 
 				throw CapiExternalError("can't truncate output file","AudioReceive::mainLoop");
 		}
 	}
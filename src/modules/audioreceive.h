@@ -43,7 +43,8 @@ using namespace std;
     not later on. We see a later disconnect as normal event, no error.
 
     The created file will be saved in the format given by Capi, that is
-    bit-reversed A-Law (or u-Law), 8 kHz, mono.
+    bit-reversed A-Law (or u-Law), 8 kHz, mono. Optionally, it can be compressed
+    with IMA ADPCM while it's received (see Connection::start_file_reception()).
 
     @author Gernot Hillier
 */
@@ -59,10 +60,11 @@ class AudioReceive: public CallModule
 		    @param timeout timeout in seconds after which record is finished, 0=record forever (until call is finished)
 		    @param silence_timeout duration of silence in seconds after which record is finished, 0=no silence detection
 		    @param DTMF_exit true: abort if we receive DTMF during mainLoop() or if DTMF was received before
+		    @param compress true: save the file compressed with IMA ADPCM
 		    @throw CapiExternalError Thrown if connection is not in speech mode
 		    @throw CapiWrongState Thrown if connection is not up (thrown by base class constructor)
 		*/
-		AudioReceive(Connection *conn, string file, int timeout, int silence_timeout, bool DTMF_exit) throw (CapiExternalError,CapiWrongState);
+		AudioReceive(Connection *conn, string file, int timeout, int silence_timeout, bool DTMF_exit, bool compress=false) throw (CapiExternalError,CapiWrongState);
 
  		/** @brief Start file reception, wait for one of the timeouts or disconnection and stop the reception.
 
@@ -93,6 +95,7 @@ class AudioReceive: public CallModule
 		unsigned int silence_count; ///< counter how many consecutive samples (bytes) have been silent
 		unsigned int silence_timeout; ///< amount of silence samples after which record is finished
 		string file; ///< file name to save audio data to
+		bool compress; ///< true if the file is compressed with IMA ADPCM
 		long start_time, ///< time in seconds since the epoch when the recording was started
 			end_time; ///< time in seconds since the epoch when the recording was finished
 };
@@ -17,8 +17,15 @@
 #include "../backend/connection.h"
 #include "audiosend.h"
 
-AudioSend::AudioSend(Connection *conn, string file, bool DTMF_exit) throw (CapiWrongState,CapiExternalError)
-:CallModule(conn,-1,DTMF_exit),file(file)
+AudioSend::AudioSend(Connection *conn, string file, bool DTMF_exit, bool cache) throw (CapiWrongState,CapiExternalError)
+:CallModule(conn,-1,DTMF_exit),files(1,file),cache(cache)
+{
+	if (conn->getService()!=Connection::VOICE)
+	 	throw CapiExternalError("Connection not in speech mode","AudioSend::AudioSend()");
+}
+
+AudioSend::AudioSend(Connection *conn, vector<string> files, bool DTMF_exit) throw (CapiWrongState,CapiExternalError)
+:CallModule(conn,-1,DTMF_exit),files(files),cache(true)
 {
 	if (conn->getService()!=Connection::VOICE)
 	 	throw CapiExternalError("Connection not in speech mode","AudioSend::AudioSend()");
@@ -29,7 +36,7 @@ AudioSend::mainLoop() throw (CapiError,CapiWrongState,CapiExternalError,CapiMsgE
 {
 	start_time=getTime();
 	if (!(DTMF_exit && (!conn->getDTMF().empty()) ) ) {
-		conn->start_file_transmission(file);
+		conn->start_file_transmission(files,2048,cache);
 		CallModule::mainLoop();
 		conn->stop_file_transmission();
 	}
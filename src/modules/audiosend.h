@@ -18,6 +18,7 @@
 #define AUDIOSEND_H
 
 #include <string>
+#include <vector>
 #include "callmodule.h"
 
 class Connection;
@@ -52,10 +53,24 @@ class AudioSend: public CallModule
                     @param conn reference to Connection object
 		    @param file name of file to send
 		    @param DTMF_exit set to true, if you want to finish when DTMF signal is received
+		    @param cache false: don't add the file to the PromptCache (for files played only once)
 		    @throw CapiExternalError Thrown if speech mode isn't established before.
 		    @throw CapiWrongState Thrown if connection is not up (thrown by base class constructor)
 		*/
-		AudioSend(Connection *conn, string file, bool DTMF_exit) throw (CapiWrongState,CapiExternalError);
+		AudioSend(Connection *conn, string file, bool DTMF_exit, bool cache=true) throw (CapiWrongState,CapiExternalError);
+
+ 		/** @brief Constructor. Test if we are in speech mode and create an object which sends several files in a row.
+
+		    The files are sent w/o gaps between them (see Connection::start_file_transmission(vector<string>)).
+		    A DTMF signal aborts the whole sequence if DTMF_exit is set.
+
+                    @param conn reference to Connection object
+		    @param files names of the files to send
+		    @param DTMF_exit set to true, if you want to finish when DTMF signal is received
+		    @throw CapiExternalError Thrown if speech mode isn't established before.
+		    @throw CapiWrongState Thrown if connection is not up (thrown by base class constructor)
+		*/
+		AudioSend(Connection *conn, vector<string> files, bool DTMF_exit) throw (CapiWrongState,CapiExternalError);
 
 		/** @brief Start file transmission, wait for the end of the file or the connection, stop file transmission
 
@@ -78,7 +93,8 @@ class AudioSend: public CallModule
 		long duration();
 
 	private:
-		string file; ///< name of the file to send
+		vector<string> files; ///< names of the files to send
+		bool cache; ///< false if the files shouldn't be added to the PromptCache
 		long start_time; ///< time in seconds since the epoch when the module was started
 };
 
@@ -0,0 +1,145 @@
+/*  @file audiosendreceive.cpp
+    @brief Contains AudioSendReceive - Call Module for playing announcements while recording with barge-in
+
+    @author agent <agent@local>
+*/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#define conf_silence_limit 10
+#define conf_barge_in_block 160 // 20 msec
+#define conf_barge_in_speech 320 // 40 msec of speech stop the playback, must be a multiple of conf_barge_in_block
+
+#include "../backend/connection.h"
+#include "audiosendreceive.h"
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+extern unsigned char cswap[256]; // see audioreceive.cpp
+
+AudioSendReceive::AudioSendReceive(Connection *conn, vector<string> files, string record_file, int timeout, int silence_timeout, bool DTMF_exit) throw (CapiExternalError,CapiWrongState)
+	:CallModule(conn, timeout, DTMF_exit),files(files),record_file(record_file),playing(false),speech_count(0),silence_count(0),
+	silence_timeout(silence_timeout*8000),play_start(0),barge_in_offset(-1),start_time(0),end_time(0)
+{
+	if (conn->getService()!=Connection::VOICE)
+	 	throw CapiExternalError("Connection not in speech mode","AudioSendReceive::AudioSendReceive()");
+}
+
+void
+AudioSendReceive::mainLoop() throw (CapiError,CapiWrongState,CapiExternalError,CapiMsgError)
+{
+	start_time=getTime();
+	if (!(DTMF_exit && (!conn->getDTMF().empty()) ) ) {
+		conn->start_file_reception(record_file);
+		try {
+			play_start=getTimeMs();
+			playing=true;
+			conn->start_file_transmission(files,conf_barge_in_block);
+			if (!playing) // barge-in while we were starting
+				conn->abort_file_transmission();
+		}
+		catch (...) {
+			playing=false;
+			conn->stop_file_reception();
+			throw;
+		}
+		CallModule::mainLoop();
+		playing=false;
+		conn->stop_file_transmission();
+		conn->stop_file_reception();
+		// truncate the silence away if it's more than one second
+		if (silence_timeout>8000 && silence_count > silence_timeout) {
+			struct stat filestat;
+			if (stat(record_file.c_str(),&filestat)==-1)
+				throw CapiExternalError("can't stat output file","AudioSendReceive::mainLoop");
+			if (truncate(record_file.c_str(),filestat.st_size-silence_timeout+8000)==-1)
+				throw CapiExternalError("can't truncate output file","AudioSendReceive::mainLoop");
+		}
+	}
+	end_time=getTime();
+}
+
+void
+AudioSendReceive::dataIn(unsigned char* data, unsigned length)
+{
+	for (unsigned start=0;start<length;start+=conf_barge_in_block) {
+		unsigned slice=length-start;
+		if (slice>conf_barge_in_block)
+			slice=conf_barge_in_block;
+		unsigned int sum=0;
+		for (unsigned i=start;i<start+slice;i++)
+			sum+=(cswap[data[i]]^0x55) & 0x7f;  // swap bits, inversion of odd bits, stripping of sign
+		bool silence=(sum < conf_silence_limit*slice);
+
+		if (playing) {
+			if (silence)
+				speech_count=0;
+			else {
+				speech_count+=slice;
+				if (speech_count >= conf_barge_in_speech)
+					bargeIn();
+			}
+		} else if (silence_timeout) {
+			if (silence) {
+				silence_count+=slice;
+				if (silence_count > silence_timeout)
+					finish=true;
+			} else
+				silence_count=0;
+		}
+	}
+	if (!playing && silence_timeout && silence_count)
+		conn->debugMessage("silence",3);
+}
+
+void
+AudioSendReceive::gotDTMF()
+{
+	if (playing)
+		bargeIn();
+	CallModule::gotDTMF();
+}
+
+void
+AudioSendReceive::transmissionComplete()
+{
+	playing=false;
+}
+
+void
+AudioSendReceive::bargeIn()
+{
+	playing=false;
+	barge_in_offset=getTimeMs()-play_start;
+	conn->debugMessage("barge-in detected, stopping playback",2);
+	conn->abort_file_transmission();
+}
+
+long
+AudioSendReceive::duration()
+{
+	return end_time-start_time;
+}
+
+long
+AudioSendReceive::bargeInOffset()
+{
+	return barge_in_offset;
+}
+
+long long
+AudioSendReceive::getTimeMs()
+{
+	struct timeval curr_time;
+	gettimeofday(&curr_time,NULL);
+	return static_cast<long long>(curr_time.tv_sec)*1000+curr_time.tv_usec/1000;
+}
@@ -0,0 +1,136 @@
+/** @file audiosendreceive.h
+    @brief Contains AudioSendReceive - Call Module for playing announcements while recording with barge-in
+
+    @author agent <agent@local>
+*/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef AUDIOSENDRECEIVE_H
+#define AUDIOSENDRECEIVE_H
+
+#include <string>
+#include <vector>
+#include "callmodule.h"
+
+class Connection;
+
+using namespace std;
+
+/** @brief Call Module for playing announcements while recording with barge-in.
+
+    This module sends one or more A-Law files (like AudioSend) and records the
+    received audio at the same time (like AudioReceive). If the caller starts
+    to speak or sends a DTMF signal while the files are played, the playback
+    is stopped immediately ("barge-in"). The recording continues until one of
+    the timeouts is reached.
+
+    To keep the reaction time low, the files are sent in small blocks and the
+    transmission is aborted directly from the callback which detects the barge-in,
+    not from mainLoop().
+
+    Silence detection is only active after the playback has finished, as the
+    caller is normally quiet while listening.
+
+    If DTMF abort is enabled, the module will abort immediately if the DTMF
+    receiving buffer (see Connection::getDTMF) isn't empty when it is created.
+    A DTMF signal will then also finish the recording. Otherwise it only stops
+    the playback.
+
+    The connction must be in audio mode (by connecting with service VOICE),
+    otherwise an exception will be caused.
+
+    CapiWrongState will only be thrown if connection is not up at startup,
+    not later on. We see a later disconnect as normal event, no error.
+
+    @author agent
+*/
+class AudioSendReceive: public CallModule
+{
+	public:
+ 		/** @brief Constructor. Create an object and test for audio mode.
+
+		    @param conn reference to Connection object
+		    @param files names of the files to play
+		    @param record_file name of file to save received audio stream to.
+		    @param timeout timeout in seconds after which record is finished, -1=record forever (until call is finished)
+		    @param silence_timeout duration of silence in seconds after which record is finished, 0=no silence detection
+		    @param DTMF_exit true: finish recording if we receive DTMF during mainLoop() or abort if DTMF was received before
+		    @throw CapiExternalError Thrown if connection is not in speech mode
+		    @throw CapiWrongState Thrown if connection is not up (thrown by base class constructor)
+		*/
+		AudioSendReceive(Connection *conn, vector<string> files, string record_file, int timeout, int silence_timeout, bool DTMF_exit) throw (CapiExternalError,CapiWrongState);
+
+		/** @brief Start reception and transmission, wait for one of the timeouts or disconnection and stop both.
+
+		    If the recording was finished because of silence, the silence is truncated away from the recorded file.
+
+		    @throw CapiExternalError Thrown by Connection::start_file_transmission() and Connection::start_file_reception().
+		    @throw CapiMsgError Thrown by Connection::start_file_transmission, see there for explanation.
+		    @throw CapiError Thrown by Connection::start_file_transmission, see there for explanation.
+		    @throw CapiWrongState Thrown if connection is not up at start of transfer
+		*/
+		void mainLoop() throw (CapiError,CapiWrongState,CapiExternalError,CapiMsgError);
+
+		/** @brief Detect speech during playback and silence after it
+
+		    The received package is checked in slices of 20 msec, as CAPI may deliver up to 2048 bytes
+		    at once. All bytes of a slice are partly A-Law decoded, added and compared to a threshold
+		    like in AudioReceive::dataIn(). If enough consecutive non-silent samples are received
+		    during playback, it is stopped. After the playback, silence is counted to finish the recording.
+		*/
+		void dataIn(unsigned char* data, unsigned length);
+
+		/** @brief Stop the playback when DTMF is received, finish if DTMF_exit is set.
+		*/
+		void gotDTMF();
+
+		/** @brief The playback has finished - continue recording
+		*/
+		void transmissionComplete();
+
+		/** @brief Return the time in seconds since start of mainLoop()
+
+		    @return time in seconds since start of mainLoop()
+  		*/
+		long duration();
+
+		/** @brief Return the position in the played files at which the caller interrupted the playback
+
+		    @return position in milliseconds since the start of the playback, -1 if the files were played completely
+  		*/
+		long bargeInOffset();
+
+	private:
+		/** @brief stop the playback and remember the position
+
+		    Called from dataIn() and gotDTMF(), i.e. from the thread handling the CAPI messages.
+		*/
+		void bargeIn();
+
+		/** @brief return the current time in milliseconds
+
+		    @return time in milliseconds since the epoch
+		*/
+		long long getTimeMs();
+
+		vector<string> files; ///< names of the files to play
+		string record_file; ///< file name to save audio data to
+		bool playing; ///< true as long as the files are played
+		unsigned int speech_count; ///< counter how many consecutive samples (bytes) have been non-silent during playback
+		unsigned int silence_count; ///< counter how many consecutive samples (bytes) have been silent after playback
+		unsigned int silence_timeout; ///< amount of silence samples after which record is finished
+		long long play_start; ///< time in milliseconds when the playback was started
+		long barge_in_offset; ///< see bargeInOffset()
+		long start_time, ///< time in seconds since the epoch when the recording was started
+			end_time; ///< time in seconds since the epoch when the recording was finished
+};
+
+#endif
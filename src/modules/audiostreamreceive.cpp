@@ -0,0 +1,55 @@
+/*  @file audiostreamreceive.cpp
+    @brief Contains AudioStreamReceive - Call Module for reading received audio data to memory
+
+    @author agent <agent@local>
+*/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "../backend/connection.h"
+#include "audiostreamreceive.h"
+
+#define conf_stream_read_max 8192 // bytes returned at most by one call, matches the stream buffer of Connection
+
+AudioStreamReceive::AudioStreamReceive(Connection *conn, unsigned long maxlength, int timeout, bool DTMF_exit) throw (CapiWrongState,CapiExternalError)
+:CallModule(conn,timeout,DTMF_exit),data(),maxlength(maxlength)
+{
+	if (conn->getService()!=Connection::VOICE)
+	 	throw CapiExternalError("Connection not in speech mode","AudioStreamReceive::AudioStreamReceive()");
+}
+
+void
+AudioStreamReceive::mainLoop() throw (CapiError,CapiWrongState,CapiExternalError,CapiMsgError)
+{
+	if (DTMF_exit && (!conn->getDTMF().empty()) )
+		return;
+
+	char buffer[conf_stream_read_max];
+	if (maxlength>conf_stream_read_max)
+		maxlength=conf_stream_read_max;
+	unsigned long length=conn->stream_read(buffer,maxlength);
+	if (!length && timeout) {
+		CallModule::mainLoop(); // wait for dataIn()
+		length=conn->stream_read(buffer,maxlength);
+	}
+	data.assign(buffer,length);
+}
+
+void
+AudioStreamReceive::dataIn(unsigned char* data, unsigned length)
+{
+	finish=true;
+}
+
+string
+AudioStreamReceive::getData()
+{
+	return data;
+}
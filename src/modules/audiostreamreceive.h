@@ -0,0 +1,79 @@
+/** @file audiostreamreceive.h
+    @brief Contains AudioStreamReceive - Call Module for reading received audio data to memory
+
+    @author agent <agent@local>
+*/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef AUDIOSTREAMRECEIVE_H
+#define AUDIOSTREAMRECEIVE_H
+
+#include <string>
+#include "callmodule.h"
+
+class Connection;
+
+using namespace std;
+
+/** @brief Call Module for reading received audio data to memory
+
+    This module fetches the data collected by a stream reception started with
+    Connection::start_stream_reception(). If no data is available, it waits
+    until some data arrives or the timeout is reached.
+
+    The data is in bit-inversed A-Law format, as delivered by CAPI. If DTMF
+    abort is enabled, the module will abort immediately if a DTMF signal is
+    received or was received before.
+
+    CapiWrongState will only be thrown if connection is not up at startup,
+    not later on. We see a later disconnect as normal event, no error.
+
+    @author agent
+*/
+class AudioStreamReceive: public CallModule
+{
+	public:
+ 		/** @brief Constructor. Test if we are in speech mode and create an object.
+
+                    @param conn reference to Connection object
+		    @param maxlength maximum number of bytes to read, at most 8192 are read per call
+		    @param timeout timeout in seconds to wait for data (-1 = infinite, 0 = don't wait)
+		    @param DTMF_exit set to true, if you want to finish when DTMF signal is received
+		    @throw CapiExternalError Thrown if speech mode isn't established before.
+		    @throw CapiWrongState Thrown if connection is not up (thrown by base class constructor)
+		*/
+		AudioStreamReceive(Connection *conn, unsigned long maxlength, int timeout, bool DTMF_exit) throw (CapiWrongState,CapiExternalError);
+
+		/** @brief Wait until data is available or the timeout is reached, fetch the data
+
+		    @throw CapiExternalError Thrown by Connection::stream_read, see there for explanation.
+		*/
+		void mainLoop() throw (CapiError,CapiWrongState,CapiExternalError,CapiMsgError);
+
+		/** @brief finish main loop as soon as data is received
+
+		    @param data pointer to the received data
+		    @param length length of the data
+		*/
+		void dataIn(unsigned char* data, unsigned length);
+
+		/** @brief Return the data which was read
+
+		    @return the data
+		*/
+		string getData();
+
+	private:
+		string data; ///< the data read from the stream
+		unsigned long maxlength; ///< maximum number of bytes to read
+};
+
+#endif
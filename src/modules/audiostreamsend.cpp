@@ -0,0 +1,57 @@
+/*  @file audiostreamsend.cpp
+    @brief Contains AudioStreamSend - Call Module for sending audio data given in memory
+
+    @author agent <agent@local>
+*/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "../backend/connection.h"
+#include "audiostreamsend.h"
+
+AudioStreamSend::AudioStreamSend(Connection *conn, string data, bool close, bool DTMF_exit) throw (CapiWrongState,CapiExternalError)
+:CallModule(conn,-1,DTMF_exit),data(data),written_bytes(0),close(close)
+{
+	if (conn->getService()!=Connection::VOICE)
+	 	throw CapiExternalError("Connection not in speech mode","AudioStreamSend::AudioStreamSend()");
+}
+
+void
+AudioStreamSend::mainLoop() throw (CapiError,CapiWrongState,CapiExternalError,CapiMsgError)
+{
+	if (DTMF_exit && (!conn->getDTMF().empty()) )
+		return;
+
+	timespec delay_time;
+	delay_time.tv_sec=0; delay_time.tv_nsec=100000000;  // 100 msec
+	while (!finish && written_bytes<data.size()) {
+		written_bytes+=conn->stream_write(data.data()+written_bytes,data.size()-written_bytes);
+		if (written_bytes<data.size())
+			nanosleep(&delay_time,NULL); // wait until the window has room again
+	}
+
+	if (close && !finish) {
+		conn->stream_close();
+		CallModule::mainLoop();
+		conn->stop_file_transmission();
+	}
+}
+
+void
+AudioStreamSend::transmissionComplete()
+{
+	finish=true;
+}
+
+unsigned long
+AudioStreamSend::written()
+{
+	return written_bytes;
+}
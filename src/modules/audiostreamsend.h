@@ -0,0 +1,88 @@
+/** @file audiostreamsend.h
+    @brief Contains AudioStreamSend - Call Module for sending audio data given in memory
+
+    @author agent <agent@local>
+*/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef AUDIOSTREAMSEND_H
+#define AUDIOSTREAMSEND_H
+
+#include <string>
+#include "callmodule.h"
+
+class Connection;
+
+using namespace std;
+
+/** @brief Call Module for sending audio data given in memory
+
+    This module hands a piece of data to a stream transmission started with
+    Connection::start_stream_transmission(). As the stream only accepts as
+    much data as fits into the send window, the module waits until all data
+    was accepted. So the producer (e.g. a Python script reading from a TTS
+    pipe) automatically runs at the speed of the B channel.
+
+    If close is set, the stream is closed after the data was given and the
+    module waits until everything was sent.
+
+    The data must be in bit-inversed A-Law format. If DTMF abort is enabled,
+    the module will abort immediately if a DTMF signal is received or was
+    received before. The stream isn't stopped then, so the caller can decide
+    what to do.
+
+    CapiWrongState is thrown if the connection isn't up when data is given
+    to the stream, i.e. also if it's disconnected before all data was
+    accepted, as the rest of the data can't be sent then. A disconnect while
+    waiting for a closed stream to be sent is seen as normal event, no error.
+
+    @author agent
+*/
+class AudioStreamSend: public CallModule
+{
+	public:
+ 		/** @brief Constructor. Test if we are in speech mode and create an object.
+
+                    @param conn reference to Connection object
+		    @param data the data to send
+		    @param close set to true to close the stream after this data
+		    @param DTMF_exit set to true, if you want to finish when DTMF signal is received
+		    @throw CapiExternalError Thrown if speech mode isn't established before.
+		    @throw CapiWrongState Thrown if connection is not up (thrown by base class constructor)
+		*/
+		AudioStreamSend(Connection *conn, string data, bool close, bool DTMF_exit) throw (CapiWrongState,CapiExternalError);
+
+		/** @brief Give the data to the stream, wait until it's accepted, optionally close the stream and wait until it's sent
+
+		    @throw CapiExternalError Thrown by Connection::stream_write, see there for explanation.
+		    @throw CapiMsgError Thrown by Connection::stream_write, see there for explanation.
+		    @throw CapiError Thrown by Connection::stream_write, see there for explanation.
+		    @throw CapiWrongState Thrown if connection is not up at start of transfer or was disconnected before all data was accepted (thrown by Connection::stream_write)
+		*/
+		void mainLoop() throw (CapiError,CapiWrongState,CapiExternalError,CapiMsgError);
+
+		/** @brief finish main loop if the stream was sent completely
+		*/
+		void transmissionComplete();
+
+		/** @brief Return the number of bytes which were accepted by the stream
+
+		    @return number of bytes accepted
+		*/
+		unsigned long written();
+
+	private:
+		string data; ///< the data to send
+		unsigned long written_bytes; ///< number of bytes of data accepted by the stream
+		bool close; ///< close the stream after data was written
+};
+
+#endif
@@ -0,0 +1,39 @@
+/*  @file callbridge.cpp
+    @brief Contains CallBridge - Call Module for connecting two calls through
+
+    @author agent <agent@local>
+*/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "../backend/connection.h"
+#include "callbridge.h"
+
+CallBridge::CallBridge(Connection *conn, Connection *peer, int timeout, bool DTMF_exit) throw (CapiExternalError,CapiWrongState)
+:CallModule(conn,timeout,DTMF_exit),peer(peer)
+{
+	if (peer->getState()!=Connection::UP)
+		throw CapiWrongState("call abort detected","CallBridge::CallBridge()");
+	if (conn->getService()!=Connection::VOICE || peer->getService()!=Connection::VOICE)
+	 	throw CapiExternalError("Connection not in speech mode","CallBridge::CallBridge()");
+}
+
+void
+CallBridge::mainLoop() throw (CapiExternalError,CapiWrongState)
+{
+	conn->bridge(peer);
+	exit_time=getTime()+timeout;
+	timespec delay_time;
+	delay_time.tv_sec=0; delay_time.tv_nsec=100000000;  // 100 msec
+	// we're only registered at conn, so check the peer's state ourselves
+	while (!finish && peer->getBridgePeer()==conn && ( (timeout==-1) || (getTime() <= exit_time) ) )
+		nanosleep(&delay_time,NULL);
+	conn->unbridge();
+}
@@ -0,0 +1,63 @@
+/** @file callbridge.h
+    @brief Contains CallBridge - Call Module for connecting two calls through
+
+    @author agent <agent@local>
+*/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef CALLBRIDGE_H
+#define CALLBRIDGE_H
+
+#include "callmodule.h"
+
+class Connection;
+
+/** @brief Call Module for connecting two calls through
+
+    This module bridges the B channels of two speech connections (see
+    Connection::bridge()) and waits until one of them is cleared, the timeout
+    is reached or (if enabled) a DTMF signal is received on the first
+    connection. The bridge is removed then.
+
+    The audio data is forwarded by the backend directly, so the application
+    isn't involved in the data path at all.
+
+    CapiWrongState will only be thrown if connection is not up at startup,
+    not later on. We see a later disconnect as normal event, no error.
+
+    @author agent
+*/
+class CallBridge: public CallModule
+{
+	public:
+		/** @brief Constructor. Create an object and test for audio mode.
+
+		    @param conn reference to Connection object
+		    @param peer reference to the Connection object to connect conn with
+		    @param timeout timeout in seconds after which the bridge is removed, -1=wait until one call is finished
+		    @param DTMF_exit true: remove the bridge if we receive DTMF on conn during mainLoop()
+		    @throw CapiExternalError Thrown if one of the connections is not in speech mode
+		    @throw CapiWrongState Thrown if one of the connections is not up
+		*/
+		CallBridge(Connection *conn, Connection *peer, int timeout, bool DTMF_exit) throw (CapiExternalError,CapiWrongState);
+
+		/** @brief Bridge the connections, wait for one of the conditions described above and remove the bridge
+
+		    @throw CapiExternalError Thrown by Connection::bridge()
+		    @throw CapiWrongState Thrown by Connection::bridge()
+		*/
+		void mainLoop() throw (CapiExternalError,CapiWrongState);
+
+	private:
+		Connection *peer; ///< the Connection which is bridged with conn
+};
+
+#endif
@@ -14,6 +14,7 @@
  *                                                                         *
  ***************************************************************************/
 
+#include "../backend/capi.h"
 #include "calloutgoing.h"
 
 CallOutgoing::CallOutgoing(Capi *capi, _cdword controller, string call_from, string call_to, Connection::service_t service, int timeout, string faxStationID, string faxHeadline, bool clir)
@@ -26,7 +27,13 @@ faxStationID(faxStationID),faxHeadline(faxHeadline),clir(clir)
 void
 CallOutgoing::mainLoop() throw (CapiExternalError, CapiMsgError)
 {
-	conn=new Connection(capi,controller,call_from,clir,call_to,service,faxStationID,faxHeadline);
+	try {
+		conn=new Connection(capi,controller,call_from,clir,call_to,service,faxStationID,faxHeadline);
+	}
+	catch (CapiMsgError) { // the controller refused the call
+		capi->callPlaced(controller,true);
+		throw;
+	}
 	conn->registerCallInterface(this);
 
 	// first, we have no timeout, timeout is activated in alerting()!
@@ -46,6 +53,8 @@ CallOutgoing::mainLoop() throw (CapiExternalError, CapiMsgError)
 		while(conn->getState()!=Connection::DOWN)
 			nanosleep(&delay_time,NULL);
 	}
+	// errors 0x34xx are causes given by the network, so the controller works
+	capi->callPlaced(controller,result>=2 && result<0x3304);
 }
 
 void
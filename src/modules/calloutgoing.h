@@ -58,6 +58,9 @@ class CallOutgoing: public CallModule
 
 		/** @brief Initiate connection, wait for it to succeed
 
+		    The outcome is reported to Capi::callPlaced(), so controllers which keep
+		    failing are skipped by Capi::selectController().
+
 		    @throw CapiExternalError Thrown by Connection::Connection(Capi*,_cdword,string,bool,string,service_t,string,string)
 		    @throw CapiMsgError Thrown by Connection::Connection(Capi*,_cdword,string,bool,string,service_t,string,string)
 		*/
@@ -14,12 +14,14 @@
  *                                                                         *
  ***************************************************************************/
 
+#include <sstream>
+#include <time.h>
 #include "../backend/connection.h"
 #include "faxreceive.h"
 
 
 FaxReceive::FaxReceive(Connection *conn, string file) throw (CapiWrongState,CapiExternalError)
-:CallModule(conn),file(file)
+:CallModule(conn),file(file),reported_pages(0)
 {
 	if (conn->getService()!=Connection::FAXG3)
 	 	throw CapiExternalError("Connection not in fax mode","FaxReceive::FaxReceive()");
@@ -30,8 +32,33 @@ void
 FaxReceive::mainLoop() throw (CapiWrongState,CapiExternalError)
 {
 	conn->start_file_reception(file);
-	CallModule::mainLoop();
+	timespec delay_time;
+	delay_time.tv_sec=0; delay_time.tv_nsec=100000000;  // 100 msec
+	while (!finish) {
+		nanosleep(&delay_time,NULL);
+		checkPages();
+	}
 	conn->stop_file_reception();
+	checkPages();
+}
+
+void
+FaxReceive::checkPages()
+{
+	SffIndex *index=conn->getFaxIndex();
+	if (!index)
+		return;
+	unsigned pages=index->completePages();
+	while (reported_pages<pages)
+		pageReceived(++reported_pages);
+}
+
+void
+FaxReceive::pageReceived(unsigned pages)
+{
+	stringstream msg;
+	msg << "fax page " << pages << " received";
+	conn->debugMessage(msg.str(),2);
 }
 
 void 
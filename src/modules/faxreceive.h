@@ -41,6 +41,10 @@ using namespace std;
     The created file will be saved in the format received by Capi, i.e. as
     Structured Fax File (SFF).
 
+    While the fax is received, the page index built by Connection (see SffIndex) is
+    watched. Each time a page was received completely, pageReceived() is called,
+    so derived classes can report the progress.
+
     @author Gernot Hillier
 */
 class FaxReceive: public CallModule
@@ -65,9 +69,22 @@ class FaxReceive: public CallModule
  		/** @brief finish main loop if file is completely received
   		*/
 		void transmissionComplete();
-	
+
+		/** @brief called each time a page was received completely
+
+		    The default implementation only writes a log message.
+
+		    @param pages number of pages received completely so far
+		*/
+		virtual void pageReceived(unsigned pages);
+
 	private:
+		/** @brief call pageReceived() for all pages completed since the last call
+		*/
+		void checkPages();
+
 		string file; ///< file name to save file to
+		unsigned reported_pages; ///< number of pages already reported by pageReceived()
 };
 
 #endif
@@ -0,0 +1,181 @@
+#!/usr/bin/env python
+"""
+Check the job claims of several nodes sharing one spool.
+
+Usage: python tests/claims.py [nodes [jobs]]
+
+Enqueues 'jobs' fax jobs in a temporary spool and starts 'nodes'
+processes, each with an own node_name, which send the jobs like
+idle.py does (w/o calling capisuite). Some sends last longer than
+claim_timeout, so the claims must be renewed by the senders. One more
+node claims a job and dies w/o releasing it, so the other nodes must
+take it back when the claim expires.
+
+Checks that each job was sent exactly once and that no job is left.
+Runs w/o capisuite, a dummy core module is used.
+"""
+
+__author__    = "agent <agent@local>"
+__license__ = """
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+"""
+
+import os, sys, time, random, tempfile, shutil, pwd
+
+_claim_timeout = 2
+_long_send = 3.5
+
+# replaces _capisuite, which is only available within capisuite
+_core = '''
+running = {}
+def log(msg, level): pass
+def error(msg): pass
+def schedule_job(job, user, starttime): pass
+def job_scheduled(job): return 0
+def job_running(job): return running.has_key(job)
+'''
+
+def _setup(base, user):
+    """
+    Create the package capisuite from the sources and the spool below
+    'base'.
+    """
+    src = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                       os.pardir, 'src', 'capisuite-py')
+    pkg = os.path.join(base, 'capisuite')
+    os.mkdir(pkg)
+    for name in os.listdir(src):
+        if name.endswith('.py'):
+            os.symlink(os.path.join(src, name), os.path.join(pkg, name))
+    config = open(os.path.join(src, 'config.py.in')).read()
+    open(os.path.join(pkg, 'config.py'), 'w').write(
+        config.replace('@pkgsysconfdir@', base))
+    open(os.path.join(base, '_capisuite.py'), 'w').write(_core)
+    for d in ('spool/done', 'spool/failed', 'users/%s/sendq' % user):
+        os.makedirs(os.path.join(base, d))
+
+
+def _config(base, node):
+    import capisuite.config
+    config = capisuite.config.CSConfigParser()
+    config.add_section('GLOBAL')
+    config.set('GLOBAL', 'spool_dir', os.path.join(base, 'spool'))
+    config.set('GLOBAL', 'fax_user_dir', os.path.join(base, 'users'))
+    config.set('GLOBAL', 'node_name', node)
+    config.set('GLOBAL', 'claim_timeout', str(_claim_timeout))
+    return config
+
+
+def _convert(infiles, faxname):
+    open(faxname, 'w').write('dummy fax')
+
+
+def _enqueue(base, user, jobs):
+    import capisuite.fax as fax
+    config = _config(base, 'setup')
+    document = os.path.join(base, 'document.ps')
+    open(document, 'w').write('%!PS')
+    for i in range(jobs):
+        fax.enqueueJob(config, user, [document], _convert,
+                       dialstring=str(i), addressee='', subject='')
+
+
+def _node(base, user, node, crash):
+    """
+    Send the jobs of the queue until it's empty, log each one sent.
+    """
+    import capisuite.fax as fax, capisuite.storage as storage, _capisuite
+    config = _config(base, node)
+    sendQ = os.path.join(base, 'users', user, 'sendq')
+    log = os.open(os.path.join(base, 'sent.log'),
+                  os.O_WRONLY|os.O_APPEND|os.O_CREAT, 0600)
+    idle = time.time()
+    while time.time() - idle < 3*_claim_timeout:
+        fax.renewClaims(config, user)
+        names = [name for name in os.listdir(sendQ)
+                 if fax._job_pattern.match(name)]
+        random.shuffle(names)
+        for name in names:
+            controlfile = os.path.join(sendQ, name)
+            claimfile = fax.claimJob(config, user, controlfile)
+            if not claimfile:
+                continue
+            if crash:
+                os._exit(0)
+            idle = time.time()
+            renewal = fax.ClaimRenewal(config, claimfile)
+            _capisuite.running[controlfile] = 1
+            try:
+                if random.random() < 0.02:
+                    time.sleep(_long_send)
+                else:
+                    time.sleep(random.random()*0.01)
+                jobnum = int(fax._job_pattern.match(name).group(1))
+                os.write(log, "%s %i\n" % (node, jobnum))
+                storage.getStorage(config, user).setDone(jobnum, claimfile)
+            finally:
+                del _capisuite.running[controlfile]
+                renewal.stop()
+                fax.releaseJob(claimfile, controlfile)
+        time.sleep(0.1)
+
+
+def main(args):
+    nodes, jobs = 4, 200
+    if args:
+        nodes = int(args[0])
+    if len(args) > 1:
+        jobs = int(args[1])
+    user = pwd.getpwuid(os.getuid())[0]
+    base = tempfile.mkdtemp('', 'claims-')
+    try:
+        _setup(base, user)
+        env = os.environ.copy()
+        env['PYTHONPATH'] = base
+        def run(*args):
+            return os.spawnve(os.P_NOWAIT, sys.executable,
+                              [sys.executable, __file__, base, user] +
+                              list(args), env)
+        os.waitpid(run('setup', str(jobs)), 0)
+        os.waitpid(run('node', 'crashed', '1'), 0)
+        pids = [run('node', 'node%i' % i, '0') for i in range(nodes)]
+        for pid in pids:
+            os.waitpid(pid, 0)
+
+        sent = {}
+        for line in open(os.path.join(base, 'sent.log')):
+            node, jobnum = line.split()
+            sent.setdefault(int(jobnum), []).append(node)
+        errors = 0
+        for jobnum, senders in sent.items():
+            if len(senders) > 1:
+                print "job %i was sent by %s" % (jobnum, ', '.join(senders))
+                errors += 1
+        if len(sent) != jobs:
+            print "%i of %i jobs were sent" % (len(sent), jobs)
+            errors += 1
+        sendQ = os.path.join(base, 'users', user, 'sendq')
+        left = [name for dir, dirs, names in os.walk(sendQ)
+                for name in names if name.endswith('.txt')]
+        if left:
+            print "jobs left in the queue: %s" % ', '.join(left)
+            errors += 1
+        if errors:
+            print "FAILED"
+            return 1
+        print "OK: %i jobs sent by %i nodes" % (jobs, nodes)
+        return 0
+    finally:
+        shutil.rmtree(base)
+
+
+if __name__ == '__main__':
+    if len(sys.argv) > 3 and sys.argv[3] == 'setup':
+        _enqueue(sys.argv[1], sys.argv[2], int(sys.argv[4]))
+    elif len(sys.argv) > 3 and sys.argv[3] == 'node':
+        _node(sys.argv[1], sys.argv[2], sys.argv[4], int(sys.argv[5]))
+    else:
+        sys.exit(main(sys.argv[1:]))